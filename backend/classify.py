@@ -114,6 +114,11 @@ class EMGClassifier:
                     try:
                         raw_value = float(parts[0])
                         filtered_value = float(parts[1])
+
+                        # Third column is the firmware's signal quality
+                        # index; samples from a poor contact are dropped
+                        if len(parts) >= 3 and float(parts[2]) < 0.5:
+                            return None
                         return raw_value, filtered_value
                     except ValueError:
                         pass
@@ -88,6 +88,11 @@ class EMGTrainer:
                     try:
                         raw_value = float(parts[0])
                         filtered_value = float(parts[1])
+
+                        # Third column is the firmware's signal quality
+                        # index; samples from a poor contact are dropped
+                        if len(parts) >= 3 and float(parts[2]) < 0.5:
+                            return None
                         
                         # Additional filtering for extreme values
                         if abs(filtered_value) > 5.0 or abs(raw_value) > 5.0:
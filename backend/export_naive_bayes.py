@@ -0,0 +1,377 @@
+#!/usr/bin/env python3
+"""
+Gaussian Naive Bayes exporter for the ESP32 firmware
+Trains a Gaussian naive Bayes model on the features the firmware computes
+and writes it as constant arrays to include/naive_bayes_model.h, for
+builds with -DTREMOR_NAIVE_BAYES (env esp32dev-nb).
+
+The CLI trainer's features.csv does not describe what the device sees:
+its dominant frequency is a full-band FFT argmax over 500 samples, and
+the device has nothing like its zero crossings of the uncentred signal
+or its spectral entropy. So the recorded sessions are replayed the way
+the firmware processes them: windows of --window samples give mean |x|,
+RMS and variance, and the dominant frequency is the Welch peak in 1-20
+Hz (256-point Hann segments, 50 % overlap, 8 averaged, on the 1 Hz
+high-passed signal; the device's line enhancer only sharpens that
+peak). Windows before the first Welch segment are left out, as are
+features constant across the training set. Class variances are floored
+at a share of the feature's overall variance, so a class whose peak
+always lands in the same bin does not get a near-zero variance.
+
+Needs only the standard library; with scikit-learn installed, --compare
+also cross-validates the backend's random forest on the same rows.
+
+Usage:
+    python export_naive_bayes.py
+    python export_naive_bayes.py --raw data/raw --window 50 \\
+        --output ../include/naive_bayes_model.h --compare data/features/compare.csv
+"""
+
+import argparse
+import csv
+import math
+import os
+import random
+import sys
+
+CLASSES = ['normal', 'mild', 'moderate', 'severe']  # TremorClass order
+
+# Backend feature columns, in the firmware's BackendFeature order
+BACKEND_FEATURES = ['mean', 'rms', 'variance', 'zero_crossings',
+                    'dominant_frequency', 'spectral_entropy']
+DEVICE_FEATURES = ['mean', 'rms', 'variance', 'dominant_frequency']
+
+# Firmware processing (device_config.h, tremor.h, welch.h)
+SAMPLE_RATE = 200
+WINDOW_SIZE = 50         # BATCH_SIZE
+HIGH_PASS_HZ = 1.0       # TremorBaselineParams
+WELCH_SEGMENT = 256
+WELCH_HOP = 128          # default 50 % overlap
+WELCH_AVERAGES = 8
+WELCH_MIN_HZ = 1.0
+WELCH_MAX_HZ = 20.0
+
+# Forest hyperparameters of models.TremorClassifier
+FOREST_TREES = 100
+FOREST_DEPTH = 10
+
+VAR_SMOOTHING = 1e-9  # share of the largest feature variance, as scikit-learn
+VAR_FLOOR = 0.01      # share of each feature's overall variance
+FOLDS = 5
+
+
+def load_sessions(raw_dir):
+    """(label, session name, filtered volts) per recorded session"""
+    sessions = []
+    for label in CLASSES:
+        label_dir = os.path.join(raw_dir, label)
+        if not os.path.isdir(label_dir):
+            continue
+        for filename in sorted(os.listdir(label_dir)):
+            if not filename.endswith('.csv'):
+                continue
+            with open(os.path.join(label_dir, filename), newline='') as f:
+                samples = [float(row['filtered']) for row in csv.DictReader(f)]
+            sessions.append((label, filename[:-len('.csv')], samples))
+    return sessions
+
+
+class HighPass:
+    """Biquad.highPass: Butterworth section, RBJ cookbook coefficients"""
+
+    def __init__(self, fc, fs):
+        w = 2 * math.pi * fc / fs
+        c, alpha = math.cos(w), math.sin(w) / (2 * 0.7071)
+        a0 = 1 + alpha
+        self.b = [(1 + c) / 2 / a0, -(1 + c) / a0, (1 + c) / 2 / a0]
+        self.a = [-2 * c / a0, (1 - alpha) / a0]
+        self.x1 = self.x2 = self.y1 = self.y2 = 0.0
+
+    def process(self, x):
+        y = (self.b[0] * x + self.b[1] * self.x1 + self.b[2] * self.x2
+             - self.a[0] * self.y1 - self.a[1] * self.y2)
+        self.x2, self.x1, self.y2, self.y1 = self.x1, x, self.y1, y
+        return y
+
+
+class Welch:
+    """WelchPsd: averaged Hann periodograms and their 1-20 Hz peak"""
+
+    def __init__(self, fs):
+        self.bin_hz = fs / WELCH_SEGMENT
+        self.min_bin = max(2, math.ceil(WELCH_MIN_HZ / self.bin_hz))
+        self.max_bin = min(int(WELCH_MAX_HZ / self.bin_hz), WELCH_SEGMENT // 2 - 1)
+        self.window = [0.5 - 0.5 * math.cos(2 * math.pi * n / WELCH_SEGMENT)
+                       for n in range(WELCH_SEGMENT)]
+        self.ring = []
+        self.since_hop = 0
+        self.psd = [0.0] * (self.max_bin + 2)  # only the bins the search reads
+        self.segments = 0
+        self.peak_hz = 0.0
+
+    def push(self, x):
+        self.ring.append(x)
+        if len(self.ring) > WELCH_SEGMENT:
+            self.ring.pop(0)
+        self.since_hop += 1
+        if self.since_hop >= WELCH_HOP and len(self.ring) == WELCH_SEGMENT:
+            self.since_hop = 0
+            self.add_segment()
+
+    def add_segment(self):
+        segment = [x * w for x, w in zip(self.ring, self.window)]
+        if self.segments < WELCH_AVERAGES:
+            self.segments += 1
+        for k in range(len(self.psd)):
+            step = 2 * math.pi * k / WELCH_SEGMENT
+            re = sum(x * math.cos(step * n) for n, x in enumerate(segment))
+            im = sum(x * math.sin(step * n) for n, x in enumerate(segment))
+            self.psd[k] += (re * re + im * im - self.psd[k]) / self.segments
+        best = max(range(self.min_bin, self.max_bin + 1), key=lambda k: self.psd[k])
+        self.peak_hz = (best + peak_offset(self.psd, best)) * self.bin_hz
+
+
+def peak_offset(psd, k):
+    """welch.cpp peakOffset: parabola through the log powers"""
+    a, b, c = psd[k - 1], psd[k], psd[k + 1]
+    if a <= 0 or b <= 0 or c <= 0:
+        return 0.0
+    la, lb, lc = math.log(a), math.log(b), math.log(c)
+    curvature = la - 2 * lb + lc
+    if curvature >= 0:
+        return 0.0
+    return min(0.5, max(-0.5, 0.5 * (la - lc) / curvature))
+
+
+def device_windows(samples, window):
+    """The firmware's window features over one session, in DEVICE_FEATURES
+    order, from the first window with a Welch peak on"""
+    high_pass = HighPass(HIGH_PASS_HZ, SAMPLE_RATE)
+    welch = Welch(SAMPLE_RATE)
+    rows = []
+    for start in range(0, len(samples) - window + 1, window):
+        block = samples[start:start + window]
+        for x in block:
+            welch.push(high_pass.process(x))
+        mean = sum(abs(x) for x in block) / window
+        rms = math.sqrt(sum(x * x for x in block) / window)
+        if welch.peak_hz > 0:
+            rows.append([mean, rms, max(rms * rms - mean * mean, 0.0), welch.peak_hz])
+    return rows
+
+
+def load_features(raw_dir, window):
+    X, y = [], []
+    for label, _, samples in load_sessions(raw_dir):
+        for row in device_windows(samples, window):
+            X.append(row)
+            y.append(CLASSES.index(label))
+    return X, y
+
+
+def variance(values):
+    mean = sum(values) / len(values)
+    return sum((v - mean) ** 2 for v in values) / len(values)
+
+
+def fit(X, y):
+    """Per-class means and variances, log priors"""
+    n_features = len(X[0])
+    overall = [variance([x[j] for x in X]) for j in range(n_features)]
+    epsilon = VAR_SMOOTHING * max(overall)
+    model = {'mean': [], 'var': [], 'log_prior': []}
+    for k in range(len(CLASSES)):
+        rows = [x for x, label in zip(X, y) if label == k]
+        if not rows:
+            raise ValueError(f"no training rows for class '{CLASSES[k]}'")
+        model['mean'].append([sum(r[j] for r in rows) / len(rows) for j in range(n_features)])
+        model['var'].append([max(variance([r[j] for r in rows]), VAR_FLOOR * overall[j]) + epsilon
+                             for j in range(n_features)])
+        model['log_prior'].append(math.log(len(rows) / len(X)))
+    return model
+
+
+def log_joint(model, x):
+    scores = []
+    for k in range(len(CLASSES)):
+        score = model['log_prior'][k]
+        for j, value in enumerate(x):
+            var = model['var'][k][j]
+            score -= 0.5 * math.log(2 * math.pi * var) + (value - model['mean'][k][j]) ** 2 / (2 * var)
+        scores.append(score)
+    return scores
+
+
+def predict(model, x):
+    scores = log_joint(model, x)
+    return scores.index(max(scores))
+
+
+def stratified_folds(y, folds, seed=42):
+    """Row indices per fold, each class spread evenly"""
+    rng = random.Random(seed)
+    assignment = [[] for _ in range(folds)]
+    for k in range(len(CLASSES)):
+        rows = [i for i, label in enumerate(y) if label == k]
+        rng.shuffle(rows)
+        for n, i in enumerate(rows):
+            assignment[n % folds].append(i)
+    return assignment
+
+
+def cross_validate(X, y, folds):
+    """Out-of-fold naive Bayes predictions"""
+    predictions = [None] * len(y)
+    for test in stratified_folds(y, folds):
+        held_out = set(test)
+        train_X = [x for i, x in enumerate(X) if i not in held_out]
+        train_y = [label for i, label in enumerate(y) if i not in held_out]
+        model = fit(train_X, train_y)
+        for i in test:
+            predictions[i] = predict(model, X[i])
+    return predictions
+
+
+def forest_predictions(X, y, folds):
+    """Out-of-fold random forest predictions, or None without scikit-learn"""
+    try:
+        from sklearn.ensemble import RandomForestClassifier
+    except ImportError:
+        return None, 0
+    predictions = [None] * len(y)
+    nodes = []
+    for test in stratified_folds(y, folds):
+        held_out = set(test)
+        forest = RandomForestClassifier(n_estimators=FOREST_TREES, max_depth=FOREST_DEPTH,
+                                        random_state=42)
+        forest.fit([x for i, x in enumerate(X) if i not in held_out],
+                   [label for i, label in enumerate(y) if i not in held_out])
+        test_X = [X[i] for i in test]
+        for i, label in zip(test, forest.predict(test_X)):
+            predictions[i] = int(label)
+        # Decision nodes visited per prediction, summed over the trees
+        path = forest.decision_path(test_X)[0]
+        nodes.append(path.sum() / len(test) - FOREST_TREES)
+    return predictions, sum(nodes) / len(nodes)
+
+
+def accuracy(predictions, y):
+    return sum(p == label for p, label in zip(predictions, y)) / len(y)
+
+
+def c_float(value):
+    text = f'{value:.9g}'
+    # 1e+06f is a float literal, 35883215f is not
+    return text + ('f' if any(c in text for c in '.en') else '.0f')
+
+
+def c_array(values):
+    return ', '.join(c_float(v) for v in values)
+
+
+def write_header(path, model, used, source, cv_accuracy):
+    indices = [BACKEND_FEATURES.index(name) for name in used]
+    lines = [
+        '/*',
+        '  Gaussian Naive Bayes Model',
+        f'  Generated by backend/export_naive_bayes.py from {source}; do not edit.',
+        f'  Features: {", ".join(used)}.',
+        f'  Cross-validated accuracy: {cv_accuracy:.3f} ({FOLDS}-fold).',
+        '*/',
+        '',
+        '#pragma once',
+        '',
+        '#include <stdint.h>',
+        '',
+        f'#define NB_CLASSES {len(CLASSES)}',
+        f'#define NB_FEATURES {len(used)}',
+        '',
+        '// BackendFeature of each model input',
+        f'constexpr uint8_t NB_FEATURE_INDEX[NB_FEATURES] = {{{", ".join(map(str, indices))}}};',
+        '',
+        '// Per class: log prior minus the Gaussian normalizers',
+        f'constexpr float NB_LOG_NORM[NB_CLASSES] = {{{c_array(log_norm(model))}}};',
+        '',
+        'constexpr float NB_MEAN[NB_CLASSES][NB_FEATURES] = {',
+    ]
+    lines += [f'  {{{c_array(row)}}},  // {name}' for row, name in zip(model['mean'], CLASSES)]
+    lines += [
+        '};',
+        '',
+        '// 1 / (2 variance)',
+        'constexpr float NB_HALF_PRECISION[NB_CLASSES][NB_FEATURES] = {',
+    ]
+    lines += [f'  {{{c_array(0.5 / v for v in row)}}},  // {name}'
+              for row, name in zip(model['var'], CLASSES)]
+    lines += ['};', '']
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+def log_norm(model):
+    return [model['log_prior'][k] - 0.5 * sum(math.log(2 * math.pi * v) for v in model['var'][k])
+            for k in range(len(CLASSES))]
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description='Export a Gaussian naive Bayes model for the firmware')
+    parser.add_argument('--raw', default=os.path.join(here, 'data', 'raw'),
+                        help='recorded sessions, one directory per class')
+    parser.add_argument('--window', type=int, default=WINDOW_SIZE,
+                        help='device window size in samples')
+    parser.add_argument('--output', default=os.path.join(here, '..', 'include', 'naive_bayes_model.h'),
+                        help='header to write')
+    parser.add_argument('--compare', help='also write a CSV for host/model_compare')
+    args = parser.parse_args()
+
+    X_all, y = load_features(args.raw, args.window)
+    if not X_all:
+        print(f"❌ No labelled sessions in {args.raw}")
+        return 1
+
+    # Constant columns carry no information and have no variance to model
+    used = [name for j, name in enumerate(DEVICE_FEATURES)
+            if variance([x[j] for x in X_all]) > 0]
+    dropped = [name for name in DEVICE_FEATURES if name not in used]
+    X = [[x[DEVICE_FEATURES.index(name)] for name in used] for x in X_all]
+
+    folds = min(FOLDS, min(y.count(k) for k in range(len(CLASSES))))
+    if folds < 2:
+        print('❌ Every class needs at least two rows')
+        return 1
+    nb_cv = cross_validate(X, y, folds)
+    cv_accuracy = accuracy(nb_cv, y)
+
+    model = fit(X, y)
+    source = f'{os.path.relpath(args.raw, here)} ({args.window}-sample device windows)'
+    write_header(args.output, model, used, source, cv_accuracy)
+
+    print(f"📊 {len(X)} rows, classes {[y.count(k) for k in range(len(CLASSES))]}")
+    print(f"📋 Features: {', '.join(used)}" + (f" (constant, dropped: {', '.join(dropped)})" if dropped else ''))
+    print(f"🎯 Naive Bayes {folds}-fold accuracy: {cv_accuracy:.3f}")
+    print(f"💾 Model written to {os.path.normpath(args.output)}")
+
+    if args.compare:
+        forest, forest_nodes = forest_predictions(X, y, folds)
+        if forest is None:
+            print('ℹ️  scikit-learn not installed: no forest column')
+        else:
+            print(f"🌲 Forest {folds}-fold accuracy: {accuracy(forest, y):.3f}, "
+                  f"{forest_nodes:.0f} decision nodes per prediction")
+        with open(args.compare, 'w', newline='') as f:
+            writer = csv.writer(f)
+            writer.writerow(['label'] + BACKEND_FEATURES + ['forest'])
+            # Columns the device does not compute stay 0, as in backendFeatures()
+            for i, row in enumerate(X_all):
+                values = [row[DEVICE_FEATURES.index(name)] if name in DEVICE_FEATURES else 0
+                          for name in BACKEND_FEATURES]
+                writer.writerow([CLASSES[y[i]]] + values + [CLASSES[forest[i]] if forest else ''])
+        if forest:
+            print(f"   pass --forest-nodes {forest_nodes:.0f} to host/model_compare")
+        print(f"💾 Comparison rows written to {args.compare}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,514 @@
+/*
+  Async I/O Runtime (host)
+  A single-threaded event loop over epoll, with C++20 coroutines, so a
+  host daemon can serve many devices on one thread with linear code.
+
+    Task<T>     lazy coroutine; co_await runs it and yields its result
+    Scope       owns the tasks spawned into it (structured concurrency).
+                cancel() wakes every wait of its tasks and of nested
+                scopes, and later waits fail at once; join() waits until
+                all of its tasks have returned. A task that throws cancels
+                its siblings.
+    Wait        one suspension: an fd becoming readable or writable, a
+                timeout, a WaitQueue notification, or cancellation,
+                whichever comes first
+    Channel<T>  bounded queue between stages. send() suspends while it is
+                full, so a slow consumer holds back its producers
+                (backpressure), and receive() suspends while it is empty.
+
+  GCC 12 miscompiles a co_await inside an if/while condition (other than
+  a declaration), so results are bound to a variable first.
+
+  A scope must be joined before it is destroyed. At most one task may
+  wait on an fd at a time. Regular files cannot be polled, so waits on
+  them are ready at once. run() returns when nothing is left that an fd
+  or a timer could wake.
+*/
+
+#pragma once
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace async_io {
+
+class EventLoop;
+class Scope;
+class WaitQueue;
+
+// ---- Task ----
+
+namespace detail {
+
+struct PromiseBase {
+  std::coroutine_handle<> continuation = std::noop_coroutine();
+  std::exception_ptr error;
+
+  struct FinalAwaiter {
+    std::coroutine_handle<> continuation;
+    bool await_ready() noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept { return continuation; }
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {continuation}; }
+  void unhandled_exception() { error = std::current_exception(); }
+  void rethrow() const {
+    if (error) std::rethrow_exception(error);
+  }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+  std::optional<T> value;
+  void return_value(T v) { value.emplace(std::move(v)); }
+  T result() {
+    rethrow();
+    return std::move(*value);
+  }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  void return_void() {}
+  void result() { rethrow(); }
+};
+
+}  // namespace detail
+
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  struct promise_type : detail::Promise<T> {
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+  };
+
+  Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle) handle.destroy();
+      handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  ~Task() {
+    if (handle) handle.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    handle.promise().continuation = caller;
+    return handle;
+  }
+  T await_resume() { return handle.promise().result(); }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+  std::coroutine_handle<promise_type> handle;
+};
+
+// ---- Waits ----
+
+enum WaitResult { WAIT_READY, WAIT_TIMEOUT, WAIT_CANCELLED };
+
+struct Waiter {
+  std::coroutine_handle<> handle;
+  EventLoop* loop = nullptr;
+  Scope* scope = nullptr;  // nullptr: not cancellable
+  int fd = -1;             // polled, -1 = none
+  bool timed = false;
+  std::multimap<int64_t, Waiter*>::iterator timer;
+  WaitQueue* queue = nullptr;
+  WaitResult result = WAIT_READY;
+};
+
+// Tasks waiting for another task to signal them
+class WaitQueue {
+ public:
+  inline void notifyOne();
+  inline void notifyAll();
+
+ private:
+  friend class EventLoop;
+  friend class Wait;
+  std::deque<Waiter*> waiters;
+};
+
+class EventLoop {
+ public:
+  EventLoop() : epoll(epoll_create1(EPOLL_CLOEXEC)) {}
+  ~EventLoop() { ::close(epoll); }
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  static int64_t nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  void schedule(std::coroutine_handle<> h) { ready.push_back(h); }
+
+  void run() {
+    epoll_event events[64];
+    for (;;) {
+      while (!ready.empty()) {
+        std::coroutine_handle<> h = ready.front();
+        ready.pop_front();
+        h.resume();
+      }
+      if (polled == 0 && timers.empty()) return;
+
+      int timeout = -1;
+      if (!timers.empty()) {
+        timeout = (int)std::max<int64_t>(0, timers.begin()->first - nowMs());
+      }
+      int count = epoll_wait(epoll, events, 64, timeout);
+      for (int i = 0; i < count; i++) fire(*(Waiter*)events[i].data.ptr, WAIT_READY);
+      for (int64_t now = nowMs(); !timers.empty() && timers.begin()->first <= now;) {
+        fire(*timers.begin()->second, WAIT_TIMEOUT);
+      }
+    }
+  }
+
+ private:
+  friend class Wait;
+  friend class Scope;
+  friend class WaitQueue;
+
+  int epoll;
+  std::deque<std::coroutine_handle<>> ready;
+  std::multimap<int64_t, Waiter*> timers;  // by deadline
+  size_t polled = 0;
+
+  // False if the fd cannot be polled (a regular file): it is always ready
+  bool watch(Waiter& w, int fd, uint32_t events) {
+    epoll_event event = {};
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = &w;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) return false;
+    w.fd = fd;
+    polled++;
+    return true;
+  }
+
+  void arm(Waiter& w, int timeoutMs) {
+    w.timer = timers.emplace(nowMs() + timeoutMs, &w);
+    w.timed = true;
+  }
+
+  inline void fire(Waiter& w, WaitResult result);
+};
+
+// Awaitable for one suspension; see Scope::readable() and friends
+class Wait {
+ public:
+  Wait(EventLoop& loop, Scope* scope, int fd, uint32_t events, int timeoutMs, WaitQueue* queue)
+      : fd(fd), events(events), timeoutMs(timeoutMs), queue(queue) {
+    waiter.loop = &loop;
+    waiter.scope = scope;
+  }
+  Wait(const Wait&) = delete;
+
+  inline bool await_ready() const;
+  inline bool await_suspend(std::coroutine_handle<> h);
+  inline WaitResult await_resume() const;
+
+ private:
+  Waiter waiter;
+  int fd;
+  uint32_t events;
+  int timeoutMs;
+  WaitQueue* queue;
+  bool skipped = false;
+};
+
+// ---- Scope ----
+
+class Scope {
+ public:
+  explicit Scope(EventLoop& loop) : loop(loop) {}
+  explicit Scope(Scope& parent) : loop(parent.loop), parent(&parent) {
+    parent.children.push_back(this);
+    cancelledFlag = parent.cancelledFlag;
+  }
+  ~Scope() {
+    if (parent) parent->children.erase(std::find(parent->children.begin(),
+                                                 parent->children.end(), this));
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  EventLoop& eventLoop() { return loop; }
+  bool cancelled() const { return cancelledFlag; }
+  size_t active() const { return running; }
+
+  // Start a task owned by this scope; it first runs on the next loop turn
+  void spawn(Task<void> task) {
+    running++;  // counted now, so a join() before it starts waits for it
+    loop.schedule(run(std::move(task)).handle);
+  }
+
+  void cancel() {
+    cancelledFlag = true;
+    std::vector<Waiter*> woken(waiting.begin(), waiting.end());
+    for (Waiter* w : woken) loop.fire(*w, WAIT_CANCELLED);
+    for (Scope* child : std::vector<Scope*>(children)) child->cancel();
+  }
+
+  // Until every task of this scope has returned; not itself cancellable
+  Task<void> join() {
+    while (running > 0) co_await Wait(loop, nullptr, -1, 0, -1, &joined);
+  }
+
+  // Awaitables for the tasks of this scope; a timeout of -1 waits forever
+  Wait readable(int fd, int timeoutMs = -1) {
+    return Wait(loop, this, fd, EPOLLIN, timeoutMs, nullptr);
+  }
+  Wait writable(int fd, int timeoutMs = -1) {
+    return Wait(loop, this, fd, EPOLLOUT, timeoutMs, nullptr);
+  }
+  Wait sleep(int ms) { return Wait(loop, this, -1, 0, ms, nullptr); }
+  Wait wait(WaitQueue& queue, int timeoutMs = -1) {
+    return Wait(loop, this, -1, 0, timeoutMs, &queue);
+  }
+
+ private:
+  friend class EventLoop;
+  friend class Wait;
+
+  struct Runner {
+    struct promise_type {
+      Runner get_return_object() {
+        return {std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+  };
+
+  Runner run(Task<void> task) {
+    try {
+      co_await task;
+    } catch (const std::exception& e) {
+      std::fprintf(stderr, "async_io: task failed: %s\n", e.what());
+      cancel();
+    }
+    if (--running == 0) joined.notifyAll();
+  }
+
+  EventLoop& loop;
+  Scope* parent = nullptr;
+  std::vector<Scope*> children;
+  std::vector<Waiter*> waiting;
+  WaitQueue joined;
+  size_t running = 0;
+  bool cancelledFlag = false;
+};
+
+// ---- Out-of-line pieces that need Scope ----
+
+inline void EventLoop::fire(Waiter& w, WaitResult result) {
+  if (w.fd >= 0) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, w.fd, nullptr);
+    w.fd = -1;
+    polled--;
+  }
+  if (w.timed) {
+    timers.erase(w.timer);
+    w.timed = false;
+  }
+  if (w.queue) {
+    auto& list = w.queue->waiters;
+    list.erase(std::remove(list.begin(), list.end(), &w), list.end());
+    w.queue = nullptr;
+  }
+  if (w.scope) {
+    auto& list = w.scope->waiting;
+    list.erase(std::remove(list.begin(), list.end(), &w), list.end());
+  }
+  w.result = result;
+  schedule(w.handle);
+}
+
+inline void WaitQueue::notifyOne() {
+  if (!waiters.empty()) waiters.front()->loop->fire(*waiters.front(), WAIT_READY);
+}
+
+inline void WaitQueue::notifyAll() {
+  while (!waiters.empty()) notifyOne();
+}
+
+inline bool Wait::await_ready() const {
+  return waiter.scope && waiter.scope->cancelled();
+}
+
+inline bool Wait::await_suspend(std::coroutine_handle<> h) {
+  waiter.handle = h;
+  if (fd >= 0 && !waiter.loop->watch(waiter, fd, events)) {
+    skipped = true;
+    return false;
+  }
+  if (timeoutMs >= 0) waiter.loop->arm(waiter, timeoutMs);
+  if (queue) {
+    waiter.queue = queue;
+    queue->waiters.push_back(&waiter);
+  }
+  if (waiter.scope) waiter.scope->waiting.push_back(&waiter);
+  return true;
+}
+
+inline WaitResult Wait::await_resume() const {
+  if (skipped) return WAIT_READY;
+  if (waiter.scope && waiter.scope->cancelled() && !waiter.handle) return WAIT_CANCELLED;
+  return waiter.result;
+}
+
+// ---- Channel ----
+
+template <typename T>
+class Channel {
+ public:
+  explicit Channel(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+  size_t size() const { return items.size(); }
+  bool closed() const { return closedFlag; }
+  bool drained() const { return closedFlag && items.empty(); }
+
+  // Suspends while full; false once closed or cancelled (the value is dropped)
+  Task<bool> send(Scope& scope, T value) {
+    while (!closedFlag && items.size() >= capacity) {
+      WaitResult result = co_await scope.wait(notFull);
+      if (result == WAIT_CANCELLED) co_return false;
+    }
+    if (closedFlag) co_return false;
+    items.push_back(std::move(value));
+    notEmpty.notifyOne();
+    co_return true;
+  }
+
+  // Suspends while empty; nullopt on timeout, cancellation, or once
+  // closed and drained
+  Task<std::optional<T>> receive(Scope& scope, int timeoutMs = -1) {
+    while (items.empty() && !closedFlag) {
+      WaitResult result = co_await scope.wait(notEmpty, timeoutMs);
+      if (result != WAIT_READY) co_return std::nullopt;
+    }
+    if (items.empty()) co_return std::nullopt;
+    std::optional<T> value(std::move(items.front()));
+    items.pop_front();
+    notFull.notifyOne();
+    co_return value;
+  }
+
+  // Receivers drain what is queued, then see the end; senders fail
+  void close() {
+    closedFlag = true;
+    notEmpty.notifyAll();
+    notFull.notifyAll();
+  }
+
+ private:
+  size_t capacity;
+  std::deque<T> items;
+  WaitQueue notEmpty, notFull;
+  bool closedFlag = false;
+};
+
+// ---- fd helpers ----
+
+inline bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Bytes read, 0 at end of file, -1 with errno (ECANCELED, ETIMEDOUT, ...)
+inline Task<ssize_t> readSome(Scope& scope, int fd, void* buffer, size_t size,
+                              int timeoutMs = -1) {
+  for (;;) {
+    ssize_t n = ::read(fd, buffer, size);
+    if (n >= 0 || (errno != EAGAIN && errno != EINTR)) co_return n;
+    if (errno == EINTR) continue;
+    WaitResult result = co_await scope.readable(fd, timeoutMs);
+    if (result != WAIT_READY) {
+      errno = result == WAIT_CANCELLED ? ECANCELED : ETIMEDOUT;
+      co_return -1;
+    }
+  }
+}
+
+// False with errno if not everything was written
+inline Task<bool> writeAll(Scope& scope, int fd, const void* data, size_t size,
+                           int timeoutMs = -1) {
+  const char* cursor = (const char*)data;
+  while (size > 0) {
+    ssize_t n = ::write(fd, cursor, size);
+    if (n > 0) {
+      cursor += n;
+      size -= n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno != EAGAIN) co_return false;
+    WaitResult result = co_await scope.writable(fd, timeoutMs);
+    if (result != WAIT_READY) {
+      errno = result == WAIT_CANCELLED ? ECANCELED : ETIMEDOUT;
+      co_return false;
+    }
+  }
+  co_return true;
+}
+
+// Connected non-blocking TCP socket, -1 on failure. Name lookup blocks.
+inline Task<int> connectTcp(Scope& scope, const char* host, const char* port, int timeoutMs) {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  if (getaddrinfo(host, port, &hints, &addresses) != 0) co_return -1;
+
+  int fd = -1;
+  for (addrinfo* a = addresses; a && fd < 0; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      int error = errno;
+      WaitResult result = WAIT_CANCELLED;
+      if (error == EINPROGRESS) result = co_await scope.writable(fd, timeoutMs);
+      if (result == WAIT_READY) {
+        socklen_t length = sizeof(error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+      }
+      if (error != 0) {
+        ::close(fd);
+        fd = -1;
+        if (error == EINPROGRESS) break;  // timed out or cancelled
+      }
+    }
+  }
+  freeaddrinfo(addresses);
+  co_return fd;
+}
+
+}  // namespace async_io
@@ -0,0 +1,161 @@
+/*
+  Cycle Budget Planner (host)
+  Evaluates a proposed firmware configuration with the same cost model the
+  firmware static_asserts against, before anything is flashed.
+
+  Build: g++ -std=c++17 -I../include budget_plan.cpp -o budget_plan
+  Usage: budget_plan --channels 2 --rate 500 --window 64 --features 4
+                     --model rules|eog|nb --telemetry text|binary|events|json
+                     [--batch] [--baud 115200] [--cores A,N,T]
+                     [--aux N] [--fft N --fft-rate SEGMENTS_PER_S]
+                     [--psd N --psd-hop SAMPLES] [--ale TAPS]
+                     [--imu BYTES_PER_S --imu-burst BYTES] [--context SECTIONS]
+                     [--prototypes N] [--no-anomaly]
+  Exits 1 when the configuration exceeds the real-time budget.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "cycle_budget.h"
+#include "pipeline_budget.h"
+
+using namespace cycle_budget;
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: budget_plan [--channels N] [--rate HZ] [--window N] [--features N]\n"
+               "                   [--model rules|eog|nb] [--telemetry text|binary|events|json]\n"
+               "                   [--batch] [--baud BAUD] [--cores ACQ,ANALYSIS,TX]\n"
+               "                   [--aux N] [--fft N --fft-rate SEGMENTS_PER_S]\n"
+               "                   [--psd N --psd-hop SAMPLES] [--ale TAPS]\n"
+               "                   [--imu BYTES_PER_S --imu-burst BYTES] [--context SECTIONS]\n"
+               "                   [--prototypes N] [--no-anomaly]\n");
+}
+
+static bool parseArgs(int argc, char** argv, PipelineConfig& cfg) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (std::strcmp(arg, "--batch") == 0) {
+      cfg.streamingFeatures = false;
+      continue;
+    }
+    if (std::strcmp(arg, "--no-anomaly") == 0) {
+      cfg.anomalyScore = false;
+      continue;
+    }
+    if (!value) return false;
+    i++;
+
+    if (std::strcmp(arg, "--channels") == 0) {
+      cfg.channels = std::atoi(value);
+    } else if (std::strcmp(arg, "--rate") == 0) {
+      cfg.sampleRate = std::atoi(value);
+    } else if (std::strcmp(arg, "--window") == 0) {
+      cfg.windowSize = std::atoi(value);
+    } else if (std::strcmp(arg, "--features") == 0) {
+      cfg.features = std::atoi(value);
+    } else if (std::strcmp(arg, "--aux") == 0) {
+      cfg.auxChannels = std::atoi(value);
+    } else if (std::strcmp(arg, "--fft") == 0) {
+      cfg.fftSize = std::atoi(value);
+    } else if (std::strcmp(arg, "--fft-rate") == 0) {
+      cfg.fftPerSecond = std::atof(value);
+    } else if (std::strcmp(arg, "--psd") == 0) {
+      cfg.psdSize = std::atoi(value);
+    } else if (std::strcmp(arg, "--psd-hop") == 0) {
+      cfg.psdHop = std::atoi(value);
+    } else if (std::strcmp(arg, "--ale") == 0) {
+      cfg.adaptiveTaps = std::atoi(value);
+    } else if (std::strcmp(arg, "--imu") == 0) {
+      cfg.imuBusBytes = std::atoi(value);
+    } else if (std::strcmp(arg, "--imu-burst") == 0) {
+      cfg.imuBurstBytes = std::atoi(value);
+    } else if (std::strcmp(arg, "--context") == 0) {
+      cfg.contextFilters = std::atoi(value);
+    } else if (std::strcmp(arg, "--prototypes") == 0) {
+      cfg.prototypes = std::atoi(value);
+    } else if (std::strcmp(arg, "--baud") == 0) {
+      cfg.baudRate = std::atol(value);
+    } else if (std::strcmp(arg, "--model") == 0) {
+      if (std::strcmp(value, "rules") == 0) cfg.model = MODEL_RULES;
+      else if (std::strcmp(value, "eog") == 0) cfg.model = MODEL_EOG_EVENTS;
+      else if (std::strcmp(value, "nb") == 0) cfg.model = MODEL_NAIVE_BAYES;
+      else return false;
+    } else if (std::strcmp(arg, "--telemetry") == 0) {
+      if (std::strcmp(value, "text") == 0) cfg.telemetry = TELEMETRY_TEXT;
+      else if (std::strcmp(value, "binary") == 0) cfg.telemetry = TELEMETRY_BINARY;
+      else if (std::strcmp(value, "events") == 0) cfg.telemetry = TELEMETRY_EVENTS_ONLY;
+      else if (std::strcmp(value, "json") == 0) cfg.telemetry = TELEMETRY_JSON;
+      else return false;
+    } else if (std::strcmp(arg, "--cores") == 0) {
+      unsigned a, n, t;
+      if (std::sscanf(value, "%u,%u,%u", &a, &n, &t) != 3) return false;
+      if (a >= CORE_COUNT || n >= CORE_COUNT || t >= CORE_COUNT) return false;
+      cfg.acquisitionCore = a;
+      cfg.analysisCore = n;
+      cfg.telemetryCore = t;
+    } else {
+      return false;
+    }
+  }
+  return cfg.channels > 0 && cfg.sampleRate > 0 && cfg.windowSize > 0 && cfg.baudRate > 0;
+}
+
+int main(int argc, char** argv) {
+  // Defaults are the shipped firmware's tremor pipeline
+  PipelineConfig cfg = TREMOR_PIPELINE;
+  if (!parseArgs(argc, argv, cfg)) {
+    usage();
+    return 2;
+  }
+
+  Prediction p = predict(cfg);
+  bool cores = coresWithinBudget(p);
+  bool latency = latencyWithinBudget(p);
+  bool link = linkWithinBudget(p);
+
+  std::printf("Configuration: %u ch @ %u Hz, window %u, %u features, %s features\n",
+              cfg.channels, cfg.sampleRate, cfg.windowSize, cfg.features,
+              cfg.streamingFeatures ? "streaming" : "batch");
+  if (cfg.auxChannels || cfg.fftSize) {
+    std::printf("Auxiliary channels: %u, spectra: %u points x %.2f/s\n",
+                cfg.auxChannels, cfg.fftSize, cfg.fftPerSecond);
+  }
+  if (cfg.psdSize) {
+    std::printf("Staged PSD: %u points every %u samples\n", cfg.psdSize, cfg.psdHop);
+  }
+  if (cfg.adaptiveTaps) {
+    std::printf("Line enhancer: %u taps\n", cfg.adaptiveTaps);
+  }
+  if (cfg.imuBusBytes) {
+    std::printf("Accelerometer: %u B/s over I2C, bursts of %u B\n",
+                cfg.imuBusBytes, cfg.imuBurstBytes);
+  }
+  if (cfg.contextFilters) {
+    std::printf("Motor context: %u filter sections\n", cfg.contextFilters);
+  }
+  if (cfg.prototypes) {
+    std::printf("Patient prototypes: %u searched per window\n", cfg.prototypes);
+  }
+  if (cfg.anomalyScore) {
+    std::printf("Anomaly score: every window\n");
+  }
+  for (int core = 0; core < CORE_COUNT; core++) {
+    std::printf("Core %d load:        %6.2f %%  (limit %.0f %%)\n",
+                core, p.coreLoad[core] * 100, MAX_CORE_LOAD * 100);
+  }
+  std::printf("Worst-case latency: %8.1f us (sample period %.1f us)\n",
+              p.worstCaseLatencyUs, p.samplePeriodUs);
+  std::printf("Link bandwidth:     %8.0f B/s (%.1f %% of %lu baud, limit %.0f %%)\n",
+              p.linkBytesPerSec, p.linkLoad * 100, (unsigned long)cfg.baudRate, MAX_LINK_LOAD * 100);
+
+  if (!cores) std::printf("OVER BUDGET: CPU load\n");
+  if (!latency) std::printf("OVER BUDGET: window work exceeds one sample period\n");
+  if (!link) std::printf("OVER BUDGET: serial link bandwidth\n");
+  if (cores && latency && link) std::printf("Within real-time budget\n");
+  return cores && latency && link ? 0 : 1;
+}
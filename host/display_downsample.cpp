@@ -0,0 +1,82 @@
+/*
+  Display Downsampler (host)
+  Runs a recorded sample stream through the same LTTB / min-max reducers
+  the firmware uses, for dashboards replaying sessions or for checking a
+  display rate before setting it on the device.
+
+  Build: g++ -std=c++17 -I../include display_downsample.cpp -o display_downsample
+  Usage: display_downsample --mode lttb|minmax --bucket N [--column C] < samples.csv
+  Input lines are comma separated (e.g. the firmware's "voltage,filtered"
+  stream); column C (default 1, the filtered value) is downsampled.
+  Lines that do not parse are skipped. Output: "index,value" per point.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "downsample.h"
+
+static void usage() {
+  std::fprintf(stderr, "usage: display_downsample --mode lttb|minmax --bucket N [--column C] < in.csv\n");
+}
+
+// Value of the given comma separated column, false if missing
+static bool parseColumn(const char* line, int column, float& value) {
+  for (int c = 0; c < column; c++) {
+    line = std::strchr(line, ',');
+    if (!line) return false;
+    line++;
+  }
+  char* end;
+  value = std::strtof(line, &end);
+  return end != line;
+}
+
+int main(int argc, char** argv) {
+  bool lttbMode = true;
+  int bucket = 8;
+  int column = 1;
+
+  bool valid = argc % 2 == 1;
+  for (int i = 1; valid && i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--mode") == 0) {
+      lttbMode = std::strcmp(argv[i + 1], "lttb") == 0;
+      valid = lttbMode || std::strcmp(argv[i + 1], "minmax") == 0;
+    } else if (std::strcmp(argv[i], "--bucket") == 0) {
+      bucket = std::atoi(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "--column") == 0) {
+      column = std::atoi(argv[i + 1]);
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid || bucket < 2 || bucket > DOWNSAMPLE_MAX_BUCKET || column < 0) {
+    usage();
+    return 2;
+  }
+
+  static LttbDownsampler lttb;
+  MinMaxDownsampler minMax;
+  lttb.bucketSize = bucket;
+  minMax.bucketSize = bucket;
+
+  char line[256];
+  unsigned long samples = 0, points = 0;
+  while (std::fgets(line, sizeof(line), stdin)) {
+    float value;
+    if (!parseColumn(line, column, value)) continue;
+    samples++;
+
+    DisplayPoint out[2];
+    int count = lttbMode ? (lttb.push(value, out[0]) ? 1 : 0) : minMax.push(value, out);
+    for (int i = 0; i < count; i++) {
+      std::printf("%lu,%.4f\n", (unsigned long)out[i].index, out[i].value);
+    }
+    points += count;
+  }
+
+  std::fprintf(stderr, "%lu samples -> %lu points (%.1fx)\n",
+               samples, points, points ? (double)samples / points : 0.0);
+  return 0;
+}
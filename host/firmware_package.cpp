@@ -0,0 +1,210 @@
+/*
+  Firmware Package Tool (host)
+  Builds the signed, compressed update packages that ingest_daemon
+  --update streams to devices (include/ota_update.h, firmware_package.h).
+
+  Build: g++ -std=c++17 -O2 -I../include firmware_package.cpp -o firmware_package -lcrypto -lz
+  Usage: firmware_package keygen KEY.pem > ../include/ota_key.h
+         firmware_package sign KEY.pem .pio/build/esp32dev/firmware.bin OUT.npfw
+         firmware_package info PACKAGE.npfw [KEY.pem]
+  keygen writes a new ECDSA P-256 private key (mode 0600) and prints the
+  ota_key.h that makes a build accept packages signed with it. sign
+  splits the image into OTA_BLOCK_SIZE blocks, deflates each on its own
+  so the device inflates a block without a dictionary window, and signs
+  the manifest. info prints a package and, given a key (private or
+  public PEM), checks its signature.
+*/
+
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "firmware_package.h"
+
+using namespace firmware_package;
+
+constexpr uint8_t ESP_IMAGE_MAGIC = 0xE9;
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: firmware_package keygen KEY.pem > include/ota_key.h\n"
+               "       firmware_package sign KEY.pem firmware.bin OUT.npfw\n"
+               "       firmware_package info PACKAGE.npfw [KEY.pem]\n");
+}
+
+static bool readFile(const char* path, std::string& data) {
+  FILE* file = std::fopen(path, "rb");
+  if (!file) return false;
+  char buffer[65536];
+  size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, n);
+  bool ok = !std::ferror(file);
+  std::fclose(file);
+  return ok;
+}
+
+// Private key, or with allowPublic a public one
+static EVP_PKEY* readKey(const char* path, bool allowPublic) {
+  std::string pem;
+  if (!readFile(path, pem)) return nullptr;
+  BIO* bio = BIO_new_mem_buf(pem.data(), (int)pem.size());
+  EVP_PKEY* key = PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
+  if (!key && allowPublic) {
+    BIO_reset(bio);
+    key = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+  }
+  BIO_free(bio);
+  return key;
+}
+
+static bool sha256(const void* data, size_t length, uint8_t digest[32]) {
+  unsigned size = 32;
+  return EVP_Digest(data, length, digest, &size, EVP_sha256(), nullptr) == 1;
+}
+
+static int keygen(const char* path) {
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  int fd = key ? open(path, O_WRONLY | O_CREAT | O_EXCL, 0600) : -1;
+  FILE* file = fd >= 0 ? fdopen(fd, "w") : nullptr;
+  bool ok = file && PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+  if (file) ok = std::fclose(file) == 0 && ok;
+  BIO* bio = BIO_new(BIO_s_mem());
+  ok = ok && PEM_write_bio_PUBKEY(bio, key) == 1;
+  char* text = nullptr;
+  long length = BIO_get_mem_data(bio, &text);
+  std::string pem(text ? text : "", ok ? length : 0);
+  BIO_free(bio);
+  EVP_PKEY_free(key);
+  if (!ok) {
+    std::fprintf(stderr, "%s: %s\n", path,
+                 fd < 0 && errno == EEXIST ? "exists, not overwritten" : "key generation failed");
+    return 1;
+  }
+
+  std::printf("/*\n"
+              "  Firmware Update Signing Key\n"
+              "  Public half of the ECDSA P-256 key whose packages this build accepts\n"
+              "  (ota_update.h), generated by firmware_package keygen.\n"
+              "*/\n\n"
+              "#pragma once\n\n"
+              "#define OTA_PUBLIC_KEY_PEM \\\n");
+  for (size_t start = 0, end; (end = pem.find('\n', start)) != std::string::npos;
+       start = end + 1) {
+    std::printf("  \"%s\\n\"%s\n", pem.substr(start, end - start).c_str(),
+                end + 1 < pem.size() ? " \\" : "");
+  }
+  std::fprintf(stderr, "Private key in %s; keep it off the devices\n", path);
+  return 0;
+}
+
+// One block as raw deflate, on its own
+static bool deflateBlock(const uint8_t* data, size_t length, std::string& out) {
+  z_stream stream = {};
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out.resize(deflateBound(&stream, length));
+  stream.next_in = (Bytef*)data;
+  stream.avail_in = length;
+  stream.next_out = (Bytef*)out.data();
+  stream.avail_out = out.size();
+  bool ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return ok && out.size() <= OTA_CHUNK_MAX;
+}
+
+static int sign(const char* keyPath, const char* imagePath, const char* outPath) {
+  EVP_PKEY* key = readKey(keyPath, false);
+  if (!key) {
+    std::fprintf(stderr, "%s: not a private key\n", keyPath);
+    return 1;
+  }
+  std::string image;
+  if (!readFile(imagePath, image) || image.empty() || (uint8_t)image[0] != ESP_IMAGE_MAGIC) {
+    std::fprintf(stderr, "%s: not an ESP32 application image\n", imagePath);
+    EVP_PKEY_free(key);
+    return 1;
+  }
+
+  Package package;
+  OtaManifest& m = package.manifest;
+  m.magic = OTA_MANIFEST_MAGIC;
+  m.version = OTA_MANIFEST_VERSION;
+  m.blockSize = OTA_BLOCK_SIZE;
+  m.imageSize = image.size();
+  m.blockCount = (m.imageSize + OTA_BLOCK_SIZE - 1) / OTA_BLOCK_SIZE;
+  bool ok = sha256(image.data(), image.size(), m.sha256);
+  size_t compressed = 0;
+  for (uint32_t i = 0; ok && i < m.blockCount; i++) {
+    size_t offset = (size_t)i * OTA_BLOCK_SIZE;
+    std::string block;
+    ok = deflateBlock((const uint8_t*)image.data() + offset,
+                      std::min<size_t>(OTA_BLOCK_SIZE, image.size() - offset), block);
+    compressed += block.size();
+    package.blocks.push_back(std::move(block));
+  }
+
+  EVP_MD_CTX* context = EVP_MD_CTX_new();
+  size_t signatureLength = sizeof(m.signature);
+  ok = ok && EVP_DigestSignInit(context, nullptr, EVP_sha256(), nullptr, key) == 1 &&
+       EVP_DigestSign(context, m.signature, &signatureLength, (const uint8_t*)&m,
+                      OTA_SIGNED_BYTES) == 1;
+  m.signatureLength = (uint8_t)signatureLength;
+  EVP_MD_CTX_free(context);
+  EVP_PKEY_free(key);
+  if (!ok || !writePackage(outPath, package)) {
+    std::fprintf(stderr, "%s: packaging failed\n", outPath);
+    return 1;
+  }
+  std::printf("%s: %u bytes in %u blocks, %zu compressed (%.0f%%)\n", outPath, m.imageSize,
+              m.blockCount, compressed, 100.0 * compressed / m.imageSize);
+  return 0;
+}
+
+static int info(const char* path, const char* keyPath) {
+  Package package;
+  std::string error;
+  if (!readPackage(path, package, error)) {
+    std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+    return 1;
+  }
+  const OtaManifest& m = package.manifest;
+  size_t compressed = 0;
+  for (const std::string& block : package.blocks) compressed += block.size();
+  std::printf("Image: %u bytes in %u blocks of %u, %zu compressed\nSHA-256: ", m.imageSize,
+              m.blockCount, m.blockSize, compressed);
+  for (uint8_t byte : m.sha256) std::printf("%02x", byte);
+  std::printf("\n");
+  if (!keyPath) return 0;
+
+  EVP_PKEY* key = readKey(keyPath, true);
+  EVP_MD_CTX* context = EVP_MD_CTX_new();
+  bool valid = key && EVP_DigestVerifyInit(context, nullptr, EVP_sha256(), nullptr, key) == 1 &&
+               EVP_DigestVerify(context, m.signature, m.signatureLength, (const uint8_t*)&m,
+                                OTA_SIGNED_BYTES) == 1;
+  EVP_MD_CTX_free(context);
+  EVP_PKEY_free(key);
+  std::printf("Signature: %s\n", valid ? "valid" : "INVALID");
+  return valid ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  const char* command = argc > 1 ? argv[1] : "";
+  if (std::strcmp(command, "keygen") == 0 && argc == 3) return keygen(argv[2]);
+  if (std::strcmp(command, "sign") == 0 && argc == 5) return sign(argv[2], argv[3], argv[4]);
+  if (std::strcmp(command, "info") == 0 && (argc == 3 || argc == 4)) {
+    return info(argv[2], argc == 4 ? argv[3] : nullptr);
+  }
+  usage();
+  return 2;
+}
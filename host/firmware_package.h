@@ -0,0 +1,77 @@
+/*
+  Firmware Package (host)
+  The signed, compressed update file of include/ota_update.h, as written
+  by firmware_package and streamed by ingest_daemon --update:
+
+    OtaManifest
+    per block: uint32 length, then that many bytes of raw deflate
+
+  Little-endian, as the device reads the manifest. crc32() is the
+  firmware's CRC-32, which checks every payload sent to the device.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ota_update.h"
+
+namespace firmware_package {
+
+inline uint32_t crc32(const void* data, size_t length, uint32_t crc = 0) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+struct Package {
+  OtaManifest manifest = {};
+  std::vector<std::string> blocks;  // compressed
+};
+
+inline bool readPackage(const char* path, Package& package, std::string& error) {
+  FILE* file = std::fopen(path, "rb");
+  if (!file) {
+    error = "cannot open";
+    return false;
+  }
+  OtaManifest& m = package.manifest;
+  bool ok = std::fread(&m, sizeof(m), 1, file) == 1 && m.magic == OTA_MANIFEST_MAGIC &&
+            m.version == OTA_MANIFEST_VERSION && m.blockSize == OTA_BLOCK_SIZE &&
+            m.blockCount == (m.imageSize + OTA_BLOCK_SIZE - 1) / OTA_BLOCK_SIZE;
+  error = "not a firmware package";
+  package.blocks.clear();
+  for (uint32_t i = 0; ok && i < m.blockCount; i++) {
+    uint32_t length;
+    ok = std::fread(&length, sizeof(length), 1, file) == 1 && length > 0 &&
+         length <= OTA_CHUNK_MAX;
+    std::string block(ok ? length : 0, '\0');
+    ok = ok && std::fread(block.data(), 1, length, file) == length;
+    if (ok) package.blocks.push_back(std::move(block));
+    else error = "block " + std::to_string(i) + " truncated or oversized";
+  }
+  ok = ok && std::fgetc(file) == EOF;
+  std::fclose(file);
+  return ok;
+}
+
+inline bool writePackage(const char* path, const Package& package) {
+  FILE* file = std::fopen(path, "wb");
+  if (!file) return false;
+  bool ok = std::fwrite(&package.manifest, sizeof(package.manifest), 1, file) == 1;
+  for (const std::string& block : package.blocks) {
+    uint32_t length = block.size();
+    ok = ok && std::fwrite(&length, sizeof(length), 1, file) == 1 &&
+         std::fwrite(block.data(), 1, block.size(), file) == block.size();
+  }
+  return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace firmware_package
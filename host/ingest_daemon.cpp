@@ -0,0 +1,675 @@
+/*
+  Ingest Daemon (host)
+  Serves any number of devices from one thread on the async runtime
+  (async_io.h). Each serial port runs as a chain of stages joined by
+  bounded channels:
+
+    read lines -> decode CLASSIFICATION -> store (record_store.h, rollups)
+                                        -> POST to the API (optional)
+
+  A full channel suspends the stage feeding it, so a slow disk or API
+  slows the readers instead of growing a queue. The API stage drops
+  records while the API is unreachable (retrying every API_RETRY_MS), so
+  an outage does not stall storage. Windows with poor signal are stored
+  but not posted, as in serial_reader.py. A BOOT line or the port closing
+  ends the device's last class in the rollups at the last line heard.
+
+  With --reliable, each serial port is switched to framed events
+  (reliable_link.h): frames are checked, duplicates dropped, and an
+  "ack" goes back within ACK_DELAY_MS of the last frame, so the device
+  resends only what was lost. Records keep the device's own time. The
+  ports are switched back to plain lines at exit, and again after the
+  device reports a reboot.
+
+  With --update, the package from firmware_package is streamed to each
+  writable serial port alongside ingestion (ota_update.h): one block at a
+  time, each sent once the previous one is in flash, resuming where the
+  device says it stopped after a timeout or a reset. The verified image
+  is applied; the device restarts into it and reports "OTA:" lines.
+
+  The first SIGINT/SIGTERM stops the readers; what has been read is still
+  decoded, stored and posted before the daemon exits. A second one
+  cancels everything still waiting. Segments and rollups are flushed
+  every STORE_FLUSH_MS and at exit. Disk writes are synchronous (regular
+  files cannot be polled), so the store stage runs them between waits.
+
+  Build: g++ -std=c++20 -O2 -I../include ingest_daemon.cpp -o ingest_daemon
+  Usage: ingest_daemon DIR [--api http://HOST[:PORT]/PATH] [--queue N] [--reliable]
+                       [--update PACKAGE.npfw] PORT[=DEVICE]...
+  PORT is a serial device (set to 115200 baud, raw), a FIFO, a file, or
+  "-" for stdin. DEVICE defaults to the port's file name.
+*/
+
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <termios.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "async_io.h"
+#include "firmware_package.h"
+#include "record_store.h"
+#include "reliable_link.h"
+#include "rollup_index.h"
+
+using namespace async_io;
+using namespace record_store;
+
+constexpr int STORE_FLUSH_MS = 5 * 60 * 1000;
+constexpr int API_TIMEOUT_MS = 5000;
+constexpr int API_RETRY_MS = 10000;
+constexpr size_t MAX_LINE = 1024;
+constexpr float SQI_GATE = 0.5f;  // matches the firmware's signal quality gate
+constexpr int ACK_DELAY_MS = 50;  // acknowledgements coalesced over this long
+constexpr int WRITE_TIMEOUT_MS = 5000;
+constexpr int UPDATE_REPLY_MS = 10000;   // a block's flash write, or the signature check
+constexpr int UPDATE_VERIFY_MS = 60000;  // the device reading the whole image back
+constexpr int UPDATE_ATTEMPTS = 5;       // per block, and sessions per update
+constexpr int UPDATE_RETRY_MS = 5000;
+
+struct Sample {
+  std::string device;
+  Record record;
+  bool stopped = false;  // no record: the device stopped after record.timestampMs
+};
+
+struct Source {
+  std::string path, device;
+  int fd = -1;
+  int writeFd = -1;           // a dup of fd: only one task may wait on an fd
+  bool acknowledged = false;  // reliable delivery on a port we can write to
+  bool updating = false;      // firmware update on a port we can write to
+  Channel<std::string> lines;
+  reliable_link::Receiver receiver;
+  WaitQueue ackDue;
+  bool ackPending = false;
+  bool enablePending = true;
+  bool ended = false;
+  bool writing = false;
+  WaitQueue writeIdle;
+  std::string otaReply;  // last "OK ota"/"ERR ota" line
+  WaitQueue otaReplied;
+  std::string updateResult = "not started";
+  explicit Source(size_t capacity) : lines(capacity) {}
+
+  void requestAck() {
+    ackPending = true;
+    ackDue.notifyOne();
+  }
+};
+
+struct ApiUrl {
+  std::string host, port = "80", path = "/";
+};
+
+struct Counters {
+  unsigned long lines = 0, stored = 0, rejected = 0, posted = 0, dropped = 0;
+  unsigned long corrupt = 0;  // frames failing their CRC
+};
+
+static void usage() {
+  std::fprintf(stderr, "usage: ingest_daemon DIR [--api http://HOST[:PORT]/PATH] [--queue N] "
+                       "[--reliable]\n"
+                       "                     [--update PACKAGE.npfw] PORT[=DEVICE]...\n");
+}
+
+static int64_t wallMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static bool parseUrl(const char* text, ApiUrl& url) {
+  const char* scheme = "http://";
+  if (std::strncmp(text, scheme, std::strlen(scheme)) != 0) return false;
+  std::string rest = text + std::strlen(scheme);
+  size_t slash = rest.find('/');
+  std::string authority = rest.substr(0, slash);
+  if (slash != std::string::npos) url.path = rest.substr(slash);
+  size_t colon = authority.rfind(':');
+  url.host = authority.substr(0, colon);
+  if (colon != std::string::npos) url.port = authority.substr(colon + 1);
+  return !url.host.empty() && !url.port.empty();
+}
+
+static int openSource(const std::string& path, bool writable) {
+  int flags = (writable ? O_RDWR : O_RDONLY) | O_NOCTTY | O_CLOEXEC;
+  int fd = path == "-" ? STDIN_FILENO : open(path.c_str(), flags);
+  if (fd < 0 && writable) fd = open(path.c_str(), O_RDONLY | O_NOCTTY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  if (isatty(fd)) {
+    termios tty;
+    if (tcgetattr(fd, &tty) == 0) {
+      cfmakeraw(&tty);
+      cfsetspeed(&tty, B115200);
+      tcsetattr(fd, TCSANOW, &tty);
+    }
+  }
+  setNonBlocking(fd);
+  return fd;
+}
+
+// ---- Stages ----
+
+static Task<void> readLines(Scope& scope, Source& source) {
+  char buffer[4096];
+  std::string pending;
+  for (bool open = true; open;) {
+    ssize_t n = co_await readSome(scope, source.fd, buffer, sizeof(buffer));
+    if (n < 0 && errno != ECANCELED) {
+      std::fprintf(stderr, "%s: %s\n", source.path.c_str(), std::strerror(errno));
+    }
+    if (n <= 0) break;
+    pending.append(buffer, n);
+    size_t start = 0;
+    for (size_t end; open && (end = pending.find('\n', start)) != std::string::npos;
+         start = end + 1) {
+      open = co_await source.lines.send(scope, pending.substr(start, end - start));
+    }
+    pending.erase(0, start);
+    if (pending.size() > MAX_LINE) pending.clear();  // not a line-oriented stream
+  }
+  source.lines.close();
+  source.ended = true;
+  source.ackDue.notifyAll();
+  source.otaReplied.notifyAll();
+}
+
+// One writer at a time, so an ack never lands inside an update payload
+static Task<bool> writeDevice(Scope& scope, Source& source, const std::string& data) {
+  while (source.writing) {
+    WaitResult result = co_await scope.wait(source.writeIdle);
+    if (result == WAIT_CANCELLED) co_return false;
+  }
+  source.writing = true;
+  bool written =
+      co_await writeAll(scope, source.writeFd, data.data(), data.size(), WRITE_TIMEOUT_MS);
+  source.writing = false;
+  source.writeIdle.notifyOne();
+  co_return written;
+}
+
+// Turns framing on, then acknowledges what decode() accepted
+static Task<void> acknowledge(Scope& scope, Source& source) {
+  while (!source.ended) {
+    if (!source.ackPending && !source.enablePending) {
+      WaitResult result = co_await scope.wait(source.ackDue);
+      if (result == WAIT_CANCELLED) break;
+      continue;
+    }
+    if (source.ackPending) {
+      WaitResult result = co_await scope.sleep(ACK_DELAY_MS);
+      if (result == WAIT_CANCELLED) break;
+    }
+    std::string message = source.enablePending ? "reliable on\r\n" : "";
+    if (source.ackPending) message += source.receiver.ack();
+    source.enablePending = source.ackPending = false;
+    bool written = co_await writeDevice(scope, source, message);
+    if (!written && errno != ECANCELED) {
+      std::fprintf(stderr, "%s: acknowledgement failed: %s\n", source.path.c_str(),
+                   std::strerror(errno));
+    }
+    if (!written) break;
+  }
+}
+
+// Replies for updateFirmware(), and the device's own update reports
+static void noteUpdateLine(Source& source, const char* text) {
+  std::string line(text, std::strcspn(text, "\r"));
+  if (line.rfind("OK ota ", 0) == 0 || line.rfind("ERR ota", 0) == 0 ||
+      line.rfind("ERR payload", 0) == 0) {
+    source.otaReply = line;
+    source.otaReplied.notifyAll();
+  } else if (line.rfind("OTA:", 0) == 0) {
+    std::printf("%s: %s\n", source.device.c_str(), line.c_str());
+  }
+}
+
+// Frames released in sequence order, with their device time
+static void unframe(Source& source, char* text, int64_t receivedMs,
+                    std::vector<std::pair<std::string, int64_t>>& lines, Counters& counters) {
+  reliable_link::Frame frame;
+  if (!reliable_link::parseFrame(text, frame)) {
+    counters.corrupt++;
+    return;
+  }
+  source.receiver.accept(frame, receivedMs);
+  source.requestAck();
+  reliable_link::Delivery delivery;
+  while (source.receiver.release(delivery)) {
+    int64_t deviceTime = source.receiver.wallTime(delivery.deviceMs, delivery.receivedMs);
+    lines.emplace_back(std::move(delivery.line), deviceTime);
+  }
+}
+
+static Task<void> decode(Scope& scope, Source& source, Channel<Sample>& stored,
+                         Channel<Sample>* posted, Counters& counters) {
+  std::vector<std::pair<std::string, int64_t>> lines;  // text and record time
+  int64_t heardMs = INT64_MIN;                          // last line's time
+  bool open = true;
+  while (std::optional<std::string> line = co_await source.lines.receive(scope)) {
+    counters.lines++;
+    char* text = line->data();
+    int64_t receivedMs = wallMs();
+    lines.clear();
+    if (std::strncmp(text, "BOOT:", 5) == 0 && heardMs != INT64_MIN) {
+      Sample stop{source.device, {}, true};
+      stop.record.timestampMs = heardMs;
+      if (!(open = co_await stored.send(scope, stop))) break;
+    }
+    unsigned long next, base;
+    if (source.acknowledged && text[0] == '@') {
+      unframe(source, text, receivedMs, lines, counters);
+    } else {
+      if (source.acknowledged &&
+          std::sscanf(text, "OK reliable on next=%lu base=%lu", &next, &base) == 2) {
+        source.receiver.reset((uint32_t)base);
+      } else if (source.acknowledged && std::strncmp(text, "BOOT:", 5) == 0) {
+        source.enablePending = true;  // a reset device starts with plain lines
+        source.ackDue.notifyOne();
+      }
+      if (source.updating) noteUpdateLine(source, text);
+      lines.emplace_back(std::move(*line), receivedMs);
+    }
+
+    for (auto& [lineText, timeMs] : lines) {
+      heardMs = timeMs;
+      Sample sample{source.device, {}};
+      if (!parseClassificationLine(lineText.data(), timeMs, sample.record)) continue;
+      const Record& r = sample.record;
+      bool post = posted && r.classification != CLASS_POOR_SIGNAL &&
+                  r.values[COLUMN_SQI] >= SQI_GATE;
+      open = co_await stored.send(scope, sample);
+      if (open && post) open = co_await posted->send(scope, std::move(sample));
+      if (!open) break;
+    }
+    if (!open) break;
+  }
+  if (open && heardMs != INT64_MIN) {
+    Sample stop{source.device, {}, true};
+    stop.record.timestampMs = heardMs;
+    co_await stored.send(scope, stop);
+  }
+}
+
+// Whether reply answers the "ota <verb>" command
+static bool replyFor(const std::string& reply, const std::string& verb) {
+  if (reply.rfind("ERR payload", 0) == 0 || reply.rfind("ERR ota:", 0) == 0) return true;
+  size_t start = reply.rfind("OK ota ", 0) == 0    ? 7
+                 : reply.rfind("ERR ota ", 0) == 0 ? 8
+                                                   : std::string::npos;
+  if (start == std::string::npos || reply.compare(start, verb.size(), verb) != 0) return false;
+  size_t end = start + verb.size();
+  return end == reply.size() || reply[end] == ' ' || reply[end] == ':';
+}
+
+// A command with its payload: "<command> <bytes> <crc>\n" and the bytes
+static std::string payloadCommand(const std::string& command, const std::string& payload) {
+  char header[32];
+  std::snprintf(header, sizeof(header), " %zu %08x\n", payload.size(),
+                firmware_package::crc32(payload.data(), payload.size()));
+  return command + header + payload;
+}
+
+// Sends an "ota" command and waits for its reply; empty on timeout
+static Task<std::string> otaRequest(Scope& scope, Source& source, const std::string& message,
+                                    const std::string& verb, int timeoutMs) {
+  source.otaReply.clear();
+  bool written = co_await writeDevice(scope, source, message);
+  int64_t deadline = EventLoop::nowMs() + timeoutMs;
+  while (written && !source.ended) {
+    if (replyFor(source.otaReply, verb)) co_return source.otaReply;
+    int64_t left = deadline - EventLoop::nowMs();
+    if (left <= 0) break;
+    WaitResult result = co_await scope.wait(source.otaReplied, (int)left);
+    if (result == WAIT_CANCELLED) break;
+  }
+  co_return std::string();
+}
+
+// Streams the package block by block, resuming wherever the device got to
+static Task<void> updateFirmware(Scope& scope, Source& source,
+                                 const firmware_package::Package& package) {
+  std::string manifest((const char*)&package.manifest, sizeof(package.manifest));
+  std::string reply;
+  for (int session = 0; session < UPDATE_ATTEMPTS && !source.ended; session++) {
+    if (session > 0) {
+      WaitResult result = co_await scope.sleep(UPDATE_RETRY_MS);
+      if (result == WAIT_CANCELLED) break;
+    }
+    reply = co_await otaRequest(scope, source, payloadCommand("ota begin", manifest), "begin",
+                                UPDATE_REPLY_MS);
+    unsigned long next, blocks;
+    if (std::sscanf(reply.c_str(), "OK ota begin next=%lu blocks=%lu", &next, &blocks) != 2) {
+      // Refused signatures and images are refused again
+      bool refused = reply.find("signature") != std::string::npos ||
+                     reply.find("signing key") != std::string::npos ||
+                     reply.find("manifest") != std::string::npos ||
+                     reply.find("does not fit") != std::string::npos;
+      if (refused || scope.cancelled()) break;
+      continue;
+    }
+    std::printf("%s: updating from block %lu of %lu\n", source.device.c_str(), next, blocks);
+    for (int failures = 0; next < blocks && failures < UPDATE_ATTEMPTS && !source.ended;) {
+      std::string index = std::to_string(next);
+      reply = co_await otaRequest(scope, source,
+                                  payloadCommand("ota block " + index, package.blocks[next]),
+                                  "block " + index, UPDATE_REPLY_MS);
+      unsigned long expected;
+      if (reply == "OK ota block " + index) {
+        next++;
+        failures = 0;
+      } else if (std::sscanf(reply.c_str(), "ERR ota block %*u: expected %lu", &expected) == 1 &&
+                 expected < blocks) {
+        next = expected;
+      } else if (scope.cancelled()) {
+        break;
+      } else {
+        failures++;
+      }
+    }
+    if (next < blocks) continue;  // begin again from where the device got to
+
+    // A hash mismatch sends the device back to block 0
+    reply = co_await otaRequest(scope, source, "ota finish\n", "finish", UPDATE_VERIFY_MS);
+    if (reply.rfind("OK ota finish", 0) != 0) continue;
+    reply = co_await otaRequest(scope, source, "ota apply\n", "apply", UPDATE_REPLY_MS);
+    if (reply.rfind("OK ota apply", 0) == 0) {
+      source.updateResult = "applied";
+      std::printf("%s: %s\n", source.device.c_str(), reply.c_str());
+      co_return;
+    }
+    break;  // the image failed the device's own check
+  }
+  source.updateResult = "failed: " + (reply.empty() ? std::string("no reply") : reply);
+}
+
+static void flushStore(RecordStore& store, RollupIndex& rollups) {
+  bool ok = store.flush();
+  ok = rollups.flush() && ok;
+  if (!ok) std::fprintf(stderr, "ingest_daemon: segment or rollup write failed\n");
+}
+
+static Task<void> storeRecords(Scope& scope, const char* directory, Channel<Sample>& samples,
+                               Counters& counters) {
+  RecordStore store(directory);
+  RollupIndex rollups(directory);
+  std::set<std::string> resumed;
+  int64_t flushedAt = EventLoop::nowMs();
+  for (;;) {
+    std::optional<Sample> sample = co_await samples.receive(scope, STORE_FLUSH_MS);
+    if (sample) {
+      if (resumed.insert(sample->device).second) rollups.resume(store, sample->device);
+      if (sample->stopped) {
+        rollups.end(sample->device, sample->record.timestampMs);
+      } else if (store.append(sample->device, sample->record)) {
+        rollups.add(sample->device, sample->record);
+        counters.stored++;
+      } else {
+        counters.rejected++;
+      }
+    } else if (samples.drained() || scope.cancelled()) {
+      break;
+    }
+    if (EventLoop::nowMs() - flushedAt >= STORE_FLUSH_MS) {
+      flushStore(store, rollups);
+      flushedAt = EventLoop::nowMs();
+    }
+  }
+  flushStore(store, rollups);
+}
+
+static std::string toJson(const Sample& s) {
+  const Record& r = s.record;
+  char body[512];
+  std::snprintf(body, sizeof(body),
+                "{\"deviceId\":\"%s\",\"timestamp\":%lld,\"dataType\":\"local_classification\","
+                "\"frequency\":%.2f,\"amplitude\":%.2f,\"rms\":%.2f,\"classification\":\"%s\","
+                "\"signalQuality\":%.2f,\"context\":\"%s\",\"firmwareVersion\":\"3.1.0\"}",
+                s.device.c_str(), (long long)r.timestampMs, r.values[COLUMN_FREQUENCY],
+                r.values[COLUMN_AMPLITUDE], r.values[COLUMN_RMS], CLASS_NAMES[r.classification],
+                r.values[COLUMN_SQI],
+                r.context < CONTEXT_COUNT ? CONTEXT_NAMES[r.context] : "UNKNOWN");
+  return body;
+}
+
+// One request on a kept-alive connection: HTTP status, or -1 when the
+// connection failed (or the server closed it, which *keep is set false for)
+static Task<int> exchange(Scope& scope, int fd, const std::string& request, bool* keep) {
+  bool written = co_await writeAll(scope, fd, request.data(), request.size(), API_TIMEOUT_MS);
+  if (!written) co_return -1;
+
+  std::string response;
+  char buffer[2048];
+  size_t headerEnd = std::string::npos;
+  while ((headerEnd = response.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t n = co_await readSome(scope, fd, buffer, sizeof(buffer), API_TIMEOUT_MS);
+    if (n <= 0) co_return -1;
+    response.append(buffer, n);
+  }
+  int status = 0;
+  if (std::sscanf(response.c_str(), "HTTP/%*d.%*d %d", &status) != 1) co_return -1;
+
+  // Skip the body: by its length, to the last chunk, or to the end
+  std::string headers = response.substr(0, headerEnd);
+  for (char& c : headers) c = (char)std::tolower((unsigned char)c);
+  size_t length = headers.find("content-length:");
+  bool chunked = headers.find("transfer-encoding: chunked") != std::string::npos;
+  *keep = headers.find("connection: close") == std::string::npos &&
+          (length != std::string::npos || chunked);
+  std::string body = response.substr(headerEnd + 4);
+  size_t expected = length != std::string::npos
+                        ? std::strtoul(headers.c_str() + length + 15, nullptr, 10)
+                        : SIZE_MAX;
+  while (chunked ? body.find("0\r\n\r\n") == std::string::npos : body.size() < expected) {
+    ssize_t n = co_await readSome(scope, fd, buffer, sizeof(buffer), API_TIMEOUT_MS);
+    if (n < 0) co_return -1;
+    if (n == 0) break;
+    body.append(buffer, n);
+  }
+  co_return status;
+}
+
+static Task<void> postRecords(Scope& scope, const ApiUrl& url, Channel<Sample>& samples,
+                              Counters& counters) {
+  int fd = -1;
+  int64_t retryAt = 0;
+  while (std::optional<Sample> sample = co_await samples.receive(scope)) {
+    if (EventLoop::nowMs() < retryAt) {
+      counters.dropped++;
+      continue;
+    }
+    std::string body = toJson(*sample);
+    std::string request = "POST " + url.path + " HTTP/1.1\r\nHost: " + url.host +
+                          "\r\nContent-Type: application/json\r\nContent-Length: " +
+                          std::to_string(body.size()) + "\r\n\r\n" + body;
+    int status = -1;
+    for (int attempt = 0; attempt < 2 && status < 0; attempt++) {  // a kept connection may be stale
+      if (fd < 0) {
+        fd = co_await connectTcp(scope, url.host.c_str(), url.port.c_str(), API_TIMEOUT_MS);
+      }
+      if (fd < 0) break;
+      bool keep = false;
+      status = co_await exchange(scope, fd, request, &keep);
+      if (status < 0 || !keep) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    if (status >= 200 && status < 300) {
+      counters.posted++;
+    } else {
+      counters.dropped++;
+      if (status < 0 && !scope.cancelled()) {
+        std::fprintf(stderr, "ingest_daemon: API unreachable, retrying in %d s\n",
+                     API_RETRY_MS / 1000);
+        retryAt = EventLoop::nowMs() + API_RETRY_MS;
+      } else if (status > 0) {
+        std::fprintf(stderr, "ingest_daemon: API error %d\n", status);
+      }
+    }
+  }
+  if (fd >= 0) ::close(fd);
+}
+
+static Task<void> watchSignals(Scope& scope, int fd, Scope& readers, Scope& root) {
+  signalfd_siginfo info;
+  int received = 0;
+  for (;;) {
+    WaitResult result = co_await scope.readable(fd);
+    if (result != WAIT_READY) break;
+    if (::read(fd, &info, sizeof(info)) != (ssize_t)sizeof(info)) continue;
+    if (received++ == 0) {
+      std::fprintf(stderr, "ingest_daemon: stopping, finishing queued records (again to abort)\n");
+      readers.cancel();
+    } else {
+      root.cancel();
+    }
+  }
+}
+
+// ---- Daemon ----
+
+struct Options {
+  const char* directory = nullptr;
+  bool api = false;
+  ApiUrl url;
+  size_t queue = 256;
+  bool reliable = false;
+  const char* update = nullptr;
+  firmware_package::Package package;
+  std::vector<std::unique_ptr<Source>> sources;
+  int signals = -1;
+};
+
+static Task<void> daemon(Scope& root, Options& options, Counters& counters) {
+  Scope readers(root), decoders(root), sinks(root), control(root);
+  Channel<Sample> stored(options.queue), posted(options.queue);
+
+  sinks.spawn(storeRecords(sinks, options.directory, stored, counters));
+  if (options.api) sinks.spawn(postRecords(sinks, options.url, posted, counters));
+  for (auto& source : options.sources) {
+    readers.spawn(readLines(readers, *source));
+    if (source->acknowledged) readers.spawn(acknowledge(readers, *source));
+    if (source->updating) readers.spawn(updateFirmware(readers, *source, options.package));
+    decoders.spawn(decode(decoders, *source, stored, options.api ? &posted : nullptr, counters));
+  }
+  control.spawn(watchSignals(control, options.signals, readers, root));
+
+  // Upstream first: each stage ends once the one feeding it has
+  co_await readers.join();
+  co_await decoders.join();
+  stored.close();
+  posted.close();
+  co_await sinks.join();
+  control.cancel();
+  co_await control.join();
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+  Options options;
+  options.directory = argv[1];
+  std::vector<std::string> ports;
+  for (int i = 2; i < argc; i++) {
+    if (std::strcmp(argv[i], "--api") == 0 && i + 1 < argc) {
+      options.api = parseUrl(argv[++i], options.url);
+      if (!options.api) {
+        usage();
+        return 2;
+      }
+    } else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+      options.queue = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--reliable") == 0) {
+      options.reliable = true;
+    } else if (std::strcmp(argv[i], "--update") == 0 && i + 1 < argc) {
+      options.update = argv[++i];
+    } else {
+      ports.push_back(argv[i]);
+    }
+  }
+  std::string error;
+  if (options.update && !firmware_package::readPackage(options.update, options.package, error)) {
+    std::fprintf(stderr, "%s: %s\n", options.update, error.c_str());
+    return 1;
+  }
+  bool writable = options.reliable || options.update;
+  for (const std::string& arg : ports) {
+    auto source = std::make_unique<Source>(options.queue);
+    size_t equals = arg.find('=');
+    source->path = arg.substr(0, equals);
+    source->device = equals != std::string::npos
+                         ? arg.substr(equals + 1)
+                         : source->path == "-" ? "ESP32_LOCAL_CLASSIFIER"
+                                               : source->path.substr(source->path.rfind('/') + 1);
+    source->fd = openSource(source->path, writable);
+    if (source->fd < 0) {
+      std::fprintf(stderr, "%s: %s\n", source->path.c_str(), std::strerror(errno));
+      return 1;
+    }
+    bool serialPort = isatty(source->fd) && (fcntl(source->fd, F_GETFL) & O_ACCMODE) == O_RDWR;
+    source->acknowledged = options.reliable && serialPort;
+    source->updating = options.update && serialPort;
+    if (serialPort) source->writeFd = fcntl(source->fd, F_DUPFD_CLOEXEC, 0);
+    options.sources.push_back(std::move(source));
+  }
+  if (options.sources.empty()) {
+    usage();
+    return 2;
+  }
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+  options.signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  EventLoop loop;
+  Scope root(loop);
+  Counters counters;
+  root.spawn(daemon(root, options, counters));
+  loop.run();
+
+  // Leave the devices as plain line streams for other readers
+  for (auto& source : options.sources) {
+    if (!source->acknowledged) continue;
+    const char* off = "reliable off\r\n";
+    if (::write(source->fd, off, std::strlen(off)) < 0) {
+      std::fprintf(stderr, "%s: %s\n", source->path.c_str(), std::strerror(errno));
+    }
+  }
+
+  std::printf("Read %lu lines from %zu ports: %lu stored (%lu out of order or repeated)",
+              counters.lines, options.sources.size(), counters.stored, counters.rejected);
+  if (options.api) std::printf(", %lu posted (%lu dropped)", counters.posted, counters.dropped);
+  std::printf("\n");
+  if (options.reliable) {
+    uint64_t delivered = 0, duplicates = 0, lost = 0;
+    for (auto& source : options.sources) {
+      delivered += source->receiver.delivered;
+      duplicates += source->receiver.duplicates;
+      lost += source->receiver.lost;
+    }
+    std::printf("Frames: %llu delivered, %llu duplicates, %lu corrupt, %llu lost\n",
+                (unsigned long long)delivered, (unsigned long long)duplicates, counters.corrupt,
+                (unsigned long long)lost);
+  }
+  for (auto& source : options.sources) {
+    if (!options.update) break;
+    std::printf("Update %s: %s\n", source->device.c_str(),
+                source->updating ? source->updateResult.c_str() : "not a writable serial port");
+  }
+  return 0;
+}
@@ -0,0 +1,183 @@
+/*
+  Classifier Comparison (host)
+  Scores the firmware's frequency rules, the exported naive Bayes model
+  and the backend's random forest on the same labelled feature rows, with
+  the cycle cost of each per classified window.
+
+  Build: g++ -std=c++17 -I../include model_compare.cpp -o model_compare
+  Usage: model_compare [--freq A,B,C] [--forest-trees N --forest-nodes N] < rows.csv
+  Input is the --compare output of backend/export_naive_bayes.py: the
+  device's window features over the recorded sessions, with the forest's
+  out-of-fold predictions in a "forest" column. (The CLI trainer's
+  features.csv has the same columns, but its dominant frequency is a
+  full-band argmax the model was not trained on.) Rows the model was
+  exported from score optimistically for naive Bayes; the exporter
+  prints its cross-validated accuracy.
+
+  Rule and naive Bayes cycles come from DEFAULT_CALIBRATION (refreshed by
+  the esp32dev-bench build). The forest does not run on the device: its
+  cost is estimated from the decision nodes it visits per prediction.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "cycle_budget.h"
+#include "naive_bayes.h"
+
+#define MAX_COLUMNS 16
+#define FOREST_NODE_CYCLES 12  // feature load, compare, child index load
+#define FOREST_VOTE_CYCLES 20  // per tree: leaf class, vote count
+
+static const char* CLASS_NAMES[NB_CLASSES] = {"normal", "mild", "moderate", "severe"};
+static const char* FEATURE_COLUMNS[BACKEND_FEATURE_COUNT] = {
+    "mean", "rms", "variance", "zero_crossings", "dominant_frequency", "spectral_entropy"};
+
+static void usage() {
+  std::fprintf(stderr, "usage: model_compare [--freq A,B,C] [--forest-trees N --forest-nodes N] "
+                       "< rows.csv\n");
+}
+
+struct Score {
+  const char* name;
+  unsigned long confusion[NB_CLASSES][NB_CLASSES] = {};  // [truth][predicted]
+  unsigned long rows = 0;
+
+  void add(int truth, int predicted) {
+    confusion[truth][predicted]++;
+    rows++;
+  }
+
+  void print(float cycles) const {
+    unsigned long correct = 0;
+    for (int k = 0; k < NB_CLASSES; k++) correct += confusion[k][k];
+    std::printf("%-12s accuracy %5.1f %% (%lu/%lu), %6.0f cycles/window\n", name,
+                rows ? 100.0 * correct / rows : 0.0, correct, rows, cycles);
+    for (int k = 0; k < NB_CLASSES; k++) {
+      std::printf("  %-9s", CLASS_NAMES[k]);
+      for (int p = 0; p < NB_CLASSES; p++) std::printf(" %5lu", confusion[k][p]);
+      std::printf("\n");
+    }
+  }
+};
+
+static int classIndex(const char* name) {
+  for (int k = 0; k < NB_CLASSES; k++) {
+    if (std::strcmp(name, CLASS_NAMES[k]) == 0) return k;
+  }
+  return -1;
+}
+
+// Split a CSV line in place; returns the number of fields
+static int splitFields(char* line, char** fields) {
+  int count = 0;
+  line[std::strcspn(line, "\r\n")] = '\0';
+  for (char* cursor = line; count < MAX_COLUMNS;) {
+    fields[count++] = cursor;
+    cursor = std::strchr(cursor, ',');
+    if (!cursor) break;
+    *cursor++ = '\0';
+  }
+  return count;
+}
+
+// The firmware's frequency rules at rest (classifyFromFeatures)
+static int classifyRules(float frequency, const float* thresholds) {
+  if (frequency < thresholds[0]) return 0;
+  if (frequency < thresholds[1]) return 1;
+  if (frequency <= thresholds[2]) return 3;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  float thresholds[3] = {1.0f, 3.0f, 6.0f};
+  int forestTrees = 100;
+  float forestNodes = 0;
+
+  bool valid = argc % 2 == 1;
+  for (int i = 1; valid && i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--freq") == 0) {
+      valid = std::sscanf(argv[i + 1], "%f,%f,%f", &thresholds[0], &thresholds[1],
+                          &thresholds[2]) == 3;
+    } else if (std::strcmp(argv[i], "--forest-trees") == 0) {
+      forestTrees = std::atoi(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "--forest-nodes") == 0) {
+      forestNodes = std::atof(argv[i + 1]);
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid || forestTrees < 1) {
+    usage();
+    return 2;
+  }
+
+  char line[1024];
+  char* fields[MAX_COLUMNS];
+  if (!std::fgets(line, sizeof(line), stdin)) {
+    usage();
+    return 2;
+  }
+  int columns = splitFields(line, fields);
+  int labelColumn = -1, forestColumn = -1;
+  int featureColumn[BACKEND_FEATURE_COUNT];
+  for (int f = 0; f < BACKEND_FEATURE_COUNT; f++) featureColumn[f] = -1;
+  for (int c = 0; c < columns; c++) {
+    if (std::strcmp(fields[c], "label") == 0) labelColumn = c;
+    if (std::strcmp(fields[c], "forest") == 0) forestColumn = c;
+    for (int f = 0; f < BACKEND_FEATURE_COUNT; f++) {
+      if (std::strcmp(fields[c], FEATURE_COLUMNS[f]) == 0) featureColumn[f] = c;
+    }
+  }
+  if (labelColumn < 0) {
+    std::fprintf(stderr, "model_compare: no label column\n");
+    return 2;
+  }
+  for (int j = 0; j < NB_FEATURES; j++) {
+    if (featureColumn[NB_FEATURE_INDEX[j]] < 0) {
+      std::fprintf(stderr, "model_compare: no %s column\n", FEATURE_COLUMNS[NB_FEATURE_INDEX[j]]);
+      return 2;
+    }
+  }
+
+  Score rules{"rules"}, naiveBayes{"naive Bayes"}, forest{"forest"};
+  unsigned long skipped = 0;
+  while (std::fgets(line, sizeof(line), stdin)) {
+    int count = splitFields(line, fields);
+    int truth = labelColumn < count ? classIndex(fields[labelColumn]) : -1;
+    if (truth < 0) {
+      skipped++;
+      continue;
+    }
+
+    float backend[BACKEND_FEATURE_COUNT] = {};
+    for (int f = 0; f < BACKEND_FEATURE_COUNT; f++) {
+      if (featureColumn[f] >= 0 && featureColumn[f] < count) {
+        backend[f] = std::strtof(fields[featureColumn[f]], nullptr);
+      }
+    }
+    float logP[NB_CLASSES];
+    rules.add(truth, classifyRules(backend[BACKEND_DOMINANT_FREQUENCY], thresholds));
+    naiveBayes.add(truth, naiveBayesLogProbabilities(backend, logP));
+    if (forestColumn >= 0 && forestColumn < count) {
+      int predicted = classIndex(fields[forestColumn]);
+      if (predicted >= 0) forest.add(truth, predicted);
+    }
+  }
+
+  const cycle_budget::Calibration& cal = cycle_budget::DEFAULT_CALIBRATION;
+  std::printf("Rows: %lu (%lu skipped), confusion rows truth, columns predicted\n",
+              naiveBayes.rows, skipped);
+  rules.print(cal.modelCycles[cycle_budget::MODEL_RULES]);
+  naiveBayes.print(cal.modelCycles[cycle_budget::MODEL_NAIVE_BAYES]);
+  std::printf("  %d classes x %d features, %d multiply-adds\n", NB_CLASSES, NB_FEATURES,
+              2 * NB_CLASSES * NB_FEATURES);
+  if (forest.rows) {
+    forest.print(forestNodes * FOREST_NODE_CYCLES + forestTrees * FOREST_VOTE_CYCLES);
+    if (forestNodes <= 0) std::printf("  pass --forest-nodes for the node visits\n");
+  } else {
+    std::printf("forest       no predictions (export with --compare and scikit-learn)\n");
+  }
+  return 0;
+}
@@ -0,0 +1,234 @@
+/*
+  Record Store Tool (host)
+  Ingests the firmware's CLASSIFICATION lines into the columnar record
+  store (record_store.h) and its rollups (rollup_index.h), and runs range
+  and trend queries against them.
+
+  Build: g++ -std=c++17 -O2 record_store.cpp -o record_store
+  Usage: record_store DIR ingest [--device ID] < serial.log
+         record_store DIR summary --device ID [--from MS] [--to MS] [--where COL:LOW:HIGH]
+         record_store DIR export --device ID [--from MS] [--to MS] [--where COL:LOW:HIGH]
+         record_store DIR trend --device ID [--from MS] [--to MS] [--resolution MS]
+         record_store DIR rollup --device ID
+         record_store DIR devices
+  Ingest reads lines of "[epoch ms] CLASSIFICATION:class,freq,amp,rms[,sqi[,context]]";
+  lines without a timestamp are stamped with the time they were read, so
+  the serial port can be piped in live. A BOOT line ends the device's
+  last class at the line before it (rollup_index.h). Other lines are
+  skipped. COL is frequency, amplitude, rms or sqi. Trend answers from
+  the rollups: one row per resolution step, or the range total without
+  --resolution; the range defaults to everything stored. Rollup rebuilds
+  a device's rollups from its segments.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "record_store.h"
+#include "rollup_index.h"
+
+using namespace record_store;
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: record_store DIR ingest [--device ID] < serial.log\n"
+               "       record_store DIR summary|export --device ID [--from MS] [--to MS]\n"
+               "                    [--where frequency|amplitude|rms|sqi:LOW:HIGH]\n"
+               "       record_store DIR trend --device ID [--from MS] [--to MS] [--resolution MS]\n"
+               "       record_store DIR rollup --device ID\n"
+               "       record_store DIR devices\n");
+}
+
+static int64_t nowMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static int ingest(RecordStore& store, RollupIndex& rollups, const char* device) {
+  char line[512];
+  unsigned long rows = 0, skipped = 0, rejected = 0;
+  Record record;
+  int64_t heardMs = INT64_MIN;  // the line before this one
+  rollups.resume(store, device);
+  while (std::fgets(line, sizeof(line), stdin)) {
+    int64_t receivedMs = nowMs();
+    if (std::strstr(line, "BOOT:") && heardMs != INT64_MIN) rollups.end(device, heardMs);
+    heardMs = lineTimeMs(line, receivedMs);
+    if (!parseClassificationLine(line, receivedMs, record)) {
+      skipped++;
+    } else if (store.append(device, record)) {
+      rollups.add(device, record);
+      rows++;
+    } else {
+      rejected++;
+    }
+  }
+  bool flushed = store.flush();
+  flushed = rollups.flush() && flushed;
+  std::printf("Ingested %lu rows for %s (%lu other lines, %lu out of order or repeated)\n", rows,
+              device, skipped, rejected);
+  if (!flushed) std::fprintf(stderr, "record_store: segment or rollup write failed\n");
+  return flushed ? 0 : 1;
+}
+
+static void printSummary(const RangeSummary& s) {
+  std::printf("Rows: %llu", (unsigned long long)s.rows);
+  if (s.rows) std::printf(", %lld .. %lld ms", (long long)s.firstMs, (long long)s.lastMs);
+  std::printf("\n");
+  for (int c = 0; c < FLOAT_COLUMNS; c++) {
+    const ColumnSummary& column = s.columns[c];
+    if (!column.count) continue;
+    std::printf("  %-10s min %8.3f  max %8.3f  mean %8.3f\n", FLOAT_COLUMN_NAMES[c],
+                column.min, column.max, column.mean());
+  }
+  std::printf("Classes:");
+  for (int k = 0; k < CLASS_COUNT; k++) {
+    std::printf(" %s %llu", CLASS_NAMES[k], (unsigned long long)s.classRows[k]);
+  }
+  std::printf("\nContexts:");
+  for (int k = 0; k < CONTEXT_COUNT; k++) {
+    std::printf(" %s %llu", CONTEXT_NAMES[k], (unsigned long long)s.contextRows[k]);
+  }
+  const QueryStats& q = s.stats;
+  std::printf("\nSegments: %u, pruned %u, zone maps %u, decoded %u, %llu bytes read\n",
+              q.segments, q.pruned, q.fromZoneMap, q.decoded, (unsigned long long)q.bytesRead);
+}
+
+static void printBucketHeader() {
+  std::printf("start,rows,normal_s,mild_s,moderate_s,severe_s,poor_signal_s,"
+              "freq_mean,freq_p50,freq_p90,amp_mean,amp_p90,amp_max\n");
+}
+
+static void printBucket(const RollupBucket& b) {
+  std::printf("%lld,%u", (long long)b.startMs, (unsigned)b.rows);
+  for (int k = 0; k < CLASS_COUNT; k++) std::printf(",%.1f", b.classMs[k] / 1000.0);
+  const Sketch& f = b.sketches[SKETCH_FREQUENCY];
+  const Sketch& a = b.sketches[SKETCH_AMPLITUDE];
+  float fMax = SKETCH_MAX[SKETCH_FREQUENCY], aMax = SKETCH_MAX[SKETCH_AMPLITUDE];
+  std::printf(",%.2f,%.2f,%.2f,%.3f,%.3f,%.3f\n", f.mean(), f.quantile(0.5f, fMax),
+              f.quantile(0.9f, fMax), a.mean(), a.quantile(0.9f, aMax), a.count ? a.max : NAN);
+}
+
+static int trend(RecordStore& store, RollupIndex& rollups, const char* device, Filter range,
+                 int64_t resolutionMs) {
+  if (range.fromMs == INT64_MIN || range.toMs == INT64_MAX) {
+    Filter all;
+    RangeSummary stored = store.summarize(device, all);
+    if (!stored.rows) {
+      std::printf("No rows for %s\n", device);
+      return 0;
+    }
+    if (range.fromMs == INT64_MIN) range.fromMs = stored.firstMs;
+    if (range.toMs == INT64_MAX) range.toMs = stored.lastMs + 1;
+  }
+  if (range.toMs <= range.fromMs) return 2;
+
+  printBucketHeader();
+  if (resolutionMs <= 0) {
+    uint64_t reads = 0;
+    printBucket(rollups.total(device, range.fromMs, range.toMs, &reads));
+    std::fprintf(stderr, "Total: %llu buckets read\n", (unsigned long long)reads);
+    return 0;
+  }
+  RollupPlan plan = RollupIndex::plan(range.fromMs, range.toMs, resolutionMs);
+  for (const RollupBucket& b : rollups.series(device, plan)) printBucket(b);
+  std::fprintf(stderr, "Plan: %s buckets, %lld ms steps, %llu buckets read\n",
+               LEVEL_NAMES[plan.level], (long long)plan.stepMs,
+               (unsigned long long)plan.bucketsRead);
+  return 0;
+}
+
+static int rebuild(RecordStore& store, RollupIndex& rollups, const char* device) {
+  rollups.clear(device);
+  Filter all;
+  uint64_t rows = 0;
+  store.scan(device, all, [&](const Record& r) {
+    rollups.add(device, r);
+    rows++;
+  });
+  bool flushed = rollups.flush();
+  std::printf("Rolled up %llu rows for %s\n", (unsigned long long)rows, device);
+  if (!flushed) std::fprintf(stderr, "record_store: rollup write failed\n");
+  return flushed ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+  RecordStore store(argv[1]);
+  RollupIndex rollups(argv[1]);
+  const char* command = argv[2];
+  const char* device = nullptr;
+  Filter filter;
+  int64_t resolutionMs = 0;
+
+  bool valid = argc % 2 == 1;
+  for (int i = 3; valid && i + 1 < argc; i += 2) {
+    const char* value = argv[i + 1];
+    if (std::strcmp(argv[i], "--device") == 0) {
+      device = value;
+    } else if (std::strcmp(argv[i], "--from") == 0) {
+      filter.fromMs = std::strtoll(value, nullptr, 10);
+    } else if (std::strcmp(argv[i], "--to") == 0) {
+      filter.toMs = std::strtoll(value, nullptr, 10);
+    } else if (std::strcmp(argv[i], "--resolution") == 0) {
+      resolutionMs = std::strtoll(value, nullptr, 10);
+      valid = resolutionMs > 0;
+    } else if (std::strcmp(argv[i], "--where") == 0) {
+      char name[16];
+      valid = std::sscanf(value, "%15[a-z]:%f:%f", name, &filter.low, &filter.high) == 3 &&
+              (filter.column = nameIndex(name, FLOAT_COLUMN_NAMES, FLOAT_COLUMNS)) >= 0;
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid) {
+    usage();
+    return 2;
+  }
+
+  if (std::strcmp(command, "ingest") == 0) {
+    return ingest(store, rollups, device ? device : "ESP32_LOCAL_CLASSIFIER");
+  }
+  if (std::strcmp(command, "devices") == 0) {
+    for (const std::string& name : store.devices()) {
+      std::printf("%s: %zu segments\n", name.c_str(), store.segments(name).size());
+    }
+    return 0;
+  }
+  if (!device) {
+    usage();
+    return 2;
+  }
+  if (std::strcmp(command, "summary") == 0) {
+    printSummary(store.summarize(device, filter));
+    return 0;
+  }
+  if (std::strcmp(command, "trend") == 0) {
+    int status = trend(store, rollups, device, filter, resolutionMs);
+    if (status == 2) usage();
+    return status;
+  }
+  if (std::strcmp(command, "rollup") == 0) {
+    return rebuild(store, rollups, device);
+  }
+  if (std::strcmp(command, "export") == 0) {
+    std::printf("timestamp,classification,frequency,amplitude,rms,sqi,context\n");
+    QueryStats stats = store.scan(device, filter, [](const Record& r) {
+      std::printf("%lld,%s,%.2f,%.2f,%.2f,%.2f,%s\n", (long long)r.timestampMs,
+                  CLASS_NAMES[r.classification], r.values[COLUMN_FREQUENCY],
+                  r.values[COLUMN_AMPLITUDE], r.values[COLUMN_RMS], r.values[COLUMN_SQI],
+                  r.context < CONTEXT_COUNT ? CONTEXT_NAMES[r.context] : "UNKNOWN");
+    });
+    std::fprintf(stderr, "Segments: %u, pruned %u, decoded %u, %llu bytes read\n",
+                 stats.segments, stats.pruned, stats.decoded,
+                 (unsigned long long)stats.bytesRead);
+    return 0;
+  }
+  usage();
+  return 2;
+}
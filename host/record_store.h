@@ -0,0 +1,683 @@
+/*
+  Record Store (host)
+  Embedded columnar store for the firmware's classification records, so
+  dashboard and export queries over months of windows read a few
+  compressed column blocks instead of one document per window.
+
+  Rows are buffered per device in a head segment, then sealed into an
+  immutable segment file. A segment never spans two time partitions
+  (STORE_PARTITION_MS) and holds at most STORE_SEGMENT_ROWS rows. Each
+  column is encoded on its own:
+
+    timestamp       delta-of-delta as zigzag varints: a steady window
+                    rate costs one byte a row
+    class, context  runs of (value, length)
+    float columns   XOR with the previous value (Gorilla): a repeated
+                    value is one bit, a slow drift a few mantissa bits
+
+  Each segment header carries its time range and a zone map for every
+  column: min, max and sum for the floats, rows per class. A query skips
+  segments by file name (first timestamp, hence partition) without
+  opening them. It answers segments that lie wholly inside the range from
+  the header alone, and decodes only the needed columns of the rest.
+
+  Files are DIR/<device>/<first timestamp>.seg, little-endian, written
+  under a temporary name and renamed, so a crash leaves the whole segment
+  or none; an existing segment is never replaced. Rows must arrive in
+  strictly increasing time order per device, so a repeated timestamp is
+  refused like an older one and no two segments share a name. Rows still
+  in the head are lost unless flush() runs (the CLI flushes at end of
+  input).
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace record_store {
+
+constexpr int64_t STORE_PARTITION_MS = 3600LL * 1000;  // one hour
+constexpr uint32_t STORE_SEGMENT_ROWS = 16384;         // about an hour of 4 Hz windows
+constexpr uint32_t SEGMENT_MAGIC = 0x4753504EUL;       // "NPSG"
+constexpr uint16_t SEGMENT_VERSION = 1;
+
+// CLASSIFICATION line vocabulary, in firmware order
+enum RecordClass : uint8_t { CLASS_NORMAL, CLASS_MILD, CLASS_MODERATE, CLASS_SEVERE,
+                             CLASS_POOR_SIGNAL, CLASS_COUNT };
+constexpr const char* CLASS_NAMES[CLASS_COUNT] = {"NORMAL", "MILD", "MODERATE", "SEVERE",
+                                                  "POOR_SIGNAL"};
+constexpr int CONTEXT_COUNT = 5;
+constexpr const char* CONTEXT_NAMES[CONTEXT_COUNT] = {"UNKNOWN", "REST", "POSTURE", "MOVEMENT",
+                                                      "VIGOROUS"};
+
+enum FloatColumn { COLUMN_FREQUENCY, COLUMN_AMPLITUDE, COLUMN_RMS, COLUMN_SQI, FLOAT_COLUMNS };
+constexpr const char* FLOAT_COLUMN_NAMES[FLOAT_COLUMNS] = {"frequency", "amplitude", "rms", "sqi"};
+
+// Encoded blocks of a segment, in file order
+enum Block { BLOCK_TIMESTAMP, BLOCK_CLASS, BLOCK_CONTEXT, BLOCK_FLOAT, BLOCK_COUNT =
+                 BLOCK_FLOAT + FLOAT_COLUMNS };
+
+struct Record {
+  int64_t timestampMs;
+  uint8_t classification;  // RecordClass
+  uint8_t context;         // MotorContext
+  float values[FLOAT_COLUMNS];
+};
+
+// Index of a name in a table, -1 if absent
+inline int nameIndex(const char* name, const char* const* names, int count) {
+  for (int i = 0; i < count; i++) {
+    if (std::strcmp(name, names[i]) == 0) return i;
+  }
+  return -1;
+}
+
+// Time of a logged "[epoch ms] LINE", receivedMs when it has no stamp
+inline int64_t lineTimeMs(const char* line, int64_t receivedMs) {
+  char* end;
+  long long stamp = std::strtoll(line, &end, 10);
+  return end != line && (*end == ' ' || *end == '\t') ? stamp : receivedMs;
+}
+
+// "[epoch ms] CLASSIFICATION:class,freq,amp,rms[,sqi[,context]]" into a
+// record, stamped receivedMs when the line has no timestamp; false for
+// any other line. The line is modified.
+inline bool parseClassificationLine(char* line, int64_t receivedMs, Record& record) {
+  char* body = std::strstr(line, "CLASSIFICATION:");
+  if (!body) return false;
+  char* end;
+  long long stamp = std::strtoll(line, &end, 10);
+  record.timestampMs = end != line && end <= body ? stamp : receivedMs;
+
+  char* fields[6] = {};
+  int count = 0;
+  body[std::strcspn(body, "\r\n")] = '\0';
+  for (char* cursor = body + std::strlen("CLASSIFICATION:"); cursor && count < 6;) {
+    fields[count++] = cursor;
+    cursor = std::strchr(cursor, ',');
+    if (cursor) *cursor++ = '\0';
+  }
+  int classification = count >= 4 ? nameIndex(fields[0], CLASS_NAMES, CLASS_COUNT) : -1;
+  if (classification < 0) return false;
+  int context = count >= 6 ? nameIndex(fields[5], CONTEXT_NAMES, CONTEXT_COUNT) : 0;
+
+  record.classification = (uint8_t)classification;
+  record.context = (uint8_t)(context < 0 ? 0 : context);
+  record.values[COLUMN_FREQUENCY] = std::strtof(fields[1], nullptr);
+  record.values[COLUMN_AMPLITUDE] = std::strtof(fields[2], nullptr);
+  record.values[COLUMN_RMS] = std::strtof(fields[3], nullptr);
+  record.values[COLUMN_SQI] = count >= 5 ? std::strtof(fields[4], nullptr) : 1.0f;
+  return true;
+}
+
+struct ZoneMap {
+  float min, max;
+  double sum;
+};
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t blocks;
+  uint32_t rows;
+  uint32_t reserved;  // keeps the 64-bit fields aligned
+  int64_t firstMs, lastMs;
+  ZoneMap zones[FLOAT_COLUMNS];
+  uint32_t classRows[CLASS_COUNT];
+  uint32_t contextRows[CONTEXT_COUNT];
+  uint32_t blockBytes[BLOCK_COUNT];
+};
+
+inline int64_t partitionOf(int64_t timestampMs) {
+  return timestampMs >= 0 ? timestampMs / STORE_PARTITION_MS
+                          : (timestampMs + 1) / STORE_PARTITION_MS - 1;
+}
+
+// ---- Column encodings ----
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+inline bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; in < end && shift < 64; shift += 7) {
+    uint8_t byte = *in++;
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+struct BitWriter {
+  std::vector<uint8_t>& out;
+  int used = 8;  // bits filled in the last byte
+
+  explicit BitWriter(std::vector<uint8_t>& target) : out(target) {}
+
+  void put(uint32_t value, int bits) {
+    while (bits > 0) {
+      if (used == 8) {
+        out.push_back(0);
+        used = 0;
+      }
+      int take = std::min(bits, 8 - used);
+      uint32_t chunk = (value >> (bits - take)) & ((1u << take) - 1);
+      out.back() |= (uint8_t)(chunk << (8 - used - take));
+      used += take;
+      bits -= take;
+    }
+  }
+};
+
+struct BitReader {
+  const uint8_t* data;
+  size_t size;
+  size_t bit = 0;
+
+  bool get(int bits, uint32_t& value) {
+    if (bit + bits > size * 8) return false;
+    value = 0;
+    for (int i = 0; i < bits; i++, bit++) {
+      value = (value << 1) | ((data[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    return true;
+  }
+};
+
+inline uint32_t floatBits(float f) {
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// Gorilla XOR: '0' same value; '10' meaningful bits inside the previous
+// window; '11', 5 bits leading zeros, 5 bits length - 1, then the bits
+inline void encodeFloats(const std::vector<Record>& rows, int column, std::vector<uint8_t>& out) {
+  BitWriter writer(out);
+  uint32_t previous = 0;
+  int leading = -1, trailing = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    uint32_t bits = floatBits(rows[i].values[column]);
+    if (i == 0) {
+      writer.put(bits, 32);
+      previous = bits;
+      continue;
+    }
+    uint32_t x = bits ^ previous;
+    previous = bits;
+    if (x == 0) {
+      writer.put(0, 1);
+      continue;
+    }
+    int lead = std::min(__builtin_clz(x), 31);
+    int trail = __builtin_ctz(x);
+    if (leading >= 0 && lead >= leading && trail >= trailing) {
+      writer.put(2, 2);
+      writer.put(x >> trailing, 32 - leading - trailing);
+    } else {
+      leading = lead;
+      trailing = trail;
+      int length = 32 - lead - trail;
+      writer.put(3, 2);
+      writer.put(lead, 5);
+      writer.put(length - 1, 5);
+      writer.put(x >> trail, length);
+    }
+  }
+}
+
+inline bool decodeFloats(const uint8_t* data, size_t size, uint32_t rows, int column,
+                         std::vector<Record>& out) {
+  BitReader reader{data, size};
+  uint32_t previous = 0, flag, value;
+  int leading = 0, trailing = 0;
+  for (uint32_t i = 0; i < rows; i++) {
+    if (i == 0) {
+      if (!reader.get(32, previous)) return false;
+    } else {
+      if (!reader.get(1, flag)) return false;
+      if (flag) {
+        if (!reader.get(1, flag)) return false;
+        if (flag) {
+          uint32_t lead, length;
+          if (!reader.get(5, lead) || !reader.get(5, length)) return false;
+          leading = lead;
+          trailing = 32 - leading - (int)(length + 1);
+        }
+        if (!reader.get(32 - leading - trailing, value)) return false;
+        previous ^= value << trailing;
+      }
+    }
+    out[i].values[column] = bitsFloat(previous);
+  }
+  return true;
+}
+
+inline void encodeTimestamps(const std::vector<Record>& rows, std::vector<uint8_t>& out) {
+  int64_t previous = 0, delta = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    int64_t t = rows[i].timestampMs;
+    if (i == 0) putVarint(out, zigzag(t));
+    else putVarint(out, zigzag((t - previous) - delta));
+    if (i > 0) delta = t - previous;
+    previous = t;
+  }
+}
+
+inline bool decodeTimestamps(const uint8_t* in, const uint8_t* end, uint32_t rows,
+                             std::vector<Record>& out) {
+  int64_t previous = 0, delta = 0;
+  uint64_t v;
+  for (uint32_t i = 0; i < rows; i++) {
+    if (!getVarint(in, end, v)) return false;
+    if (i == 0) {
+      previous = unzigzag(v);
+    } else {
+      delta += unzigzag(v);
+      previous += delta;
+    }
+    out[i].timestampMs = previous;
+  }
+  return true;
+}
+
+// Runs of a byte field (class or context): value, run length
+template <uint8_t Record::*Field>
+inline void encodeRuns(const std::vector<Record>& rows, std::vector<uint8_t>& out) {
+  for (size_t i = 0; i < rows.size();) {
+    size_t run = 1;
+    while (i + run < rows.size() && rows[i + run].*Field == rows[i].*Field) run++;
+    out.push_back(rows[i].*Field);
+    putVarint(out, run);
+    i += run;
+  }
+}
+
+template <uint8_t Record::*Field>
+inline bool decodeRuns(const uint8_t* in, const uint8_t* end, uint32_t rows,
+                       std::vector<Record>& out) {
+  uint64_t run;
+  for (uint32_t i = 0; i < rows;) {
+    if (in >= end) return false;
+    uint8_t value = *in++;
+    if (!getVarint(in, end, run) || run == 0 || run > rows - i) return false;
+    for (uint64_t r = 0; r < run; r++) (out[i++].*Field) = value;
+  }
+  return true;
+}
+
+// ---- Queries ----
+
+struct ColumnSummary {
+  uint64_t count = 0;
+  float min = INFINITY, max = -INFINITY;
+  double sum = 0;
+
+  double mean() const { return count ? sum / count : NAN; }
+
+  void add(float value) {
+    count++;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    sum += value;
+  }
+
+  void merge(const ZoneMap& zone, uint32_t rows) {
+    count += rows;
+    min = std::min(min, zone.min);
+    max = std::max(max, zone.max);
+    sum += zone.sum;
+  }
+};
+
+// Rows kept by a query: a time range, optionally one float column's range
+struct Filter {
+  int64_t fromMs = INT64_MIN;  // inclusive
+  int64_t toMs = INT64_MAX;    // exclusive
+  int column = -1;             // FloatColumn, -1 = none
+  float low = -INFINITY, high = INFINITY;
+  uint32_t columns = (1u << FLOAT_COLUMNS) - 1;  // float columns decoded; others read 0
+
+  bool keeps(const Record& r) const {
+    return r.timestampMs >= fromMs && r.timestampMs < toMs &&
+           (column < 0 || (r.values[column] >= low && r.values[column] <= high));
+  }
+};
+
+struct QueryStats {
+  uint32_t segments = 0;     // on disk for the device
+  uint32_t pruned = 0;       // skipped by name or zone map, never decoded
+  uint32_t fromZoneMap = 0;  // answered from the header alone
+  uint32_t decoded = 0;
+  uint64_t bytesRead = 0;
+  uint32_t headRows = 0;     // unsealed rows scanned in memory
+};
+
+struct RangeSummary {
+  uint64_t rows = 0;
+  ColumnSummary columns[FLOAT_COLUMNS];
+  uint64_t classRows[CLASS_COUNT] = {};
+  uint64_t contextRows[CONTEXT_COUNT] = {};
+  int64_t firstMs = INT64_MAX, lastMs = INT64_MIN;
+  QueryStats stats;
+
+  void add(const Record& r) {
+    rows++;
+    for (int c = 0; c < FLOAT_COLUMNS; c++) columns[c].add(r.values[c]);
+    if (r.classification < CLASS_COUNT) classRows[r.classification]++;
+    if (r.context < CONTEXT_COUNT) contextRows[r.context]++;
+    firstMs = std::min(firstMs, r.timestampMs);
+    lastMs = std::max(lastMs, r.timestampMs);
+  }
+
+  void merge(const SegmentHeader& h) {
+    rows += h.rows;
+    for (int c = 0; c < FLOAT_COLUMNS; c++) columns[c].merge(h.zones[c], h.rows);
+    for (int k = 0; k < CLASS_COUNT; k++) classRows[k] += h.classRows[k];
+    for (int k = 0; k < CONTEXT_COUNT; k++) contextRows[k] += h.contextRows[k];
+    firstMs = std::min(firstMs, h.firstMs);
+    lastMs = std::max(lastMs, h.lastMs);
+  }
+};
+
+// ---- Segments ----
+
+inline SegmentHeader summarizeRows(const std::vector<Record>& rows) {
+  SegmentHeader h = {};
+  h.magic = SEGMENT_MAGIC;
+  h.version = SEGMENT_VERSION;
+  h.blocks = BLOCK_COUNT;
+  h.rows = (uint32_t)rows.size();
+  h.firstMs = rows.front().timestampMs;
+  h.lastMs = rows.back().timestampMs;
+  for (int c = 0; c < FLOAT_COLUMNS; c++) h.zones[c] = {INFINITY, -INFINITY, 0};
+  for (const Record& r : rows) {
+    for (int c = 0; c < FLOAT_COLUMNS; c++) {
+      h.zones[c].min = std::min(h.zones[c].min, r.values[c]);
+      h.zones[c].max = std::max(h.zones[c].max, r.values[c]);
+      h.zones[c].sum += r.values[c];
+    }
+    if (r.classification < CLASS_COUNT) h.classRows[r.classification]++;
+    if (r.context < CONTEXT_COUNT) h.contextRows[r.context]++;
+  }
+  return h;
+}
+
+inline bool writeSegment(const std::filesystem::path& path, const std::vector<Record>& rows) {
+  std::vector<uint8_t> blocks[BLOCK_COUNT];
+  encodeTimestamps(rows, blocks[BLOCK_TIMESTAMP]);
+  encodeRuns<&Record::classification>(rows, blocks[BLOCK_CLASS]);
+  encodeRuns<&Record::context>(rows, blocks[BLOCK_CONTEXT]);
+  for (int c = 0; c < FLOAT_COLUMNS; c++) encodeFloats(rows, c, blocks[BLOCK_FLOAT + c]);
+
+  SegmentHeader header = summarizeRows(rows);
+  for (int b = 0; b < BLOCK_COUNT; b++) header.blockBytes[b] = (uint32_t)blocks[b].size();
+
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  FILE* file = std::fopen(temporary.c_str(), "wb");
+  if (!file) return false;
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  for (int b = 0; b < BLOCK_COUNT && ok; b++) {
+    ok = blocks[b].empty() || std::fwrite(blocks[b].data(), blocks[b].size(), 1, file) == 1;
+  }
+  ok = std::fclose(file) == 0 && ok;
+  std::error_code error;
+  if (ok) std::filesystem::rename(temporary, path, error);
+  if (!ok || error) std::filesystem::remove(temporary, error);
+  return ok && !error;
+}
+
+struct SegmentFile {
+  std::filesystem::path path;
+  int64_t firstMs;
+};
+
+inline bool readHeader(FILE* file, SegmentHeader& header) {
+  return std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == SEGMENT_MAGIC &&
+         header.version == SEGMENT_VERSION && header.blocks == BLOCK_COUNT && header.rows > 0;
+}
+
+// ---- Store ----
+
+class RecordStore {
+ public:
+  explicit RecordStore(std::filesystem::path directory) : root(std::move(directory)) {}
+  ~RecordStore() { flush(); }
+
+  // False if the row is not newer than the device's last one
+  bool append(const std::string& device, const Record& record) {
+    Head& head = heads[device];
+    if (!head.loaded) loadLastTimestamp(device, head);
+    if (record.timestampMs <= head.lastMs) return false;
+    if (!head.rows.empty() &&
+        (partitionOf(record.timestampMs) != partitionOf(head.rows.front().timestampMs) ||
+         head.rows.size() >= STORE_SEGMENT_ROWS)) {
+      if (!seal(device, head)) return false;
+    }
+    head.rows.push_back(record);
+    head.lastMs = record.timestampMs;
+    return true;
+  }
+
+  // Seal every head segment; false if a write failed (its rows stay buffered)
+  bool flush() {
+    bool ok = true;
+    for (auto& [device, head] : heads) {
+      if (!head.rows.empty()) ok = seal(device, head) && ok;
+    }
+    return ok;
+  }
+
+  std::vector<SegmentFile> segments(const std::string& device) const {
+    std::vector<SegmentFile> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(root / device, error)) {
+      if (entry.path().extension() != ".seg") continue;
+      char* end;
+      std::string stem = entry.path().stem().string();
+      long long first = std::strtoll(stem.c_str(), &end, 10);
+      if (*end == '\0') files.push_back({entry.path(), first});
+    }
+    std::sort(files.begin(), files.end(),
+              [](const SegmentFile& a, const SegmentFile& b) { return a.firstMs < b.firstMs; });
+    return files;
+  }
+
+  std::vector<std::string> devices() const {
+    std::vector<std::string> names;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(root, error)) {
+      if (entry.is_directory()) names.push_back(entry.path().filename().string());
+    }
+    for (const auto& [device, head] : heads) {
+      if (!head.rows.empty() && std::find(names.begin(), names.end(), device) == names.end()) {
+        names.push_back(device);
+      }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+
+  // Aggregates over the rows a filter keeps
+  RangeSummary summarize(const std::string& device, const Filter& filter) const {
+    RangeSummary summary;
+    visit(device, filter, &summary, nullptr);
+    return summary;
+  }
+
+  // Every kept row, in time order; returns the query statistics
+  QueryStats scan(const std::string& device, const Filter& filter,
+                  const std::function<void(const Record&)>& fn) const {
+    RangeSummary unused;
+    visit(device, filter, &unused, &fn);
+    return unused.stats;
+  }
+
+ private:
+  struct Head {
+    std::vector<Record> rows;
+    int64_t lastMs = INT64_MIN;
+    bool loaded = false;
+  };
+
+  std::filesystem::path root;
+  std::map<std::string, Head> heads;
+
+  bool seal(const std::string& device, Head& head) {
+    std::error_code error;
+    std::filesystem::create_directories(root / device, error);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%013lld.seg", (long long)head.rows.front().timestampMs);
+    std::filesystem::path path = root / device / name;
+    if (std::filesystem::exists(path, error) || !writeSegment(path, head.rows)) return false;
+    head.rows.clear();
+    return true;
+  }
+
+  void loadLastTimestamp(const std::string& device, Head& head) const {
+    head.loaded = true;
+    std::vector<SegmentFile> files = segments(device);
+    if (files.empty()) return;
+    FILE* file = std::fopen(files.back().path.c_str(), "rb");
+    SegmentHeader header;
+    if (file && readHeader(file, header)) head.lastMs = header.lastMs;
+    if (file) std::fclose(file);
+  }
+
+  // Segment wholly inside the filter: its zone maps are the answer
+  static bool covers(const Filter& f, const SegmentHeader& h) {
+    return h.firstMs >= f.fromMs && h.lastMs < f.toMs &&
+           (f.column < 0 || (h.zones[f.column].min >= f.low && h.zones[f.column].max <= f.high));
+  }
+
+  static bool disjoint(const Filter& f, const SegmentHeader& h) {
+    return h.lastMs < f.fromMs || h.firstMs >= f.toMs ||
+           (f.column >= 0 && (h.zones[f.column].max < f.low || h.zones[f.column].min > f.high));
+  }
+
+  void visit(const std::string& device, const Filter& filter, RangeSummary* summary,
+             const std::function<void(const Record&)>* fn) const {
+    QueryStats& stats = summary->stats;
+    std::vector<SegmentFile> files = segments(device);
+    stats.segments = (uint32_t)files.size();
+    std::vector<Record> rows;
+
+    for (size_t i = 0; i < files.size(); i++) {
+      // A segment ends inside its partition and before the next segment
+      int64_t first = files[i].firstMs;
+      int64_t limit = (partitionOf(first) + 1) * STORE_PARTITION_MS;
+      if (i + 1 < files.size()) limit = std::min(limit, files[i + 1].firstMs + 1);
+      if (first >= filter.toMs || limit <= filter.fromMs) {
+        stats.pruned++;
+        continue;
+      }
+
+      FILE* file = std::fopen(files[i].path.c_str(), "rb");
+      SegmentHeader header;
+      if (!file || !readHeader(file, header)) {
+        if (file) std::fclose(file);
+        stats.pruned++;
+        continue;
+      }
+      stats.bytesRead += sizeof(header);
+      if (disjoint(filter, header)) {
+        stats.pruned++;
+      } else if (!fn && covers(filter, header)) {
+        summary->merge(header);
+        stats.fromZoneMap++;
+      } else if (readRows(file, header, filter, rows, stats)) {
+        stats.decoded++;
+        for (const Record& r : rows) {
+          if (!filter.keeps(r)) continue;
+          summary->add(r);
+          if (fn) (*fn)(r);
+        }
+      }
+      std::fclose(file);
+    }
+
+    auto head = heads.find(device);
+    if (head != heads.end()) {
+      for (const Record& r : head->second.rows) {
+        stats.headRows++;
+        if (!filter.keeps(r)) continue;
+        summary->add(r);
+        if (fn) (*fn)(r);
+      }
+    }
+  }
+
+  // Timestamps and the filter's column first, so a segment none of whose
+  // rows pass costs only those; then the rest of the requested columns
+  static bool readRows(FILE* file, const SegmentHeader& header, const Filter& filter,
+                       std::vector<Record>& rows, QueryStats& stats) {
+    uint64_t offsets[BLOCK_COUNT];
+    offsets[0] = sizeof(SegmentHeader);
+    for (int b = 1; b < BLOCK_COUNT; b++) offsets[b] = offsets[b - 1] + header.blockBytes[b - 1];
+
+    int order[BLOCK_COUNT];
+    int count = 0;
+    order[count++] = BLOCK_TIMESTAMP;
+    if (filter.column >= 0) order[count++] = BLOCK_FLOAT + filter.column;
+    int screened = count;
+    order[count++] = BLOCK_CLASS;
+    order[count++] = BLOCK_CONTEXT;
+    for (int c = 0; c < FLOAT_COLUMNS; c++) {
+      if (c != filter.column && (filter.columns >> c & 1)) order[count++] = BLOCK_FLOAT + c;
+    }
+
+    rows.assign(header.rows, Record{});
+    std::vector<uint8_t> block;
+    for (int i = 0; i < count; i++) {
+      if (i == screened && std::none_of(rows.begin(), rows.end(),
+                                        [&](const Record& r) { return filter.keeps(r); })) {
+        rows.clear();
+        return true;
+      }
+      int b = order[i];
+      block.resize(header.blockBytes[b]);
+      if (std::fseek(file, (long)offsets[b], SEEK_SET) != 0 ||
+          (!block.empty() && std::fread(block.data(), block.size(), 1, file) != 1)) {
+        return false;
+      }
+      stats.bytesRead += block.size();
+      const uint8_t* begin = block.data();
+      const uint8_t* end = begin + block.size();
+      bool ok = b == BLOCK_TIMESTAMP ? decodeTimestamps(begin, end, header.rows, rows)
+              : b == BLOCK_CLASS     ? decodeRuns<&Record::classification>(begin, end,
+                                                                           header.rows, rows)
+              : b == BLOCK_CONTEXT   ? decodeRuns<&Record::context>(begin, end, header.rows, rows)
+                                     : decodeFloats(begin, block.size(), header.rows,
+                                                    b - BLOCK_FLOAT, rows);
+      if (!ok) return false;
+    }
+    return true;
+  }
+};
+
+}  // namespace record_store
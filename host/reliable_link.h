@@ -0,0 +1,191 @@
+/*
+  Reliable Event Delivery (host)
+  Receiving end of the firmware's framed events (include/reliable_link.h):
+  checks each "@seq,base,ms,crc:line" frame, drops duplicates, tracks
+  the gaps and builds the "ack <next> <sack>" line that acknowledges
+  everything received so far. Frames that arrive past a gap are held and
+  released in sequence order once the gap is filled or abandoned, so
+  records reach the store in device time order.
+
+  Frames before the device's base were abandoned from its window; they
+  are counted as lost and no longer waited for. Device times are mapped
+  to host wall time with the smallest transit delay seen, so a frame
+  that was resent keeps the time it was generated. That offset is
+  allowed to grow by SKEW_PER_MS to follow drift between the two clocks,
+  and the mapped times never step backwards.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+namespace reliable_link {
+
+constexpr int SACK_BITS = 32;
+constexpr double SKEW_PER_MS = 1e-4;  // 100 ppm
+
+struct Frame {
+  uint32_t sequence;
+  uint32_t base;
+  uint32_t deviceMs;
+  char* line;  // inside the parsed text
+};
+
+struct Delivery {
+  std::string line;
+  uint32_t deviceMs;
+  int64_t receivedMs;
+};
+
+// CRC-16/CCITT-FALSE, continued over several pieces
+inline uint16_t crc16(const char* data, size_t length, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)((uint8_t)data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// A frame with a matching CRC; the text is modified
+inline bool parseFrame(char* text, Frame& frame) {
+  if (text[0] != '@') return false;
+  char* colon = std::strchr(text, ':');
+  if (!colon) return false;
+  *colon = '\0';
+  char* crcField = std::strrchr(text, ',');
+  if (!crcField) return false;
+
+  unsigned long sequence, base, deviceMs;
+  unsigned crc;
+  char tail;
+  if (std::sscanf(text + 1, "%lu,%lu,%lu,%4x%c", &sequence, &base, &deviceMs, &crc, &tail) != 4) {
+    return false;
+  }
+  char* line = colon + 1;
+  line[std::strcspn(line, "\r\n")] = '\0';
+  uint16_t check = crc16(text + 1, crcField - (text + 1));
+  check = crc16(":", 1, check);
+  check = crc16(line, std::strlen(line), check);
+  if (check != crc) return false;
+
+  frame = {(uint32_t)sequence, (uint32_t)base, (uint32_t)deviceMs, line};
+  return true;
+}
+
+class Receiver {
+ public:
+  uint64_t delivered = 0;
+  uint64_t duplicates = 0;
+  uint64_t lost = 0;  // abandoned by the device
+
+  // Expect frames from next on (the device's base when it was enabled)
+  void reset(uint32_t next) {
+    expected = next;
+    received = 0;
+    started = true;
+    offsetKnown = false;
+    held.clear();
+  }
+
+  // True for a frame not received before; it is held until release()
+  bool accept(const Frame& frame, int64_t receivedMs) {
+    if (!started) reset(frame.base);
+    skipTo(frame.base);
+    if ((int32_t)(frame.sequence - expected) < 0) {
+      duplicates++;
+      return false;
+    }
+    if (frame.sequence - expected > SACK_BITS) skipTo(frame.sequence - SACK_BITS);
+
+    uint32_t offset = frame.sequence - expected;
+    if (offset == 0) {
+      step();
+    } else {
+      uint32_t bit = 1u << (offset - 1);
+      if (received & bit) {
+        duplicates++;
+        return false;
+      }
+      received |= bit;
+    }
+    held[frame.sequence] = {frame.line, frame.deviceMs, receivedMs};
+    return true;
+  }
+
+  // The next frame in sequence order, once nothing before it is awaited
+  bool release(Delivery& delivery) {
+    auto first = held.begin();
+    if (first == held.end() || (int32_t)(first->first - expected) >= 0) return false;
+    delivery = std::move(first->second);
+    held.erase(first);
+    delivered++;
+    return true;
+  }
+
+  // "ack <next> <sack>" for everything received so far
+  std::string ack() const {
+    char line[40];
+    std::snprintf(line, sizeof(line), "ack %lu %lx\r\n", (unsigned long)expected,
+                  (unsigned long)received);
+    return line;
+  }
+
+  // Host time of a device millis() stamp, given when the frame arrived;
+  // never earlier than the time returned before
+  int64_t wallTime(uint32_t deviceMs, int64_t receivedMs) {
+    double sample = (double)(receivedMs - (int64_t)deviceMs);
+    if (!offsetKnown) {
+      offset = sample;
+      offsetKnown = true;
+    } else {
+      double elapsed = (double)std::max<int64_t>(receivedMs - lastReceivedMs, 0);
+      offset = std::min(offset + elapsed * SKEW_PER_MS, sample);
+    }
+    lastReceivedMs = std::max(lastReceivedMs, receivedMs);
+    lastWallMs = std::max(lastWallMs, (int64_t)deviceMs + (int64_t)offset);
+    return lastWallMs;
+  }
+
+ private:
+  uint32_t expected = 0;
+  uint32_t received = 0;  // bit i: frame expected + 1 + i
+  bool started = false;
+  double offset = 0;
+  bool offsetKnown = false;
+  int64_t lastReceivedMs = 0;
+  int64_t lastWallMs = 0;
+  std::map<uint32_t, Delivery> held;  // received, not yet released
+
+  // Past the frame at expected, and any received run after it
+  void step() {
+    bool have;
+    do {
+      expected++;
+      have = received & 1;
+      received >>= 1;
+    } while (have);
+  }
+
+  // Stop waiting for frames before sequence
+  void skipTo(uint32_t sequence) {
+    if ((int32_t)(sequence - expected) <= 0) return;
+    if (sequence - expected > SACK_BITS) {
+      lost += sequence - expected - __builtin_popcount(received);
+      expected = sequence;
+      received = 0;
+      return;
+    }
+    while ((int32_t)(sequence - expected) > 0) {
+      lost++;
+      step();
+    }
+  }
+};
+
+}  // namespace reliable_link
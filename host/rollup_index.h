@@ -0,0 +1,416 @@
+/*
+  Rollup Index (host)
+  Minute, hour and day rollups of each device's classification records,
+  kept next to the record store (record_store.h). Trend queries over days
+  or months read a few precomputed buckets, never the raw segments.
+
+  Every bucket holds:
+
+    rows          records reported in it
+    class time    milliseconds spent in each class. The firmware reports
+                  a class when it changes, so a record holds until the
+                  next one however long that takes; silence alone says
+                  nothing. Only a stop the ingest sees (end(): a BOOT
+                  line, or the port closing) ends it early, at the last
+                  line heard from the device. Intervals are split across
+                  bucket boundaries, so every level sums to the same time.
+    sketches      frequency and amplitude: min, max, sum and a fixed-bin
+                  histogram, which merge exactly and give approximate
+                  quantiles
+
+  All three levels are updated on ingest, in constant time per record
+  (plus the buckets a long interval crosses). The query planner serves a
+  series from the coarsest level no wider than the requested resolution.
+  A single range total is split into whole days in the middle, with hours
+  and then minutes at the ragged ends, so its cost grows with the day
+  count, not the record count.
+
+  Buckets are aligned to UTC. Files are DIR/<device>/rollup/<level>-<group
+  start>.rlp, one per group of buckets (a day of minutes, 32 days of
+  hours, 1024 days of days), written like the segments. The interval of
+  a device's last record is credited when the next one arrives, so a new
+  ingest resumes from the last stored record, unless rollup/stopped says
+  a stop already ended it. A stop while nothing was ingesting is not
+  seen, nor are stops in a rebuild from the segments: the time counts as
+  the last class.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "record_store.h"
+
+namespace record_store {
+
+constexpr uint32_t ROLLUP_MAGIC = 0x5052504EUL;  // "NPRP"
+constexpr uint16_t ROLLUP_VERSION = 1;
+constexpr int SKETCH_BINS = 32;
+
+enum Level { LEVEL_MINUTE, LEVEL_HOUR, LEVEL_DAY, LEVEL_COUNT };
+constexpr const char* LEVEL_NAMES[LEVEL_COUNT] = {"minute", "hour", "day"};
+constexpr int64_t LEVEL_SPAN_MS[LEVEL_COUNT] = {60LL * 1000, 3600LL * 1000, 86400LL * 1000};
+constexpr int64_t GROUP_SPAN_MS[LEVEL_COUNT] = {86400LL * 1000, 32 * 86400LL * 1000,
+                                                1024 * 86400LL * 1000};
+
+// Sketched columns and their histogram ranges
+enum SketchColumn { SKETCH_FREQUENCY, SKETCH_AMPLITUDE, SKETCH_COLUMNS };
+constexpr int SKETCH_SOURCE[SKETCH_COLUMNS] = {COLUMN_FREQUENCY, COLUMN_AMPLITUDE};
+constexpr float SKETCH_MAX[SKETCH_COLUMNS] = {16.0f, 3.3f};  // Hz, volts; from 0
+
+inline int64_t floorTo(int64_t t, int64_t span) {
+  return (t >= 0 ? t / span : (t + 1) / span - 1) * span;
+}
+
+struct Sketch {
+  float min, max;
+  double sum;
+  uint32_t count;
+  uint32_t bins[SKETCH_BINS];
+
+  void clear() {
+    min = INFINITY;
+    max = -INFINITY;
+    sum = 0;
+    count = 0;
+    std::fill(bins, bins + SKETCH_BINS, 0u);
+  }
+
+  void add(float value, float range) {
+    min = std::min(min, value);
+    max = std::max(max, value);
+    sum += value;
+    count++;
+    int bin = (int)(value / range * SKETCH_BINS);
+    bins[std::clamp(bin, 0, SKETCH_BINS - 1)]++;
+  }
+
+  void merge(const Sketch& other) {
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+    count += other.count;
+    for (int b = 0; b < SKETCH_BINS; b++) bins[b] += other.bins[b];
+  }
+
+  double mean() const { return count ? sum / count : NAN; }
+
+  // Interpolated within the bin, clamped to the exact extremes
+  float quantile(float q, float range) const {
+    if (!count) return NAN;
+    double target = q * count, seen = 0;
+    for (int b = 0; b < SKETCH_BINS; b++) {
+      if (bins[b] && seen + bins[b] >= target) {
+        float value = (b + (float)((target - seen) / bins[b])) * range / SKETCH_BINS;
+        return std::clamp(value, min, max);
+      }
+      seen += bins[b];
+    }
+    return max;
+  }
+};
+
+struct RollupBucket {
+  int64_t startMs;
+  uint32_t rows;
+  uint32_t reserved;  // keeps the 64-bit fields aligned
+  double classMs[CLASS_COUNT];
+  Sketch sketches[SKETCH_COLUMNS];
+
+  static RollupBucket empty(int64_t start) {
+    RollupBucket b = {};
+    b.startMs = start;
+    for (Sketch& s : b.sketches) s.clear();
+    return b;
+  }
+
+  void merge(const RollupBucket& other) {
+    rows += other.rows;
+    for (int k = 0; k < CLASS_COUNT; k++) classMs[k] += other.classMs[k];
+    for (int c = 0; c < SKETCH_COLUMNS; c++) sketches[c].merge(other.sketches[c]);
+  }
+};
+
+struct RollupFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t level;
+  uint32_t buckets;
+  uint32_t bucketSize;  // sizeof(RollupBucket) when written
+  int64_t groupStartMs;
+};
+
+// Level and bucket span a query is answered at
+struct RollupPlan {
+  Level level;
+  int64_t fromMs, toMs;  // aligned to the level
+  int64_t stepMs;        // output resolution, a multiple of the level span
+  uint64_t bucketsRead = 0;
+};
+
+class RollupIndex {
+ public:
+  explicit RollupIndex(std::filesystem::path directory) : root(std::move(directory)) {}
+  ~RollupIndex() { flush(); }
+
+  // Incremental update for one ingested record
+  void add(const std::string& device, const Record& record) {
+    auto last = lastRecords.find(device);
+    if (last != lastRecords.end() && record.timestampMs > last->second.timestampMs) {
+      const Record& previous = last->second;
+      creditInterval(device, previous.classification, previous.timestampMs, record.timestampMs);
+    }
+    lastRecords[device] = record;
+
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+      RollupBucket& b = bucket(device, (Level)level, record.timestampMs);
+      b.rows++;
+      for (int c = 0; c < SKETCH_COLUMNS; c++) {
+        b.sketches[c].add(record.values[SKETCH_SOURCE[c]], SKETCH_MAX[c]);
+      }
+    }
+  }
+
+  // The device stopped reporting (rebooted, or its port closed) after a
+  // last line at lastHeardMs: its last record holds until then, and the
+  // next record starts afresh
+  void end(const std::string& device, int64_t lastHeardMs) {
+    auto last = lastRecords.find(device);
+    if (last == lastRecords.end()) return;
+    const Record& previous = last->second;
+    if (lastHeardMs > previous.timestampMs) {
+      creditInterval(device, previous.classification, previous.timestampMs, lastHeardMs);
+    }
+    stops[device] = previous.timestampMs;
+    lastRecords.erase(last);
+  }
+
+  // Continue from the last record the store holds for the device, whose
+  // interval the next add() credits
+  void resume(RecordStore& store, const std::string& device) {
+    Filter all;
+    RangeSummary stored = store.summarize(device, all);
+    if (!stored.rows) return;
+    int64_t stopped;
+    FILE* file = std::fopen(stopPath(device).c_str(), "rb");
+    bool ended = file && std::fread(&stopped, sizeof(stopped), 1, file) == 1 &&
+                 stopped == stored.lastMs;
+    if (file) std::fclose(file);
+    if (ended) return;
+    Filter last;
+    last.fromMs = stored.lastMs;
+    store.scan(device, last, [&](const Record& r) { lastRecords[device] = r; });
+  }
+
+  // Write every changed group; false if any write failed
+  bool flush() {
+    bool ok = true;
+    for (auto& [key, group] : groups) {
+      if (group.dirty) ok = writeGroup(key, group) && ok;
+    }
+    // After the groups, so a stop is only recorded with its credit
+    for (auto it = stops.begin(); it != stops.end();) {
+      bool written = ok && writeStop(it->first, it->second);
+      ok = written && ok;
+      it = written ? stops.erase(it) : std::next(it);
+    }
+    return ok;
+  }
+
+  // Drop a device's rollups, before a rebuild
+  void clear(const std::string& device) {
+    for (auto it = groups.begin(); it != groups.end();) {
+      it = std::get<0>(it->first) == device ? groups.erase(it) : std::next(it);
+    }
+    lastRecords.erase(device);
+    stops.erase(device);
+    std::error_code error;
+    std::filesystem::remove_all(root / device / "rollup", error);
+  }
+
+  // Coarsest level no wider than the resolution; the range widened to it
+  static RollupPlan plan(int64_t fromMs, int64_t toMs, int64_t resolutionMs) {
+    int level = LEVEL_MINUTE;
+    while (level + 1 < LEVEL_COUNT && LEVEL_SPAN_MS[level + 1] <= resolutionMs) level++;
+    int64_t span = LEVEL_SPAN_MS[level];
+    int64_t step = std::max(span, resolutionMs / span * span);
+    int64_t from = floorTo(fromMs, span);
+    int64_t to = floorTo(toMs - 1, span) + span;
+    return {(Level)level, from, to, step};
+  }
+
+  // One merged bucket per step of the plan, empty steps included
+  std::vector<RollupBucket> series(const std::string& device, RollupPlan& p) {
+    std::vector<RollupBucket> out;
+    for (int64_t start = p.fromMs; start < p.toMs; start += p.stepMs) {
+      RollupBucket merged = RollupBucket::empty(start);
+      int64_t end = std::min(start + p.stepMs, p.toMs);
+      for (int64_t t = start; t < end; t += LEVEL_SPAN_MS[p.level]) {
+        if (const RollupBucket* b = find(device, p.level, t)) {
+          merged.merge(*b);
+          p.bucketsRead++;
+        }
+      }
+      out.push_back(merged);
+    }
+    return out;
+  }
+
+  // The whole range as one bucket: days where they fit, hours and
+  // minutes at the ends. The range is widened to whole minutes.
+  RollupBucket total(const std::string& device, int64_t fromMs, int64_t toMs,
+                     uint64_t* bucketsRead = nullptr) {
+    RollupBucket merged = RollupBucket::empty(floorTo(fromMs, LEVEL_SPAN_MS[LEVEL_MINUTE]));
+    int64_t t = merged.startMs;
+    int64_t end = floorTo(toMs - 1, LEVEL_SPAN_MS[LEVEL_MINUTE]) + LEVEL_SPAN_MS[LEVEL_MINUTE];
+    uint64_t reads = 0;
+    while (t < end) {
+      int level = LEVEL_DAY;
+      while (level > LEVEL_MINUTE &&
+             (floorTo(t, LEVEL_SPAN_MS[level]) != t || t + LEVEL_SPAN_MS[level] > end)) {
+        level--;
+      }
+      if (const RollupBucket* b = find(device, (Level)level, t)) {
+        merged.merge(*b);
+        reads++;
+      }
+      t += LEVEL_SPAN_MS[level];
+    }
+    if (bucketsRead) *bucketsRead = reads;
+    return merged;
+  }
+
+ private:
+  typedef std::tuple<std::string, int, int64_t> GroupKey;  // device, level, group start
+
+  struct Group {
+    std::vector<RollupBucket> buckets;  // sorted by start
+    bool dirty = false;
+  };
+
+  std::filesystem::path root;
+  std::map<GroupKey, Group> groups;
+  std::map<std::string, Record> lastRecords;
+  std::map<std::string, int64_t> stops;  // ended record's time, until flushed
+
+  std::filesystem::path stopPath(const std::string& device) const {
+    return root / device / "rollup" / "stopped";
+  }
+
+  // Timestamp of the last record a stop ended, written like the groups
+  bool writeStop(const std::string& device, int64_t timestampMs) const {
+    std::filesystem::path path = stopPath(device);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(&timestampMs, sizeof(timestampMs), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    if (ok) std::filesystem::rename(temporary, path, error);
+    if (!ok || error) {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+    return true;
+  }
+
+  std::filesystem::path groupPath(const GroupKey& key) const {
+    char name[48];
+    std::snprintf(name, sizeof(name), "%s-%013lld.rlp", LEVEL_NAMES[std::get<1>(key)],
+                  (long long)std::get<2>(key));
+    return root / std::get<0>(key) / "rollup" / name;
+  }
+
+  Group& group(const std::string& device, Level level, int64_t t) {
+    GroupKey key{device, level, floorTo(t, GROUP_SPAN_MS[level])};
+    auto it = groups.find(key);
+    if (it != groups.end()) return it->second;
+    Group& g = groups[key];
+    readGroup(key, g);
+    return g;
+  }
+
+  RollupBucket& bucket(const std::string& device, Level level, int64_t t) {
+    Group& g = group(device, level, t);
+    int64_t start = floorTo(t, LEVEL_SPAN_MS[level]);
+    auto it = std::lower_bound(g.buckets.begin(), g.buckets.end(), start,
+                               [](const RollupBucket& b, int64_t s) { return b.startMs < s; });
+    if (it == g.buckets.end() || it->startMs != start) {
+      it = g.buckets.insert(it, RollupBucket::empty(start));
+    }
+    g.dirty = true;
+    return *it;
+  }
+
+  const RollupBucket* find(const std::string& device, Level level, int64_t start) {
+    Group& g = group(device, level, start);
+    auto it = std::lower_bound(g.buckets.begin(), g.buckets.end(), start,
+                               [](const RollupBucket& b, int64_t s) { return b.startMs < s; });
+    return it != g.buckets.end() && it->startMs == start ? &*it : nullptr;
+  }
+
+  // Class time of [from, to), split at the bucket boundaries of every level
+  void creditInterval(const std::string& device, uint8_t classification, int64_t from,
+                      int64_t to) {
+    if (classification >= CLASS_COUNT) return;
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+      for (int64_t t = from; t < to;) {
+        int64_t next = std::min(to, floorTo(t, LEVEL_SPAN_MS[level]) + LEVEL_SPAN_MS[level]);
+        bucket(device, (Level)level, t).classMs[classification] += (double)(next - t);
+        t = next;
+      }
+    }
+  }
+
+  void readGroup(const GroupKey& key, Group& g) const {
+    FILE* file = std::fopen(groupPath(key).c_str(), "rb");
+    if (!file) return;
+    RollupFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == ROLLUP_MAGIC &&
+        header.version == ROLLUP_VERSION && header.bucketSize == sizeof(RollupBucket) &&
+        header.level == std::get<1>(key)) {
+      g.buckets.resize(header.buckets);
+      if (header.buckets &&
+          std::fread(g.buckets.data(), sizeof(RollupBucket), header.buckets, file) !=
+              header.buckets) {
+        g.buckets.clear();
+      }
+    }
+    std::fclose(file);
+  }
+
+  bool writeGroup(const GroupKey& key, Group& g) const {
+    std::filesystem::path path = groupPath(key);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+    RollupFileHeader header = {ROLLUP_MAGIC, ROLLUP_VERSION, (uint16_t)std::get<1>(key),
+                               (uint32_t)g.buckets.size(), sizeof(RollupBucket), std::get<2>(key)};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (g.buckets.empty() || std::fwrite(g.buckets.data(), sizeof(RollupBucket),
+                                                g.buckets.size(), file) == g.buckets.size());
+    ok = std::fclose(file) == 0 && ok;
+    if (ok) std::filesystem::rename(temporary, path, error);
+    if (!ok || error) {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+    g.dirty = false;
+    return true;
+  }
+};
+
+}  // namespace record_store
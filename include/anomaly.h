@@ -0,0 +1,92 @@
+/*
+  Anomaly Score
+  How far a window lies from the windows recorded during calibration, as
+  a squared Mahalanobis distance over the normalized window vector
+  (prototypeVector() in tremor.h). Patterns none of the classes were
+  made for - a new artefact, a failing electrode, an unusual tremor -
+  land far from that distribution whatever class the rules give them.
+
+  Calibration (console "calibrate", and a first boot with no stored
+  model) collects windows into a running mean and co-moment matrix, then
+  keeps the Cholesky factor of the covariance. A small ridge is added
+  first, so a feature that never varied (no accelerometer fitted) cannot
+  make it singular. Scoring is one forward substitution, ANOMALY_FEATURES
+  squared over two multiply-adds whatever the signal.
+
+  The squared distance of a calibration-like window follows roughly a
+  chi-square law with ANOMALY_FEATURES degrees of freedom. The default
+  threshold is far out in its tail (p = 1e-5): window features are
+  heavier-tailed than Gaussian, and a 0.1 % tail already raised events
+  on ordinary EMG. Anomalous windows are reported at most
+  once per ANOMALY_EVENT_INTERVAL_MS: the worst one since the last event,
+  with how many there were. Windows dropped for poor signal, or held
+  during vigorous movement, are never scored.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "prototypes.h"
+
+#define ANOMALY_FEATURES PROTOTYPE_FEATURES
+#define ANOMALY_TRIANGLE (ANOMALY_FEATURES * (ANOMALY_FEATURES + 1) / 2)
+#define ANOMALY_DEFAULT_WINDOWS 120      // 30 s of 50-sample windows at 200 Hz
+#define ANOMALY_MIN_WINDOWS 20
+#define ANOMALY_MAX_WINDOWS 2000
+#define ANOMALY_RIDGE 0.05f              // normalized units squared
+#define ANOMALY_DEFAULT_THRESHOLD 37.3f  // chi-square, 8 degrees of freedom, p = 1e-5
+#define ANOMALY_EVENT_INTERVAL_MS 1000
+
+// Stored calibration: lower triangle packed row by row, the diagonal
+// held as reciprocals so scoring never divides
+struct AnomalyModel {
+  float mean[ANOMALY_FEATURES];
+  float cholesky[ANOMALY_TRIANGLE];
+  uint16_t windows;   // calibration windows, 0 = no model
+  uint16_t reserved;  // keeps the stored record free of padding bytes
+};
+
+struct AnomalyEvent {
+  float score;
+  uint16_t windows;        // anomalous windows it stands for
+  uint8_t classification;  // TremorClass the worst one was given
+  float vector[ANOMALY_FEATURES];
+};
+
+struct AnomalyDetector {
+  AnomalyModel model = {};
+  float lastScore = -1;  // -1 without a model
+
+  // Calibration in progress
+  uint16_t target = 0;
+  uint16_t count = 0;
+  float mean[ANOMALY_FEATURES];
+  float scatter[ANOMALY_TRIANGLE];
+
+  // Anomalous windows not yet reported
+  AnomalyEvent pending = {};
+  uint32_t lastEvent = 0;
+  bool reported = false;
+
+  bool ready() const { return model.windows > 0; }
+  bool calibrating() const { return target > 0; }
+
+  void startCalibration(uint16_t windows);
+
+  // Feed one calibration window; true when the model has been replaced
+  bool calibrate(const float* vector);
+
+  // Squared distance from the calibration distribution
+  float score(const float* vector) const;
+
+  // Score a window; true with the event to send when one is due
+  bool check(const float* vector, uint8_t classification, float threshold, uint32_t now,
+             AnomalyEvent& event);
+};
+
+// ANOMALY:score,windows,class,v0,...,v7
+void sendAnomaly(const AnomalyEvent& event, const char* const* classNames);
+
+// ANOMALY_MODEL:windows,calibrated,target,threshold,last_score
+void sendAnomalyModel(const AnomalyDetector& detector, float threshold);
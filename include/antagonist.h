@@ -0,0 +1,135 @@
+/*
+  Flexor/Extensor Coupling
+  Hardware: a second BioAmp EXG Pill over the antagonist (extensor) muscle
+  Objective: tell alternating tremor (flexor and extensor bursts in
+  anti-phase, typical of Parkinsonian rest tremor) from co-contraction
+  (synchronous bursts, more typical of essential or enhanced physiological
+  tremor).
+
+  Each channel is high-passed, rectified and low-passed into an envelope
+  that keeps the 3-12 Hz tremor modulation, then decimated to about
+  ANTAGONIST_ENVELOPE_HZ so a segment covers the same time at any sample
+  rate. Per segment of ANTAGONIST_FFT_SIZE envelope samples:
+
+    correlation  normalized cross-correlation of the envelopes over
+                 +/- half the longest tremor period (negative at lag 0
+                 for alternating bursts)
+    coherence    magnitude-squared coherence, 3-12 Hz, from cross and
+                 auto spectra averaged over ANTAGONIST_AVERAGES segments
+    phase        cross-spectrum phase at the most coherent frequency
+                 (~180 degrees alternating, ~0 co-contraction)
+
+  Both envelopes go through one complex FFT (flexor real, extensor
+  imaginary). push() only stores envelope samples; analyze() runs in the
+  analysis task alongside window classification.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "device_config.h"
+#include "fft.h"
+#include "pipeline.h"
+
+#define ANTAGONIST_FFT_SIZE 128
+#define ANTAGONIST_ENVELOPE_HZ 50      // ~2.6 s segments, 0.4 Hz bins
+#define ANTAGONIST_BAND_LOW_HZ 3.0f
+#define ANTAGONIST_BAND_HIGH_HZ 12.0f
+#define ANTAGONIST_AVERAGES 8          // segments in the spectral average
+#define ANTAGONIST_MIN_SEGMENTS 4      // before a pattern is reported
+#define ANTAGONIST_COHERENCE_MIN 0.35f // ~95% significance for 8 averages
+#define ANTAGONIST_MAX_LAG (ANTAGONIST_FFT_SIZE / 4)
+
+enum TremorPattern : uint8_t {
+  PATTERN_UNKNOWN,         // not enough segments yet
+  PATTERN_UNCOUPLED,       // no significant 3-12 Hz coherence
+  PATTERN_ALTERNATING,     // |phase| > 120 degrees
+  PATTERN_CO_CONTRACTION,  // |phase| < 60 degrees
+  PATTERN_MIXED,           // coherent, phase in between
+};
+
+struct EmgHighPassParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float LOW_HZ = 20.0f;  // motion artefact and DC out
+};
+
+struct EmgEnvelopeParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float HIGH_HZ = 15.0f;  // tremor modulation in, aliasing out
+};
+
+typedef FilterChain<HighPassFilter<EmgHighPassParams>, Rectifier,
+                    LowPassFilter<EmgEnvelopeParams>> EmgEnvelope;
+
+struct AntagonistResult {
+  float correlationZero;  // envelope correlation at lag 0, -1..1
+  float correlationPeak;  // largest |correlation| in the lag range, signed
+  float peakLagMs;        // its lag; positive when the extensor follows
+  float coherence;        // mean coherence over 3-12 Hz
+  float peakCoherence;
+  float peakHz;           // frequency of peakCoherence
+  float phaseDeg;         // flexor minus extensor phase at peakHz
+  TremorPattern pattern;
+};
+
+struct AntagonistFeatures {
+  EmgEnvelope flexorEnvelope, extensorEnvelope;
+  Fft<ANTAGONIST_FFT_SIZE> fft;
+
+  int decimation = 1;
+  float envelopeRate = SAMPLE_RATE;
+  int phase = 0;  // samples since the last stored envelope value
+
+  // Two segment buffers: one filling, one waiting for analyze()
+  float flexor[2][ANTAGONIST_FFT_SIZE];
+  float extensor[2][ANTAGONIST_FFT_SIZE];
+  int filling = 0;
+  int count = 0;
+  bool pending = false;
+  uint32_t overruns = 0;  // segments dropped while one was still pending
+
+  // Averaged spectra per bin
+  float autoFlexor[ANTAGONIST_FFT_SIZE / 2 + 1];
+  float autoExtensor[ANTAGONIST_FFT_SIZE / 2 + 1];
+  float crossRe[ANTAGONIST_FFT_SIZE / 2 + 1];
+  float crossIm[ANTAGONIST_FFT_SIZE / 2 + 1];
+  int segments = 0;
+
+  AntagonistFeatures() { setSampleRate(SAMPLE_RATE); }
+
+  void setSampleRate(float fs);
+  void reset();
+
+  // Returns true when a segment is waiting for analyze()
+  inline bool push(float flexorVolts, float extensorVolts) {
+    float f = flexorEnvelope.process(flexorVolts);
+    float e = extensorEnvelope.process(extensorVolts);
+    if (++phase < decimation) return pending;
+    phase = 0;
+
+    flexor[filling][count] = f;
+    extensor[filling][count] = e;
+    if (++count >= ANTAGONIST_FFT_SIZE) {
+      count = 0;
+      if (pending) {
+        overruns++;  // keep the waiting segment, refill this one
+      } else {
+        pending = true;
+        filling ^= 1;
+      }
+    }
+    return pending;
+  }
+
+  // Process the waiting segment; false if there was none
+  bool analyze(AntagonistResult& result);
+
+  // Drop the waiting segment (e.g. either channel's signal quality is low)
+  inline void discard() { pending = false; }
+};
+
+const char* tremorPatternName(TremorPattern pattern);
+
+// ANTAGONIST:r0,peak,lagMs,coherence,peakCoherence,peakHz,phaseDeg,PATTERN
+void sendAntagonist(const AntagonistResult& result);
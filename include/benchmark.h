@@ -0,0 +1,10 @@
+/*
+  On-target Benchmarks
+  Built only with -DBENCHMARK_MODE (the esp32dev-bench environment).
+  Times each pipeline stage with the CPU cycle counter and prints a
+  cycle_budget::Calibration block to paste into cycle_budget.h.
+*/
+
+#pragma once
+
+void runBenchmarks();
@@ -0,0 +1,52 @@
+/*
+  Serial Command Console
+  Line-oriented commands read from the UART without blocking: each poll
+  consumes at most CONSOLE_BYTES_PER_POLL bytes into a fixed line buffer
+  and a completed line is tokenized in place and dispatched. Replies go
+  through the telemetry channel as "OK ..." / "ERR ..." lines so they
+  interleave cleanly with the sample stream.
+
+  A command may take raw bytes after its line (firmware update blocks):
+  consoleReadPayload() moves the next N bytes into the caller's buffer,
+  CONSOLE_PAYLOAD_PER_POLL at a time, before lines are parsed again. A
+  payload that stalls for CONSOLE_PAYLOAD_TIMEOUT_MS is abandoned, and
+  its handler still runs with the short count, so it can release what it
+  set aside for the bytes. The command line ends in "\n" or "\r\n".
+
+  Commands:
+    mode tremor|eog
+    rate <hz>
+    window <samples>
+    thresholds freq <f0> <f1> <f2>
+    thresholds amp <a0> <a1> <a2>
+    thresholds saccade <factor>
+    thresholds blink <mV/s>
+    display raw|minmax|lttb [points/s]
+    psd [overlap% [averages]]
+    config | stats | profiler [reset] | quantiles | quality | memory | log
+    capture <samples>
+    save | defaults
+    reliable [on|off] | ack <next> [sack]
+    ota [begin <bytes> <crc> | block <i> <bytes> <crc> | finish | apply | abort]
+    help
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CONSOLE_LINE_MAX 64
+#define CONSOLE_MAX_TOKENS 6
+#define CONSOLE_BYTES_PER_POLL 32
+#define CONSOLE_PAYLOAD_PER_POLL 128  // outruns 115200 baud at the 5 ms poll
+#define CONSOLE_PAYLOAD_TIMEOUT_MS 2000
+#define CONSOLE_RX_BUFFER 1024        // UART receive buffer, set before Serial.begin
+
+typedef void (*PayloadHandler)(uint16_t length, bool complete);
+
+// Consume pending RX bytes (bounded) and run any completed command
+void consolePoll();
+
+// Read the length bytes following this command into buffer (dropped when
+// null), then call done with the count; complete is false after a timeout
+void consoleReadPayload(uint8_t* buffer, uint16_t length, PayloadHandler done);
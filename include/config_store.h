@@ -0,0 +1,89 @@
+/*
+  Persistent Configuration Store
+  Keeps deviceConfig in NVS as a versioned, CRC-checked record so live
+  tuning from the console survives a reset.
+
+  Record: header (magic, version, payload size) + DeviceConfig payload,
+  CRC-32 over both. DeviceConfig is append-only: a record from an older
+  version is migrated by copying the fields it has over the defaults.
+  Newer, corrupt or missing records fall back to the defaults. Enrolled
+  patient prototypes (prototypes.h), the anomaly calibration (anomaly.h)
+  and firmware update progress (ota_update.h) are records of the same
+  form.
+
+  Writes are lazy: changes only mark the store dirty, and configService()
+  writes once the settings have been quiet for CONFIG_SAVE_DELAY_MS, so a
+  burst of console commands costs one flash write, never on the sampling
+  path. A console save or erase is written there too, on the next pass.
+  Each build default mode uses its own key, so flashing the EOG build
+  does not boot into a tremor configuration saved by the other one.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "anomaly.h"
+#include "device_config.h"
+#include "ota_update.h"
+#include "prototypes.h"
+
+#define CONFIG_VERSION 5  // 2: display stream settings, 3: PSD averaging, 4: context thresholds,
+                          // 5: anomaly threshold
+#define CONFIG_MAGIC 0x4E504346UL  // "NPCF"
+#define CONFIG_NAMESPACE "neuropulse"
+#define CONFIG_SAVE_DELAY_MS 5000
+#define PROTOTYPE_VERSION 1
+#define PROTOTYPE_MAGIC 0x4E505054UL  // "NPPT"
+#define ANOMALY_VERSION 1
+#define ANOMALY_MAGIC 0x4E50414EUL    // "NPAN"
+#define OTA_PROGRESS_VERSION 1
+#define OTA_PROGRESS_MAGIC 0x4E504F54UL  // "NPOT"
+
+enum ConfigLoadStatus : uint8_t {
+  CONFIG_LOADED,
+  CONFIG_MIGRATED,
+  CONFIG_DEFAULTS,  // nothing stored yet
+  CONFIG_INVALID,   // corrupt, newer version or out of range; defaults used
+};
+
+struct ConfigRecordHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t payloadSize;
+};
+
+// Fill config from NVS, leaving the defaults it was passed where needed
+ConfigLoadStatus configLoad(DeviceConfig& config);
+
+// Note a change to deviceConfig; the write happens later in configService
+void configMarkDirty(uint32_t now);
+
+// Write a pending change once it has settled; call between samples
+void configService(uint32_t now);
+
+// Console "save" and "defaults": the write or erase happens on the next
+// configService pass without waiting for the settle delay, and a save
+// replies there with its result
+void configRequestSave();
+void configRequestErase();
+
+// Enrolled patient prototypes: their own record, written the same lazy
+// way; a table that fails its checks is left empty
+ConfigLoadStatus prototypesLoad(PrototypeTable& table);
+void prototypesMarkDirty(uint32_t now);
+void prototypesService(const PrototypeTable& table, uint32_t now);
+
+// Anomaly calibration, likewise; CONFIG_DEFAULTS when none was stored
+ConfigLoadStatus anomalyModelLoad(AnomalyModel& model);
+void anomalyModelMarkDirty(uint32_t now);
+void anomalyModelService(const AnomalyModel& model, uint32_t now);
+
+// Firmware update progress, written as soon as it changes (every
+// OTA_SAVE_BLOCKS blocks at most); CONFIG_DEFAULTS when no update is open
+ConfigLoadStatus otaProgressLoad(OtaProgress& progress);
+bool otaProgressSave(const OtaProgress& progress);
+void otaProgressErase();
+
+const char* configStatusName(ConfigLoadStatus status);
+uint32_t crc32(const uint8_t* data, uint32_t length, uint32_t crc = 0);
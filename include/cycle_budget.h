@@ -0,0 +1,196 @@
+/*
+  Cycle Budget Model
+  Predicts per-core CPU load, worst-case sample latency and serial link
+  bandwidth for a pipeline configuration. Shared by the firmware (which
+  static_asserts its active configuration) and the host planning tool.
+
+  Costs are in CPU cycles at 240 MHz. The defaults are first estimates;
+  flash the esp32dev-bench environment and paste the printed calibration
+  block over DEFAULT_CALIBRATION to refresh them from the real board.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace cycle_budget {
+
+constexpr uint32_t CPU_HZ = 240000000UL;
+constexpr uint8_t CORE_COUNT = 2;
+
+// Budget limits: headroom for WiFi/RTOS work and for UART jitter
+constexpr float MAX_CORE_LOAD = 0.75f;
+constexpr float MAX_LINK_LOAD = 0.80f;
+
+// TELEMETRY_JSON sends one frame per window (EOG: a window is one frame)
+enum TelemetryMode { TELEMETRY_TEXT, TELEMETRY_BINARY, TELEMETRY_EVENTS_ONLY, TELEMETRY_JSON };
+enum ModelKind { MODEL_RULES, MODEL_EOG_EVENTS, MODEL_NAIVE_BAYES, MODEL_COUNT };
+
+struct Calibration {
+  uint32_t adcReadCycles;          // analogRead() + voltage conversion, per channel
+  uint32_t filterCycles;           // low-pass + reset check, per channel
+  uint32_t featureSampleCycles;    // streaming accumulate, per feature per sample
+  uint32_t featureBatchCycles;     // batch recompute, per feature per buffered sample
+  uint32_t featureFinalizeCycles;  // per feature per window
+  uint32_t fftButterflyCycles;     // radix-2 butterfly with twiddle lookup
+  uint32_t spectralPointCycles;    // window, spectra and correlation, per FFT point
+  uint32_t adaptiveTapCycles;      // line enhancer predict and update, per tap
+  uint32_t busByteCycles;          // I2C transfer the caller waits out, per byte
+  uint32_t modelCycles[MODEL_COUNT];
+  uint32_t prototypeCycles;        // nearest-prototype search, per stored prototype
+  uint32_t anomalyCycles;          // window vector and its distance from calibration
+  uint32_t textSampleCycles;       // formatting two floats, per channel
+  uint32_t textWindowCycles;       // classification report formatting
+  uint32_t txByteCycles;           // UART driver cost per transmitted byte
+  uint32_t loopOverheadCycles;     // scheduling/timing overhead per sample
+};
+
+constexpr Calibration DEFAULT_CALIBRATION = {
+  2400,           // adcReadCycles
+  60,             // filterCycles
+  12,             // featureSampleCycles
+  14,             // featureBatchCycles
+  40,             // featureFinalizeCycles
+  40,             // fftButterflyCycles
+  160,            // spectralPointCycles
+  8,              // adaptiveTapCycles
+  5400,           // busByteCycles: 9 clocks at 400 kHz
+  {120, 400, 900}, // modelCycles
+  40,             // prototypeCycles
+  300,            // anomalyCycles
+  4800,           // textSampleCycles
+  30000,          // textWindowCycles
+  150,            // txByteCycles
+  300,            // loopOverheadCycles
+};
+
+struct PipelineConfig {
+  uint8_t channels;
+  uint16_t sampleRate;     // Hz, per channel
+  uint16_t windowSize;     // samples per analysis window
+  uint8_t features;        // features per channel
+  ModelKind model;
+  TelemetryMode telemetry;
+  bool streamingFeatures;  // per-sample accumulation instead of batch recompute
+  uint32_t baudRate;
+  uint8_t acquisitionCore;
+  uint8_t analysisCore;
+  uint8_t telemetryCore;
+  uint8_t auxChannels;     // acquired and filtered but not streamed
+  uint16_t fftSize;        // points per spectral segment, 0 = none
+  float fftPerSecond;      // spectral segments analysed per second
+  uint16_t psdSize;        // staged Welch segment points, 0 = none
+  uint16_t psdHop;         // samples between Welch segments
+  uint8_t adaptiveTaps;    // line enhancer taps on the feature path, 0 = none
+  uint16_t imuBusBytes;    // accelerometer FIFO bytes per second, 0 = none
+  uint8_t imuBurstBytes;   // longest single FIFO read
+  uint8_t contextFilters;  // motor context filter sections run per sample, 0 = none
+  uint8_t prototypes;      // patient prototypes searched per window, 0 = none
+  bool anomalyScore;       // windows scored against the anomaly calibration
+};
+
+struct Prediction {
+  float coreLoad[CORE_COUNT];  // fraction of each core, 0..1+
+  float worstCaseLatencyUs;    // longest blocking stretch on the acquisition core
+  float samplePeriodUs;
+  float linkBytesPerSec;
+  float linkLoad;              // fraction of the UART's byte rate
+};
+
+// Bytes put on the wire for one sample and for one window
+constexpr uint32_t sampleBytes(const PipelineConfig& cfg) {
+  return cfg.telemetry == TELEMETRY_TEXT     ? cfg.channels * 12u + 6u  // "v.vvv,f.fff," ... "q.qq\r\n"
+       : cfg.telemetry == TELEMETRY_BINARY   ? cfg.channels * 4u + 3u   // sync, int16 pairs, crc
+       : 0u;
+}
+
+// One report line per spectral segment
+constexpr uint32_t SPECTRAL_REPORT_BYTES = 64;
+
+constexpr uint32_t log2Floor(uint32_t n) {
+  return n > 1 ? 1 + log2Floor(n / 2) : 0;
+}
+
+constexpr uint32_t windowBytes(const PipelineConfig& cfg) {
+  return cfg.telemetry == TELEMETRY_TEXT ? 340u
+       : cfg.telemetry == TELEMETRY_JSON ? 64u + cfg.channels * 13u  // timestamp, channels, gaze, sqi
+       : 24u;
+}
+
+constexpr Prediction predict(const PipelineConfig& cfg,
+                             const Calibration& cal = DEFAULT_CALIBRATION) {
+  Prediction p = {{0, 0}, 0, 0, 0, 0};
+  const float windowsPerSec = (float)cfg.sampleRate / cfg.windowSize;
+  const uint32_t featureWork = cfg.features * cfg.channels;
+
+  // Work done on every sample tick
+  float acquire = cal.loopOverheadCycles
+                + (cfg.channels + cfg.auxChannels) * (cal.adcReadCycles + cal.filterCycles);
+  // Accelerometer: FIFO reads in the same loop, EMG envelope and three axes filtered
+  float imuRead = (float)cfg.imuBusBytes * cal.busByteCycles / cfg.sampleRate;
+  if (cfg.imuBusBytes) acquire += 4 * cal.filterCycles;
+  acquire += cfg.contextFilters * cal.filterCycles;
+  float accumulate = cfg.streamingFeatures ? featureWork * cal.featureSampleCycles : 0.0f;
+  if (cfg.psdSize && cfg.psdHop) {
+    // Staged: one segment's transform is spread evenly over its hop
+    float segment = cfg.psdSize / 2 * log2Floor(cfg.psdSize) * (float)cal.fftButterflyCycles
+                  + (cfg.psdSize + cfg.psdSize / 2 + 1) * (float)cal.spectralPointCycles;
+    accumulate += segment / cfg.psdHop;
+  }
+  accumulate += cfg.adaptiveTaps * cal.adaptiveTapCycles;
+  float sampleTx = sampleBytes(cfg) * cal.txByteCycles
+                 + (cfg.telemetry == TELEMETRY_TEXT ? cfg.channels * cal.textSampleCycles : 0u);
+
+  // Work done once per window
+  float finalize = cfg.streamingFeatures
+                 ? featureWork * cal.featureFinalizeCycles
+                 : featureWork * (cal.featureBatchCycles * cfg.windowSize + cal.featureFinalizeCycles);
+  float spectral = cfg.fftSize
+                  ? cfg.fftSize / 2 * log2Floor(cfg.fftSize) * (float)cal.fftButterflyCycles
+                    + cfg.fftSize * (float)cal.spectralPointCycles
+                  : 0.0f;
+  float analyse = finalize + cal.modelCycles[cfg.model] + cfg.prototypes * cal.prototypeCycles
+                + (cfg.anomalyScore ? cal.anomalyCycles : 0u);
+  float windowTx = windowBytes(cfg) * cal.txByteCycles
+                 + (cfg.telemetry == TELEMETRY_TEXT ? cal.textWindowCycles
+                  : cfg.telemetry == TELEMETRY_JSON ? (cfg.channels + 2) * cal.textSampleCycles / 2
+                  : 0u);
+
+  p.coreLoad[cfg.acquisitionCore] += (acquire + imuRead) * cfg.sampleRate / CPU_HZ;
+  p.coreLoad[cfg.analysisCore] += (accumulate * cfg.sampleRate + analyse * windowsPerSec
+                                   + spectral * cfg.fftPerSecond) / CPU_HZ;
+  p.coreLoad[cfg.telemetryCore] += (sampleTx * cfg.sampleRate + windowTx * windowsPerSec) / CPU_HZ;
+
+  // Anything sharing the acquisition core delays the next sample
+  float blocking = acquire + cfg.imuBurstBytes * cal.busByteCycles;
+  if (cfg.analysisCore == cfg.acquisitionCore) blocking += accumulate + analyse + spectral;
+  if (cfg.telemetryCore == cfg.acquisitionCore) blocking += sampleTx + windowTx;
+  p.worstCaseLatencyUs = blocking * 1e6f / CPU_HZ;
+  p.samplePeriodUs = 1e6f / cfg.sampleRate;
+
+  p.linkBytesPerSec = sampleBytes(cfg) * (float)cfg.sampleRate + windowBytes(cfg) * windowsPerSec
+                    + (cfg.fftSize ? SPECTRAL_REPORT_BYTES * cfg.fftPerSecond : 0.0f);
+  p.linkLoad = p.linkBytesPerSec / (cfg.baudRate / 10.0f);
+  return p;
+}
+
+constexpr bool coresWithinBudget(const Prediction& p) {
+  return p.coreLoad[0] <= MAX_CORE_LOAD && p.coreLoad[1] <= MAX_CORE_LOAD;
+}
+
+constexpr bool latencyWithinBudget(const Prediction& p) {
+  return p.worstCaseLatencyUs < p.samplePeriodUs;
+}
+
+constexpr bool linkWithinBudget(const Prediction& p) {
+  return p.linkLoad <= MAX_LINK_LOAD;
+}
+
+constexpr bool withinBudget(const PipelineConfig& cfg,
+                            const Calibration& cal = DEFAULT_CALIBRATION) {
+  return coresWithinBudget(predict(cfg, cal)) &&
+         latencyWithinBudget(predict(cfg, cal)) &&
+         linkWithinBudget(predict(cfg, cal));
+}
+
+}  // namespace cycle_budget
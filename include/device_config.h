@@ -0,0 +1,99 @@
+/*
+  Device Configuration
+  Acquisition settings shared by every processing mode. The compile-time
+  values are the boot defaults; the running values live in deviceConfig
+  and are changed through the apply functions (serial console).
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define SAMPLE_RATE 200
+#define BAUD_RATE 115200
+
+// Bounds accepted for live reconfiguration
+#define MIN_SAMPLE_RATE 50
+#define MAX_SAMPLE_RATE 1000
+#define MIN_WINDOW_SIZE 8
+#define MAX_WINDOW_SIZE 2000
+#define MAX_PSD_OVERLAP 75   // percent
+#define MAX_PSD_AVERAGES 32
+
+// Devices are power-cycled often; reset to first sample must stay short
+#define BOOT_TO_FIRST_SAMPLE_TARGET_MS 250
+
+// Processing modes running on the same acquisition core
+enum DeviceMode { MODE_TREMOR, MODE_EOG };
+
+// Tremor sample stream: every sample, or a reduced display stream
+enum DisplayMode : uint8_t { DISPLAY_RAW, DISPLAY_MINMAX, DISPLAY_LTTB };
+
+// Accelerometer feeding the tremor features, probed at boot
+enum ImuSource : uint8_t { IMU_NONE, IMU_MPU6050, IMU_SIMULATED };
+
+#ifndef DEFAULT_MODE
+#define DEFAULT_MODE MODE_TREMOR
+#endif
+
+struct DeviceConfig {
+  DeviceMode mode;
+  uint16_t sampleRate;      // Hz
+  uint16_t windowSize;      // samples per tremor classification
+  float freqThresholds[3];  // Hz boundaries for normal, mild, severe, at rest
+  float ampThresholds[3];   // amplitude boundaries
+  float saccadeFactor;      // EOG saccade threshold in noise floor multiples
+  float blinkVelocity;      // EOG upward mV/s a lid movement exceeds
+  uint16_t displayRate;     // display points per second (since version 2)
+  DisplayMode displayMode;  // (since version 2)
+  uint8_t reserved;         // keeps the record free of padding bytes
+  uint8_t psdOverlap;       // Welch segment overlap, percent (since version 3)
+  uint8_t psdAverages;      // segments in the averaged spectrum (since version 3)
+  uint16_t reserved3;       // padding, as above
+  float postureFreqThresholds[3];   // boundaries while holding a posture (since version 4)
+  float movementFreqThresholds[3];  // boundaries during movement (since version 4)
+  float anomalyThreshold;           // squared distance from calibration (since version 5)
+};
+
+extern const DeviceConfig DEFAULT_DEVICE_CONFIG;
+extern DeviceConfig deviceConfig;
+
+// Reconfigure the running device; false (and unchanged) if the new
+// setting is out of range or would break the real-time budget
+bool applyMode(DeviceMode mode);
+bool applySampleRate(uint16_t rate);
+bool applyWindowSize(uint16_t window);
+void applyThresholds();
+bool applyDisplay(DisplayMode mode, uint16_t pointsPerSecond);
+bool applyPsd(uint8_t overlapPercent, uint8_t averages);
+
+// Signal quality of the active mode's channels (console "quality")
+void printSignalQuality();
+
+// Averaged spectrum state and peak (console "psd")
+void printPsd();
+
+// Switch the accelerometer source; the simulated tremor's frequency and
+// amplitude are used with IMU_SIMULATED only. False if no sensor answers.
+bool applyImu(ImuSource source, float simulatedHz, float simulatedG);
+
+// Accelerometer source, rate and synchronization state (console "imu")
+void printImu();
+
+// Motor context and its block metrics (console "context")
+void printContext();
+
+// Collect a new anomaly calibration over the next windows (console
+// "calibrate"), and the model's state (console "anomaly")
+void startAnomalyCalibration(uint16_t windows);
+void printAnomaly();
+
+// Patient prototypes (console "enroll"): store the last classified
+// window under a TremorClass label, false before the first window
+bool enrollPrototype(uint8_t label);
+void clearPrototypes();
+void printPrototypes();
+
+// Apply a whole configuration (boot restore, console "defaults"); returns
+// false if any part was rejected and left as it was
+bool applyConfig(const DeviceConfig& config);
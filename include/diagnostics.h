@@ -0,0 +1,60 @@
+/*
+  Runtime Diagnostics
+  Counters with a once-a-second rollover, the scheduler's per-task
+  accounting plus a quantile histogram of sample task cycles, a raw sample
+  capture and a ring of recent log lines. Everything is statically
+  allocated (the capture leases the scratch arena of memory_budget.h) and
+  O(1) on the sampling path; reports are written through the telemetry
+  channel in bounded chunks.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#define PROFILE_HISTOGRAM_BUCKETS 96  // 4 per octave up to 2^24 cycles
+#define CAPTURE_MAX_SAMPLES 2048
+#define CAPTURE_LINES_PER_SERVICE 8   // dump lines queued per loop pass
+#define LOG_ENTRIES 16
+#define LOG_LINE_MAX 64
+
+// Log-linear histogram: 4 sub-buckets per power of two (~19% resolution)
+struct CycleHistogram {
+  uint32_t buckets[PROFILE_HISTOGRAM_BUCKETS];
+  uint32_t count;
+
+  void record(uint32_t cycles);
+  uint32_t quantile(float q) const;  // upper bound of the bucket holding q
+  void clear();
+};
+
+struct RuntimeStats {
+  uint32_t samples;
+  uint32_t windows;
+  uint32_t events;
+  uint32_t bootMs;            // reset to first sample
+  uint32_t samplesPerSecond;  // over the last rollover
+  float cpuLoad;              // fraction of the last second spent in tasks
+};
+
+extern RuntimeStats runtimeStats;
+
+inline uint32_t profileStart() { return ESP.getCycleCount(); }
+void profileSample(uint32_t start);  // record one sample task run
+void profileReset();
+
+// Per-second rates; run from a 1 s scheduler task
+void rolloverStats(uint32_t now);
+
+// Raw ADC capture of the next N samples of channel 0, dumped once full
+bool startCapture(uint16_t samples);
+void captureSample(uint16_t raw);
+void serviceCapture();
+
+void deviceLog(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+void printStats();
+void printProfiler();
+void printQuantiles();
+void printLog();
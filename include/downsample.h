@@ -0,0 +1,137 @@
+/*
+  Display Downsampling
+  Streaming reducers that turn a full-rate signal into a display stream
+  at a chosen point rate while keeping the waveform's visual shape. Both
+  work one sample at a time in fixed memory; header-only and free of
+  Arduino dependencies so host tools use the same code as the firmware.
+
+  MinMaxDownsampler  two points per bucket, the extremes in time order;
+                     never hides a spike, exact envelope.
+  LttbDownsampler    Largest-Triangle-Three-Buckets: one point per
+                     bucket, the sample forming the largest triangle
+                     with the previously chosen point and the next
+                     bucket's mean. A bucket is decided when the bucket
+                     after it completes, so points lag by two buckets.
+*/
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#define DOWNSAMPLE_MAX_BUCKET 64  // samples per bucket (LTTB holds one bucket)
+
+struct DisplayPoint {
+  uint32_t index;  // sample index in the full-rate stream
+  float value;
+};
+
+struct MinMaxDownsampler {
+  int bucketSize = 8;
+  int count = 0;
+  uint32_t sampleIndex = 0;
+  DisplayPoint low, high;
+
+  // Emits up to two points per completed bucket; returns how many
+  inline int push(float x, DisplayPoint* out) {
+    if (count == 0 || x < low.value) low = {sampleIndex, x};
+    if (count == 0 || x > high.value) high = {sampleIndex, x};
+    sampleIndex++;
+    if (++count < bucketSize) return 0;
+
+    count = 0;
+    if (low.index == high.index) {
+      out[0] = low;
+      return 1;
+    }
+    out[0] = low.index < high.index ? low : high;
+    out[1] = low.index < high.index ? high : low;
+    return 2;
+  }
+
+  void reset() {
+    count = 0;
+    sampleIndex = 0;
+  }
+};
+
+struct LttbDownsampler {
+  int bucketSize = 8;
+  uint32_t sampleIndex = 0;
+
+  // Last emitted point (triangle vertex A)
+  DisplayPoint anchor = {0, 0};
+  bool started = false;
+
+  // Bucket waiting for a decision, and the next one with its running sum;
+  // the two buffers swap roles instead of copying
+  float buckets[2][DOWNSAMPLE_MAX_BUCKET];
+  int pendingBuffer = 0;
+  uint32_t pendingStart = 0;
+  int pendingCount = 0;
+  float nextSum = 0;
+  int nextCount = 0;
+
+  // Emits at most one point per sample; returns true when out is set
+  inline bool push(float x, DisplayPoint& out) {
+    uint32_t i = sampleIndex++;
+    if (!started) {
+      // The first sample is always kept, as in batch LTTB
+      started = true;
+      anchor = {i, x};
+      out = anchor;
+      return true;
+    }
+
+    if (pendingCount < bucketSize) {
+      if (pendingCount == 0) pendingStart = i;
+      buckets[pendingBuffer][pendingCount++] = x;
+      return false;
+    }
+
+    buckets[pendingBuffer ^ 1][nextCount++] = x;
+    nextSum += x;
+    if (nextCount < bucketSize) return false;
+
+    // Next bucket complete: its mean is vertex C, pick B in pending
+    float cx = pendingStart + bucketSize + (bucketSize - 1) * 0.5f;
+    float cy = nextSum / nextCount;
+    out = choose(cx, cy);
+    anchor = out;
+
+    // The completed bucket becomes the pending one
+    pendingBuffer ^= 1;
+    pendingStart += bucketSize;
+    pendingCount = nextCount;
+    nextCount = 0;
+    nextSum = 0;
+    return true;
+  }
+
+  void reset() {
+    sampleIndex = 0;
+    started = false;
+    pendingCount = 0;
+    nextCount = 0;
+    nextSum = 0;
+  }
+
+ private:
+  inline DisplayPoint choose(float cx, float cy) const {
+    const float* pending = buckets[pendingBuffer];
+    float ax = (float)anchor.index;
+    float ay = anchor.value;
+    int best = 0;
+    float bestArea = -1;
+    for (int k = 0; k < pendingCount; k++) {
+      float bx = (float)(pendingStart + k);
+      // Twice the triangle area; the factor does not change the argmax
+      float area = fabsf((ax - cx) * (pending[k] - ay) - (ax - bx) * (cy - ay));
+      if (area > bestArea) {
+        bestArea = area;
+        best = k;
+      }
+    }
+    return {pendingStart + best, pending[best]};
+  }
+};
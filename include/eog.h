@@ -0,0 +1,86 @@
+/*
+  EOG Cursor Processing
+  Hardware: ESP32 + 2-4 DC-coupled BioAmp EXG Pill channels
+  Objective: Horizontal/vertical gaze deltas with saccade and blink
+  detection for the neuro-pointer cursor, within 20 ms of the eye movement.
+
+  Channel layouts:
+    2-3 channels: ch0 = horizontal bipolar, ch1 = vertical bipolar
+    4 channels:   left, right, up, down; H = right - left, V = up - down
+
+  Frames are JSON lines in the eog-bridge.js format:
+    {"timestamp":123,"channels":[mV,...],"gaze":[dx,dy],"sqi":[q,...],"events":["blink"]}
+  Events are also sent on their own the moment they are detected:
+    {"timestamp":123,"event":"saccade","gaze":[dx,dy],"velocity":v,"latency":ms,"sqi":q}
+
+  While any channel's signal quality is below SQI_GATE the detector is
+  held in reset: no gaze movement or events come from a bad contact.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "device_config.h"
+#include "eog_events.h"
+#include "pipeline.h"
+#include "signal_quality.h"
+
+#define EOG_MAX_CHANNELS 4
+#ifndef EOG_CHANNELS
+#define EOG_CHANNELS 2
+#endif
+#define EOG_FRAME_DECIMATION 2  // samples per frame: 100 frames/s at 200 Hz
+
+static_assert(EOG_CHANNELS >= 2 && EOG_CHANNELS <= EOG_MAX_CHANNELS, "EOG needs 2-4 channels");
+
+const uint8_t EOG_PINS[EOG_MAX_CHANNELS] = {34, 35, 32, 33};
+
+enum EogEvent : uint8_t {
+  EOG_EVENT_SACCADE = 1 << 0,
+  EOG_EVENT_BLINK = 1 << 1,
+};
+
+struct EogFilterParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float HIGH_HZ = 30.0f;  // keeps saccade edges, ~5 ms group delay
+};
+
+// Drift removal then noise low-pass, per electrode
+typedef FilterChain<DriftCompensator, LowPassFilter<EogFilterParams>> EogChannelFilter;
+
+struct EogFrame {
+  uint32_t timestamp;  // ms
+  uint8_t channelCount;
+  float channels[EOG_MAX_CHANNELS];  // drift-compensated, mV
+  float gazeDx, gazeDy;              // mV of H/V movement since the last frame
+  float sqi[EOG_MAX_CHANNELS];       // per-channel signal quality, 0-1
+  uint8_t events;                    // EogEvent bits since the last frame
+};
+
+struct EogProcessor {
+  EogChannelFilter filters[EOG_MAX_CHANNELS];
+  SignalQuality quality[EOG_MAX_CHANNELS];  // fed raw counts by the caller
+  EogEventDetector detector;
+  uint8_t channelCount = EOG_CHANNELS;
+  float dx = 0, dy = 0;
+  uint8_t pendingEvents = 0;
+  int frameIndex = 0;
+  bool eventReady = false;
+  bool gated = false;
+  EogEventRecord lastEvent;
+
+  void begin(uint8_t channels);
+
+  // Redesign the filters and detector for a new sample rate; restarts
+  void setSampleRate(float fs);
+
+  // Feed one sample (volts) from every channel; true when frame is ready
+  bool push(const float* volts, uint32_t timestamp, EogFrame& frame);
+
+  // Event decided on the latest sample, if any
+  bool takeEvent(EogEventRecord& event);
+};
+
+void sendEogFrame(const EogFrame& frame);
+void sendEogEvent(const EogEventRecord& event, float sqi);
@@ -0,0 +1,101 @@
+/*
+  EOG Event Detector
+  Runs on every sample of the horizontal/vertical derivations and reports
+  saccade onsets/ends and blinks the moment they are decided, rather than
+  at a window or frame boundary.
+
+  Saccades: velocity threshold that adapts to the fixation noise floor.
+  Blinks:   upward vertical movements are held until the vertical velocity
+            peaks below blink speed, reverses (lid closure) or settles. A reversal is
+            template-matched (normalized cross-correlation of the velocity
+            profile, time-scaled to the observed closure) to call a blink;
+            anything else is released as an upward saccade. The template
+            adapts towards each confirmed blink. Only upward movements pay
+            this delay; all other saccades are reported on onset.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "device_config.h"
+
+#define EOG_BLINK_TEMPLATE_LEN 16  // template points from blink onset to just past closure
+#define EOG_BLINK_MAX_WAIT_MS 250  // time a candidate may take to reverse
+#define EOG_BLINK_HOLD_MS 300      // time suppressed after a blink
+#define EOG_BLINK_SETTLE_MS 15     // quiet time that releases a candidate, 3 samples minimum
+#define EOG_SACCADE_SETTLE_MS 10   // quiet time that ends a saccade, 2 samples minimum
+#define EOG_WARMUP_MS 500           // fixation time spent learning the noise floor
+#define EOG_NOISE_TAU_MS 500       // noise floor time constant during fixation
+
+// Candidate samples at the highest rate
+#define EOG_BLINK_CANDIDATE_MAX (EOG_BLINK_MAX_WAIT_MS * MAX_SAMPLE_RATE / 1000)
+
+enum EogEventType : uint8_t { EOG_SACCADE_ONSET, EOG_SACCADE_END, EOG_BLINK };
+
+struct EogEventRecord {
+  uint32_t timestamp;       // ms at detection
+  EogEventType type;
+  float dx, dy;             // mV; onset: movement so far, end: whole saccade
+  float peakVelocity;       // mV/s
+  uint16_t latencyMs;       // estimated movement onset to detection
+                            // (for EOG_SACCADE_END: the saccade duration)
+};
+
+struct EogEventDetector {
+  enum State : uint8_t { IDLE, BLINK_CANDIDATE, SACCADE, BLINK_HOLD };
+
+  // Tuning
+  float thresholdFactor = 6.0f;      // saccade threshold in multiples of the noise floor
+  float minSaccadeVelocity = 20.0f;  // mV/s floor for the adaptive threshold
+  float blinkVelocity = 1000.0f;     // upward mV/s a lid movement always exceeds
+  float blinkMatch = 0.8f;           // correlation needed to call a blink
+  float noiseAlpha = 1000.0f / (EOG_NOISE_TAU_MS * SAMPLE_RATE);  // per sample, from setSampleRate
+  float templateAlpha = 0.1f;        // template adaptation per confirmed blink
+  float sampleRate = SAMPLE_RATE;    // Hz
+
+  // Outputs for the current sample
+  float moveDx = 0, moveDy = 0;  // displacement attributed to gaze this sample
+
+  State state = IDLE;
+  float noise = 5.0f;  // mean velocity magnitude during fixation, mV/s
+  int warmup = EOG_WARMUP_MS * SAMPLE_RATE / 1000;
+  int maxWait = EOG_BLINK_MAX_WAIT_MS * SAMPLE_RATE / 1000;  // samples, from setSampleRate
+  int holdSamples = EOG_BLINK_HOLD_MS * SAMPLE_RATE / 1000;
+  int blinkSettle = 3;
+  int saccadeSettle = 2;
+  float prevH = 0, prevV = 0;
+  bool primed = false;
+  uint32_t sampleIndex = 0;
+  uint32_t onsetSample = 0;
+  uint32_t lastQuietSample = 0;
+  float sumDx = 0, sumDy = 0, peak = 0, peakUp = 0;
+  int quietCount = 0;
+  int holdCount = 0;
+  int candidateCount = 0;
+  float candidate[EOG_BLINK_CANDIDATE_MAX];     // vertical velocity since onset
+  float blinkTemplate[EOG_BLINK_TEMPLATE_LEN];  // expected blink velocity profile
+
+  EogEventDetector();
+  void reset();
+  void setSampleRate(float fs);
+
+  // True while a movement is in progress (drift compensation should hold)
+  inline bool active() const { return state != IDLE; }
+  inline float threshold() const {
+    float t = thresholdFactor * noise;
+    return t > minSaccadeVelocity ? t : minSaccadeVelocity;
+  }
+
+  // Feed one H/V sample in mV; true when event has been filled in
+  bool push(float h, float v, uint32_t timestamp, EogEventRecord& event);
+
+ private:
+  float templateAt(float position) const;
+  float matchBlink();
+  void adaptTemplate();
+  void releaseSaccade(EogEventRecord& event, uint32_t timestamp);
+  void fill(EogEventRecord& event, EogEventType type, uint32_t timestamp);
+};
+
+const char* eogEventName(EogEventType type);
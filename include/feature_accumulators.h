@@ -0,0 +1,194 @@
+/*
+  Streaming Feature Accumulators
+  Each feature consumes one sample at a time with push() and produces its
+  values with finalize(), which also resets it for the next window
+  (accumulators that average across windows keep their state; reset()
+  clears everything, e.g. on a mode change). A
+  FeatureSet composes accumulators at compile time, so the per-sample work
+  is spread evenly across sample periods instead of landing in one batch
+  pass over the window, and finalize() is O(1) per feature.
+  Prefiltered groups accumulators behind their own per-sample stage; its
+  values stay in place in the enclosing set.
+
+  An accumulator provides:
+    static constexpr int COUNT;   // values written by finalize()
+    void push(float sample);
+    void finalize(float* out);
+    void reset();
+    void setSampleRate(float fs);
+*/
+
+#pragma once
+
+#include <math.h>
+
+#include <type_traits>
+
+#include "device_config.h"
+
+// Mean absolute amplitude
+struct MeanAbsAmplitude {
+  static constexpr int COUNT = 1;
+  float sum = 0;
+  int n = 0;
+
+  inline void push(float x) {
+    sum += fabsf(x);
+    n++;
+  }
+
+  inline void finalize(float* out) {
+    out[0] = n > 0 ? sum / n : 0;
+    reset();
+  }
+  inline void reset() {
+    sum = 0;
+    n = 0;
+  }
+  inline void setSampleRate(float) {}
+};
+
+// Root mean square amplitude
+struct RmsAmplitude {
+  static constexpr int COUNT = 1;
+  float sumSquares = 0;
+  int n = 0;
+
+  inline void push(float x) {
+    sumSquares += x * x;
+    n++;
+  }
+
+  inline void finalize(float* out) {
+    out[0] = n > 0 ? sqrtf(sumSquares / n) : 0;
+    reset();
+  }
+  inline void reset() {
+    sumSquares = 0;
+    n = 0;
+  }
+  inline void setSampleRate(float) {}
+};
+
+// Zero crossing rate and the dominant frequency it implies.
+// Crossings are only counted within a window, as in the batch version.
+struct ZeroCrossingFeatures {
+  static constexpr int COUNT = 2;
+  float sampleRate = SAMPLE_RATE;
+  float prev = 0;
+  int crossings = 0;
+  int n = 0;
+
+  inline void push(float x) {
+    if (n > 0 && ((prev > 0 && x < 0) || (prev < 0 && x > 0))) {
+      crossings++;
+    }
+    prev = x;
+    n++;
+  }
+
+  inline void finalize(float* out) {
+    out[0] = n > 0 ? (float)crossings / n : 0;                  // Zero crossing rate
+    out[1] = n > 0 ? sampleRate * crossings / (2.0f * n) : 0;   // Dominant frequency
+    reset();
+  }
+  inline void reset() {
+    crossings = 0;
+    n = 0;
+  }
+  inline void setSampleRate(float fs) { sampleRate = fs; }
+};
+
+// Marks accumulators that contain others, so get<T>() can look inside
+struct FeatureGroup {};
+
+// Compile-time composition: values are laid out in template argument order
+template <typename... Features>
+struct FeatureSet;
+
+template <>
+struct FeatureSet<> : FeatureGroup {
+  static constexpr int COUNT = 0;
+  inline void push(float) {}
+  inline void finalize(float*) {}
+  inline void reset() {}
+  inline void setSampleRate(float) {}
+
+  template <typename T>
+  static constexpr bool has() { return false; }
+};
+
+template <typename First, typename... Rest>
+struct FeatureSet<First, Rest...> : FeatureGroup {
+  static constexpr int COUNT = First::COUNT + FeatureSet<Rest...>::COUNT;
+  First first;
+  FeatureSet<Rest...> rest;
+
+  inline void push(float x) {
+    first.push(x);
+    rest.push(x);
+  }
+
+  inline void finalize(float* out) {
+    first.finalize(out);
+    rest.finalize(out + First::COUNT);
+  }
+
+  inline void reset() {
+    first.reset();
+    rest.reset();
+  }
+
+  void setSampleRate(float fs) {
+    first.setSampleRate(fs);
+    rest.setSampleRate(fs);
+  }
+
+  // Whether an accumulator that is (or extends) T is in this set
+  template <typename T>
+  static constexpr bool has() {
+    if constexpr (std::is_base_of<T, First>::value) {
+      return true;
+    } else if constexpr (std::is_base_of<FeatureGroup, First>::value) {
+      return First::template has<T>() || FeatureSet<Rest...>::template has<T>();
+    } else {
+      return FeatureSet<Rest...>::template has<T>();
+    }
+  }
+
+  // The first accumulator that is (or extends) T, for runtime settings
+  template <typename T>
+  T& get() {
+    if constexpr (std::is_base_of<T, First>::value) {
+      return first;
+    } else if constexpr (std::is_base_of<FeatureGroup, First>::value) {
+      if constexpr (First::template has<T>()) {
+        return first.template get<T>();
+      } else {
+        return rest.template get<T>();
+      }
+    } else {
+      return rest.template get<T>();
+    }
+  }
+};
+
+// Accumulators fed through their own per-sample stage (see pipeline.h),
+// e.g. frequency features on an enhanced signal while the amplitude
+// features keep the plain filtered one
+template <typename Stage, typename... Features>
+struct Prefiltered : FeatureSet<Features...> {
+  Stage stage;
+
+  inline void push(float x) { FeatureSet<Features...>::push(stage.process(x)); }
+
+  inline void reset() {
+    stage.reset();
+    FeatureSet<Features...>::reset();
+  }
+
+  void setSampleRate(float fs) {
+    stage.setSampleRate(fs);
+    FeatureSet<Features...>::setSampleRate(fs);
+  }
+};
@@ -0,0 +1,105 @@
+/*
+  Radix-2 FFT
+  In-place complex FFT with the twiddle table built once per size. No
+  Arduino dependency, so host tools can run the same transform.
+
+  butterflies() can stop and resume anywhere, so a transform can be spread
+  across sample periods instead of running as one burst.
+
+  Two real signals share one transform: pack them as re = x, im = y and
+  separate the spectra afterwards with splitRealPair(), half the work of
+  transforming each channel on its own.
+*/
+
+#pragma once
+
+#include <math.h>
+
+constexpr int fftLog2(int n) {
+  return n > 1 ? 1 + fftLog2(n / 2) : 0;
+}
+
+template <int N>
+struct Fft {
+  static_assert(N >= 4 && (N & (N - 1)) == 0, "FFT size must be a power of two");
+  static constexpr int SIZE = N;
+  static constexpr int LOG2 = fftLog2(N);
+
+  float cosTable[N / 2];
+  float sinTable[N / 2];
+
+  Fft() {
+    for (int k = 0; k < N / 2; k++) {
+      cosTable[k] = cosf(2 * (float)M_PI * k / N);
+      sinTable[k] = sinf(2 * (float)M_PI * k / N);
+    }
+  }
+
+  // Hann window weight for point i, from the twiddle table
+  inline float hann(int i) const {
+    float c = i < N / 2 ? cosTable[i] : -cosTable[i - N / 2];
+    return 0.5f * (1 - c);
+  }
+
+  // Position of point i after bit reversal
+  static inline int reverse(int i) {
+    int r = 0;
+    for (int bit = N >> 1; bit; bit >>= 1, i >>= 1) r = (r << 1) | (i & 1);
+    return r;
+  }
+
+  // Resumable position in the butterfly passes
+  struct Cursor {
+    int length = 2;
+    int start = 0;
+    int k = 0;
+  };
+
+  // Runs butterflies over bit-reversed data while budget lasts, so one
+  // transform can be spread across calls; true once it is complete
+  bool butterflies(float* re, float* im, Cursor& cursor, int& budget) const {
+    for (; cursor.length <= N; cursor.length <<= 1, cursor.start = 0) {
+      int half = cursor.length / 2;
+      int step = N / cursor.length;
+      for (; cursor.start < N; cursor.start += cursor.length, cursor.k = 0) {
+        for (; cursor.k < half; cursor.k++) {
+          if (budget <= 0) return false;
+          budget--;
+          float wr = cosTable[cursor.k * step], wi = -sinTable[cursor.k * step];
+          int a = cursor.start + cursor.k, b = a + half;
+          float tr = re[b] * wr - im[b] * wi;
+          float ti = re[b] * wi + im[b] * wr;
+          re[b] = re[a] - tr;
+          im[b] = im[a] - ti;
+          re[a] += tr;
+          im[a] += ti;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Forward transform, decimation in time
+  void transform(float* re, float* im) const {
+    for (int i = 0; i < N; i++) {
+      int j = reverse(i);
+      if (i < j) {
+        float t = re[i]; re[i] = re[j]; re[j] = t;
+        t = im[i]; im[i] = im[j]; im[j] = t;
+      }
+    }
+    Cursor cursor;
+    int budget = N / 2 * LOG2;
+    butterflies(re, im, cursor, budget);
+  }
+};
+
+// Bin k of X and Y from the transform of x + iy: X = (Z[k] + Z*[N-k]) / 2,
+// Y = (Z[k] - Z*[N-k]) / 2i. Outputs are {re, im}.
+inline void splitRealPair(const float* re, const float* im, int n, int k, float* x, float* y) {
+  int m = k == 0 ? 0 : n - k;
+  x[0] = 0.5f * (re[k] + re[m]);
+  x[1] = 0.5f * (im[k] - im[m]);
+  y[0] = 0.5f * (im[k] + im[m]);
+  y[1] = 0.5f * (re[m] - re[k]);
+}
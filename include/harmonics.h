@@ -0,0 +1,42 @@
+/*
+  Harmonic Structure
+  Pathological tremor is a periodic, non-sinusoidal muscle drive, so its
+  spectrum carries harmonics of the fundamental; motion artefacts and
+  broadband EMG do not. These features read the averaged Welch spectrum
+  the PSD accumulator already keeps, so they cost a few hundred
+  operations per window and no extra transform.
+
+  Fundamental: harmonic product spectrum over 3-12 Hz candidates, the
+  product of each candidate's first HARMONIC_ORDER harmonic peaks (each
+  normalized to the band maximum, so the product cannot underflow).
+  A harmonic counts when its peak stands HARMONIC_SNR above the floor
+  midway between it and its neighbours.
+*/
+
+#pragma once
+
+#include "welch.h"
+
+#define HARMONIC_MIN_HZ 3.0f
+#define HARMONIC_MAX_HZ 12.0f
+#define HARMONIC_ORDER 4
+#define HARMONIC_SNR 4.0f  // 6 dB over the local floor
+#define HARMONIC_COUNT 4   // feature values
+
+// Writes fundamental Hz, 2nd/fundamental and 3rd/fundamental power
+// ratios and the number of harmonics present; zeros for an empty spectrum
+void analyzeHarmonics(const float* psd, int bins, float binHz, float* out);
+
+// Welch PSD that also reports the harmonic structure of its spectrum
+struct WelchHarmonics : WelchPsd {
+  static constexpr int COUNT = WelchPsd::COUNT + HARMONIC_COUNT;
+
+  inline void finalize(float* out) {
+    WelchPsd::finalize(out);
+    if (segments > 0) {
+      analyzeHarmonics(psd, WELCH_BINS, binHz, out + WelchPsd::COUNT);
+    } else {
+      for (int i = 0; i < HARMONIC_COUNT; i++) out[WelchPsd::COUNT + i] = 0;
+    }
+  }
+};
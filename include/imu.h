@@ -0,0 +1,121 @@
+/*
+  Inertial Sensor Input
+  Hardware: MPU-6050 (or register-compatible MPU-6500/9250) on I2C,
+  SDA 21 / SCL 22, at 0x68.
+  Objective: limb acceleration alongside the EMG, so a tremor rhythm in
+  the muscle can be checked against movement of the limb.
+
+  The sensor samples on its own clock into its FIFO (accelerometer and
+  gyro, 12 bytes a frame). The imu task empties it in bursts small
+  enough not to hold up the next EMG sample. ImuSync then resamples the
+  frames onto the EMG sample clock: each EMG tick reads the queue at a
+  fractional position that advances by the rate ratio, and the ratio is
+  trimmed from the queue fill so the two clocks cannot drift apart.
+
+  Without hardware the simulated source produces the same FIFO bytes: a
+  sinusoidal tremor along a fixed axis plus gravity and noise, on a
+  clock deliberately IMU_SIM_CLOCK_ERROR off nominal, so the decoding
+  and synchronization paths run exactly as they do with a sensor.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "device_config.h"
+
+#define IMU_I2C_ADDRESS 0x68
+#define IMU_I2C_HZ 400000
+#define IMU_FRAME_BYTES 12          // accel xyz, gyro xyz, big-endian int16
+#define IMU_FIFO_BYTES 1024
+#define IMU_BYTE_US 22.5f           // 9 clocks a byte at 400 kHz
+#define IMU_MAX_RATE 200            // Hz; tremor stays below 20 Hz
+#define IMU_MAX_BURST_FRAMES 10     // Wire's 128-byte receive buffer
+#define IMU_ACCEL_LSB_PER_G 16384.0f   // +/-2 g range
+#define IMU_GYRO_LSB_PER_DPS 131.0f    // +/-250 deg/s range
+
+#define IMU_QUEUE 32                // frames between the FIFO and the EMG clock
+#define IMU_SYNC_TARGET 8.0f        // queue fill held by the rate servo
+#define IMU_SYNC_TIME_S 1.0f        // servo time constant
+#define IMU_SYNC_SMOOTHING_S 0.5f   // fill averaging ahead of the servo
+
+#define IMU_SIM_HZ 5.0f
+#define IMU_SIM_G 0.05f
+#define IMU_SIM_NOISE_G 0.005f
+#define IMU_SIM_CLOCK_ERROR 0.005f  // +0.5 %, within the MPU-6050 spread
+
+const char* imuSourceName(ImuSource source);
+
+struct ImuFrame {
+  float accel[3];  // g
+  float gyro[3];   // deg/s
+};
+
+// One FIFO frame's bytes to physical units
+void decodeImuFrame(const uint8_t* bytes, ImuFrame& frame);
+
+// Frames per FIFO burst that fit in a quarter sample period (the
+// sampling task's deadline), at least one
+constexpr int imuBurstFrames(uint32_t samplePeriodUs) {
+  int frames = (int)(samplePeriodUs / 4 / (IMU_FRAME_BYTES * IMU_BYTE_US));
+  return frames < 1 ? 1 : frames > IMU_MAX_BURST_FRAMES ? IMU_MAX_BURST_FRAMES : frames;
+}
+
+// Sensor output rate for an EMG rate: the sensor divides a 1 kHz clock
+constexpr uint16_t imuRateFor(uint16_t emgRate) {
+  return 1000 / (1000 / (emgRate < IMU_MAX_RATE ? emgRate : IMU_MAX_RATE));
+}
+
+struct ImuSimulation {
+  float tremorHz = IMU_SIM_HZ;
+  float tremorG = IMU_SIM_G;
+  float phase = 0;        // radians
+  float pendingFrames = 0;
+  uint32_t lastUs = 0;
+  uint32_t seed = 1;
+};
+
+struct ImuDevice {
+  ImuSource source = IMU_NONE;
+  uint16_t rate = 0;  // frames per second
+  ImuSimulation simulation;
+
+  uint32_t frames = 0;
+  uint32_t fifoOverflows = 0;
+  uint32_t busErrors = 0;
+
+  // Probe and configure; false (and IMU_NONE) if no sensor answers
+  bool begin(ImuSource requested, uint16_t emgRate, uint32_t nowUs);
+  void end();
+
+  // Read up to maxFrames queued frames; returns the number read
+  int read(ImuFrame* out, int maxFrames, uint32_t nowUs);
+
+ private:
+  int readSensor(ImuFrame* out, int maxFrames);
+  int readSimulated(ImuFrame* out, int maxFrames, uint32_t nowUs);
+};
+
+// Resamples sensor frames onto the EMG sample clock
+struct ImuSync {
+  ImuFrame queue[IMU_QUEUE];
+  uint32_t written = 0;  // frames pushed since reset
+  uint32_t readIndex = 0;
+  float fraction = 0;    // position between readIndex and the next frame
+  float nominal = 1;     // sensor frames per EMG sample
+  float ratio = 1;
+  float gain = 0;        // ratio trim per frame of fill error
+  float smoothing = 0;
+  float fillAverage = 0;
+  bool primed = false;
+  uint32_t underruns = 0;
+  uint32_t overruns = 0;
+
+  void configure(float imuRate, float emgRate);
+  void reset();
+
+  void push(const ImuFrame& frame);
+
+  // Acceleration at the current EMG tick; false until the queue has filled
+  bool next(float* accel);
+};
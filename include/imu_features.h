@@ -0,0 +1,140 @@
+/*
+  Accelerometer Tremor Features
+  Limb acceleration read against the flexor EMG. Gravity is high-passed
+  out of each axis, the axes are low-passed and decimated to the same
+  segments as the antagonist features, and each segment is projected
+  onto its principal axis (power iteration on the 3x3 covariance,
+  started from the previous axis and kept on the same side of it, so the
+  cross-spectrum phase averages across segments). Per segment:
+
+    peak frequency  3-12 Hz peak of the averaged acceleration spectrum
+    amplitude       3-12 Hz band RMS along the principal axis, in g
+    coherence       magnitude-squared coherence between the EMG envelope
+                    and the acceleration, mean over 3-12 Hz and at the
+                    acceleration peak
+
+  Tremor drives the limb at the rhythm of the EMG bursts, so the two are
+  coherent there; voluntary movement is mostly below 3 Hz, and EMG from
+  effort without tremor moves nothing at that rhythm. The envelope and
+  the acceleration share one complex FFT, as in antagonist.cpp.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "antagonist.h"
+#include "fft.h"
+#include "pipeline.h"
+
+#define IMU_SEGMENT_SIZE ANTAGONIST_FFT_SIZE
+#define IMU_SEGMENT_HZ ANTAGONIST_ENVELOPE_HZ
+#define IMU_AVERAGES ANTAGONIST_AVERAGES
+#define IMU_MIN_SEGMENTS ANTAGONIST_MIN_SEGMENTS
+#define IMU_COHERENCE_MIN ANTAGONIST_COHERENCE_MIN
+#define IMU_MIN_TREMOR_G 0.005f     // band RMS a tremor moves the limb by
+#define IMU_FREQUENCY_MATCH_HZ 1.0f  // EMG and acceleration peaks agree
+#define IMU_FEATURE_COUNT 3          // window features
+
+struct ImuGravityParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float LOW_HZ = 1.0f;  // gravity and posture out
+};
+
+struct ImuAntiAliasParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float HIGH_HZ = 15.0f;  // below the segment Nyquist
+};
+
+typedef FilterChain<HighPassFilter<ImuGravityParams>, LowPassFilter<ImuAntiAliasParams>>
+    AccelFilter;
+
+struct ImuResult {
+  float peakHz;            // 0 until IMU_MIN_SEGMENTS segments
+  float amplitudeG;        // band RMS along the principal axis
+  float coherence;         // mean over 3-12 Hz
+  float peakCoherence;     // at peakHz
+  float axis[3];           // principal axis, sensor frame
+};
+
+struct ImuFeatures {
+  EmgEnvelope envelope;
+  AccelFilter filters[3];
+  Fft<IMU_SEGMENT_SIZE> fft;
+
+  int decimation = 1;
+  float segmentRate = SAMPLE_RATE;
+  int phase = 0;
+
+  // Two segment buffers: one filling, one waiting for analyze()
+  float emg[2][IMU_SEGMENT_SIZE];
+  float accel[2][3][IMU_SEGMENT_SIZE];
+  int filling = 0;
+  int count = 0;
+  bool pending = false;
+  uint32_t overruns = 0;
+
+  float axis[3];
+  float autoEmg[IMU_SEGMENT_SIZE / 2 + 1];
+  float autoAccel[IMU_SEGMENT_SIZE / 2 + 1];
+  float crossRe[IMU_SEGMENT_SIZE / 2 + 1];
+  float crossIm[IMU_SEGMENT_SIZE / 2 + 1];
+  int segments = 0;
+
+  ImuFeatures() { setSampleRate(SAMPLE_RATE); }
+
+  void setSampleRate(float fs);
+  void reset();
+
+  // Flexor volts and acceleration in g at one EMG tick; returns true when
+  // a segment is waiting for analyze()
+  inline bool push(float emgVolts, const float* g) {
+    float e = envelope.process(emgVolts);
+    float a[3];
+    for (int i = 0; i < 3; i++) a[i] = filters[i].process(g[i]);
+    if (++phase < decimation) return pending;
+    phase = 0;
+
+    emg[filling][count] = e;
+    for (int i = 0; i < 3; i++) accel[filling][i][count] = a[i];
+    if (++count >= IMU_SEGMENT_SIZE) {
+      count = 0;
+      if (pending) {
+        overruns++;
+      } else {
+        pending = true;
+        filling ^= 1;
+      }
+    }
+    return pending;
+  }
+
+  // Process the waiting segment; false if there was none
+  bool analyze(ImuResult& result);
+
+  inline void discard() { pending = false; }
+};
+
+// Latest segment's values as window features; zeros without an IMU
+struct ImuWindowFeatures {
+  static constexpr int COUNT = IMU_FEATURE_COUNT;
+  float values[COUNT] = {0, 0, 0};
+
+  inline void push(float) {}
+  inline void finalize(float* out) {
+    for (int i = 0; i < COUNT; i++) out[i] = values[i];
+  }
+  inline void reset() {
+    for (int i = 0; i < COUNT; i++) values[i] = 0;
+  }
+  inline void setSampleRate(float) {}
+
+  inline void update(const ImuResult& result) {
+    values[0] = result.peakHz;
+    values[1] = result.amplitudeG;
+    values[2] = result.peakCoherence;
+  }
+};
+
+// ACCEL:peakHz,amplitudeG,coherence,peakCoherence
+void sendImu(const ImuResult& result);
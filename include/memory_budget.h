@@ -0,0 +1,83 @@
+/*
+  Static Memory Budget
+  The firmware's RAM plan. Every buffer is sized at compile time and
+  belongs to a subsystem with a budget below; the module that owns the
+  buffers static_asserts them against it and publishes a MemoryRegion
+  for the boot report, so outgrowing a budget fails the build rather
+  than the heap.
+
+  Buffers that are large and rarely used share one scratch arena instead
+  of each holding their own: a raw capture and a firmware update lease
+  it in turn (scratchAcquire), so the device only pays for the larger.
+
+  Nothing allocates from the heap once setup() has finished. The
+  esp32dev environments link malloc, calloc and realloc, newlib's
+  reentrant _malloc_r family and the IDF's heap_caps_malloc, _calloc and
+  _realloc through wrappers. These count any allocation after
+  memorySeal() as an error, with the size and caller of the last one,
+  for the device log and the "memory" report. Other heap_caps entry
+  points (aligned, prefer, DMA-capable zalloc) are not watched. IDF calls known to allocate internally (NVS writes,
+  partition table and signature work during an update) run between
+  memoryExemptBegin() and memoryExemptEnd() and are not counted.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Statically allocated bytes per subsystem
+#define MEMORY_BUDGET_TREMOR 16384      // EMG pipeline, quality, coupling, context, anomaly
+#define MEMORY_BUDGET_IMU 8192          // accelerometer device, resampler and features
+#define MEMORY_BUDGET_EOG 3072          // filters and detector, blinks at the top rate
+#define MEMORY_BUDGET_TELEMETRY 3072    // transmit ring
+#define MEMORY_BUDGET_RELIABLE 3072     // retransmit window
+#define MEMORY_BUDGET_DIAGNOSTICS 2048  // histogram and log ring; captures use the scratch arena
+#define MEMORY_BUDGET_SCHEDULER 1024
+#define MEMORY_BUDGET_UPDATE 512        // progress and image hash; blocks use the scratch arena
+#define MEMORY_SCRATCH_BYTES 20480      // the larger of a capture and an update's buffers
+
+#define MEMORY_STATIC_BUDGET 65536
+
+static_assert(MEMORY_BUDGET_TREMOR + MEMORY_BUDGET_IMU + MEMORY_BUDGET_EOG +
+                      MEMORY_BUDGET_TELEMETRY + MEMORY_BUDGET_RELIABLE +
+                      MEMORY_BUDGET_DIAGNOSTICS + MEMORY_BUDGET_SCHEDULER +
+                      MEMORY_BUDGET_UPDATE + MEMORY_SCRATCH_BYTES <=
+                  MEMORY_STATIC_BUDGET,
+              "subsystem budgets exceed the static memory budget");
+
+struct MemoryRegion {
+  const char* name;
+  uint32_t bytes;
+  uint32_t budget;
+};
+
+// Published by the owning modules
+extern const MemoryRegion tremorMemory;
+extern const MemoryRegion imuMemory;
+extern const MemoryRegion eogMemory;
+extern const MemoryRegion telemetryMemory;
+extern const MemoryRegion reliableMemory;
+extern const MemoryRegion diagnosticsMemory;
+extern const MemoryRegion schedulerMemory;
+extern const MemoryRegion updateMemory;
+
+enum ScratchUser : uint8_t { SCRATCH_FREE, SCRATCH_CAPTURE, SCRATCH_UPDATE };
+
+// The scratch arena (MEMORY_SCRATCH_BYTES, 8-byte aligned) for user, or
+// nullptr while another user holds it
+void* scratchAcquire(ScratchUser user);
+void scratchRelease(ScratchUser user);
+ScratchUser scratchOwner();
+
+// End of setup(): heap allocations from here on are errors
+void memorySeal();
+void memoryExemptBegin();
+void memoryExemptEnd();
+uint32_t heapAllocationsAfterSetup();
+
+// Logs allocations counted since the last call; run from the stats task
+void memoryService();
+
+// Static regions against their budgets, then heap and PSRAM
+void printMemory();
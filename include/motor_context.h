@@ -0,0 +1,143 @@
+/*
+  Motor Context
+  Whether the limb is at rest, holding a posture or moving, inferred from
+  the flexor EMG and, when present, the accelerometer. The same tremor
+  frequency means different things in each (rest tremor, postural
+  tremor, kinetic tremor), so the classifier reads the context of each
+  window and applies that context's thresholds.
+
+  Every half second block:
+
+    tonic       quietest 50 ms mean of the rectified 20 Hz+ EMG: the
+                sustained contraction left between tremor bursts
+    rest floor  lowest tonic level seen, forgotten slowly so an
+                electrode change cannot pin it down
+    modulation  coefficient of variation, over the last few seconds, of
+                the EMG envelope smoothed well below tremor rates:
+                voluntary effort rising and falling, not the tremor
+                bursts themselves
+    movement    0.3-2 Hz acceleration RMS over the three axes, below
+                the tremor band; gravity and tremor both filtered out
+                (the first sample is taken off, so the filters do not
+                ring on the gravity step)
+
+  Tonic near the floor is rest, a steady contraction above it posture,
+  and modulated effort or slow acceleration movement. Large slow
+  acceleration, or strong modulated effort, is vigorous movement: the
+  tremor features are held then, since a rhythm under that is no longer
+  measurable. A new context has to hold for CONTEXT_HOLD_BLOCKS blocks.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "antagonist.h"
+#include "pipeline.h"
+
+#define CONTEXT_BLOCK_MS 500
+#define CONTEXT_SUBBLOCK_MS 50
+#define CONTEXT_SMOOTHING_S 0.3f      // modulation envelope; 5 Hz bursts down ~10x
+#define CONTEXT_MODULATION_S 2.0f     // spans a reach or a few slow repetitions
+#define CONTEXT_ACTIVE_RATIO 3.0f     // tonic over the rest floor when holding a posture
+#define CONTEXT_MOVEMENT_CV 0.3f
+#define CONTEXT_MOVEMENT_G 0.05f
+#define CONTEXT_VIGOROUS_G 0.3f
+#define CONTEXT_VIGOROUS_RATIO 30.0f  // with modulation: strong voluntary effort
+#define CONTEXT_FLOOR_RISE 0.0005f    // per block; doubles in about 12 minutes
+#define CONTEXT_FLOOR_MIN_V 0.001f    // about one ADC step, so a flat input is not active
+#define CONTEXT_HOLD_BLOCKS 2
+#define CONTEXT_FILTER_SECTIONS 8     // per sample: EMG envelope 2, three axes 2 each
+
+enum MotorContext : uint8_t {
+  CONTEXT_UNKNOWN,   // first blocks
+  CONTEXT_REST,
+  CONTEXT_POSTURE,
+  CONTEXT_MOVEMENT,
+  CONTEXT_VIGOROUS,  // tremor analysis held
+};
+
+const char* motorContextName(MotorContext context);
+
+struct ContextAccelParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float LOW_HZ = 0.3f;   // gravity and held orientation out
+  static constexpr float HIGH_HZ = 2.0f;  // tremor band out
+};
+
+struct ContextMetrics {
+  float tonic;      // volts
+  float restFloor;  // volts
+  float modulation;
+  float movementG;  // -1 without acceleration in the block
+};
+
+struct MotorContextEstimator {
+  EmgEnvelope envelope;
+  BandPassFilter<ContextAccelParams> accelFilters[3];
+
+  int subBlockSize = 1;     // samples
+  int blockSubBlocks = 1;
+  float smoothing = 0;      // per sub-block
+  float averaging = 0;      // per sub-block, for the modulation statistics
+
+  // Running block
+  int sampleCount = 0;
+  float subBlockSum = 0;
+  int subBlocks = 0;
+  float tonic = 0;
+  float slow = 0;
+  float slowMean = 0, slowVariance = 0;
+  float accelOffset[3] = {0, 0, 0};
+  float accelSquares = 0;
+  int accelSamples = 0;
+  bool accelPrimed = false;
+
+  bool primed = false;
+  ContextMetrics metrics = {0, 0, 0, -1};
+  MotorContext context = CONTEXT_UNKNOWN;
+  MotorContext candidate = CONTEXT_UNKNOWN;
+  int candidateBlocks = 0;
+
+  MotorContextEstimator() { setSampleRate(SAMPLE_RATE); }
+
+  void setSampleRate(float fs);
+  void reset();
+
+  // Flexor volts and, when there is a synchronized sample, acceleration
+  // in g; returns true when the context changes
+  inline bool push(float emgVolts, const float* accel) {
+    subBlockSum += envelope.process(emgVolts);
+    if (accel) {
+      if (!accelPrimed) {
+        for (int i = 0; i < 3; i++) accelOffset[i] = accel[i];
+        accelPrimed = true;
+      }
+      for (int i = 0; i < 3; i++) {
+        float a = accelFilters[i].process(accel[i] - accelOffset[i]);
+        accelSquares += a * a;
+      }
+      accelSamples++;
+    }
+    if (++sampleCount < subBlockSize) return false;
+    return endSubBlock();
+  }
+
+ private:
+  bool endSubBlock();
+  MotorContext decide() const;
+};
+
+// The context a window was recorded in, as a window feature
+struct ContextWindowFeatures {
+  static constexpr int COUNT = 1;
+  MotorContext context = CONTEXT_UNKNOWN;
+
+  inline void push(float) {}
+  inline void finalize(float* out) { out[0] = context; }
+  inline void reset() { context = CONTEXT_UNKNOWN; }
+  inline void setSampleRate(float) {}
+};
+
+// CONTEXT:name,tonic,restFloor,modulation,movementG
+void sendContext(const MotorContextEstimator& estimator);
@@ -0,0 +1,58 @@
+/*
+  Gaussian Naive Bayes Classifier
+  The backend's window features scored against per-class Gaussians
+  exported by backend/export_naive_bayes.py (naive_bayes_model.h). Per
+  class that is two multiply-adds a feature plus a subtraction; the log
+  probabilities are normalized with one log-sum-exp.
+
+  The model is trained on the CLI trainer's feature columns, computed by
+  the exporter the way the device computes them from recorded sessions,
+  so the window features are first mapped onto those columns
+  (backendFeatures() in tremor.h).
+  Free of Arduino dependencies: host/model_compare evaluates the same
+  code on the backend's CSV.
+*/
+
+#pragma once
+
+#include <math.h>
+
+#include "naive_bayes_model.h"
+
+// CLI trainer feature columns (backend/cli_trainer.py extract_features)
+enum BackendFeature {
+  BACKEND_MEAN,
+  BACKEND_RMS,
+  BACKEND_VARIANCE,
+  BACKEND_ZERO_CROSSINGS,      // of the uncentred signal: not reproduced on the device
+  BACKEND_DOMINANT_FREQUENCY,  // 1-20 Hz Welch peak, as the exporter computes it
+  BACKEND_SPECTRAL_ENTROPY,    // over a full-band FFT: not reproduced on the device
+  BACKEND_FEATURE_COUNT
+};
+
+constexpr bool naiveBayesInputsAvailable(int i = 0) {
+  return i == NB_FEATURES ||
+         (NB_FEATURE_INDEX[i] != BACKEND_ZERO_CROSSINGS &&
+          NB_FEATURE_INDEX[i] != BACKEND_SPECTRAL_ENTROPY && naiveBayesInputsAvailable(i + 1));
+}
+static_assert(naiveBayesInputsAvailable(), "naive Bayes model uses a feature the device lacks");
+
+// Normalized log probability of each class; returns the most probable
+inline int naiveBayesLogProbabilities(const float* backend, float* out) {
+  int best = 0;
+  for (int k = 0; k < NB_CLASSES; k++) {
+    float score = NB_LOG_NORM[k];
+    for (int j = 0; j < NB_FEATURES; j++) {
+      float d = backend[NB_FEATURE_INDEX[j]] - NB_MEAN[k][j];
+      score -= NB_HALF_PRECISION[k][j] * d * d;
+    }
+    out[k] = score;
+    if (score > out[best]) best = k;
+  }
+
+  float sum = 0;
+  for (int k = 0; k < NB_CLASSES; k++) sum += expf(out[k] - out[best]);
+  float norm = out[best] + logf(sum);
+  for (int k = 0; k < NB_CLASSES; k++) out[k] -= norm;
+  return best;
+}
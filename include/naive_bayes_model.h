@@ -0,0 +1,34 @@
+/*
+  Gaussian Naive Bayes Model
+  Generated by backend/export_naive_bayes.py from data/raw (50-sample device windows); do not edit.
+  Features: mean, rms, variance, dominant_frequency.
+  Cross-validated accuracy: 0.553 (5-fold).
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define NB_CLASSES 4
+#define NB_FEATURES 4
+
+// BackendFeature of each model input
+constexpr uint8_t NB_FEATURE_INDEX[NB_FEATURES] = {0, 1, 2, 4};
+
+// Per class: log prior minus the Gaussian normalizers
+constexpr float NB_LOG_NORM[NB_CLASSES] = {17.376903f, 10.7466653f, 9.1054956f, 9.21704546f};
+
+constexpr float NB_MEAN[NB_CLASSES][NB_FEATURES] = {
+  {1.44885727f, 1.44889841f, 0.000118780745f, 1.171875f},  // normal
+  {1.45236394f, 1.45254274f, 0.000518285218f, 1.3671875f},  // mild
+  {1.45152364f, 1.45190158f, 0.00110726536f, 1.42637311f},  // moderate
+  {1.43967242f, 1.4401703f, 0.00143514624f, 1.50331439f},  // severe
+};
+
+// 1 / (2 variance)
+constexpr float NB_HALF_PRECISION[NB_CLASSES][NB_FEATURES] = {
+  {6392.09231f, 6427.78539f, 35883215.0f, 1310.71987f},  // normal
+  {512.667738f, 513.257365f, 976052.656f, 13.1072f},  // mild
+  {177.871078f, 177.244195f, 277736.903f, 14.4324983f},  // moderate
+  {139.58618f, 139.533826f, 318179.165f, 25.4888228f},  // severe
+};
@@ -0,0 +1,14 @@
+/*
+  Firmware Update Signing Key
+  Public half of the ECDSA P-256 key whose packages this build accepts
+  (ota_update.h). Empty, as shipped, refuses every update; replace it
+  with the output of
+
+    firmware_package keygen signing.pem > include/ota_key.h
+
+  and keep signing.pem off the devices.
+*/
+
+#pragma once
+
+#define OTA_PUBLIC_KEY_PEM ""
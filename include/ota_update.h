@@ -0,0 +1,107 @@
+/*
+  Firmware Update over the Telemetry Link
+  Writes a signed, compressed image into the inactive OTA partition
+  (app0/app1 of the default partition table) while acquisition keeps
+  running, so an update no longer needs the PlatformIO upload flow.
+
+  The host (ingest_daemon --update) sends a package built by
+  host/firmware_package.cpp as console commands, each followed by raw
+  payload bytes:
+
+    ota begin <bytes> <crc>          manifest: size, SHA-256, signature
+    ota block <index> <bytes> <crc>  one OTA_BLOCK_SIZE block, raw deflate
+    ota finish                       read the image back and check its hash
+    ota apply                        boot the new image
+    ota abort | ota                  drop the update | OTA: status line
+
+  Each command gets one "OK ota ..." / "ERR ota ..." reply, sent once its
+  work is done, so the host sends the next block only after the last one
+  is in flash. The manifest is ECDSA P-256 signed; a build without a key
+  in ota_key.h refuses updates.
+
+  Work happens in an idle task, one bounded step per pass: inflate, erase
+  the block's sector, write it in OTA_WRITE_PIECE pieces, or hash one
+  block during verification. A sector erase holds the flash for tens of
+  milliseconds, so the sample task skips a few periods per block (counted
+  by the scheduler) rather than the update pausing monitoring for the
+  length of a full erase.
+
+  Progress is saved in NVS every OTA_SAVE_BLOCKS blocks. After a reset or
+  a lost host, "ota begin" with the same signed manifest resumes at the
+  saved block. A new image first boots on trial: it is confirmed after
+  OTA_CONFIRM_MS of sampling. If it resets OTA_TRIAL_BOOTS times before
+  that, the previous partition is booted again and reports "OTA:rolled_back".
+  With a rollback-enabled bootloader, an image that never reaches setup()
+  is rolled back as well.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define OTA_BLOCK_SIZE 4096                 // one flash sector per block
+#define OTA_CHUNK_MAX (OTA_BLOCK_SIZE + 64)  // deflate of an incompressible block
+#define OTA_WRITE_PIECE 1024                // flash bytes written per idle pass
+#define OTA_SAVE_BLOCKS 16                  // progress saved this often
+#define OTA_CONFIRM_MS 60000UL
+#define OTA_TRIAL_BOOTS 3
+#define OTA_RESTART_DELAY_MS 250            // lets the apply reply drain
+#define OTA_MANIFEST_MAGIC 0x5746504EUL     // "NPFW"
+#define OTA_MANIFEST_VERSION 1
+#define OTA_SIGNATURE_MAX 72                // DER ECDSA P-256
+
+// Package header; the signature covers every byte before signatureLength
+struct OtaManifest {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t blockSize;
+  uint32_t imageSize;
+  uint32_t blockCount;
+  uint8_t sha256[32];  // of the uncompressed image
+  uint8_t signatureLength;
+  uint8_t reserved[3];
+  uint8_t signature[OTA_SIGNATURE_MAX];
+};
+
+#define OTA_SIGNED_BYTES 48
+static_assert(sizeof(OtaManifest) == 124, "manifest layout is shared with the host");
+static_assert(offsetof(OtaManifest, signatureLength) == OTA_SIGNED_BYTES, "signed prefix moved");
+
+enum OtaPhase : uint8_t {
+  OTA_PHASE_RECEIVING,    // blocks before nextBlock are in flash
+  OTA_PHASE_VERIFIED,     // hash checked, not applied yet
+  OTA_PHASE_TRIAL,        // applied; confirmed once it has run long enough
+  OTA_PHASE_ROLLED_BACK,  // the trial failed; reported by the old image
+};
+
+// Saved across resets (config_store.h)
+struct OtaProgress {
+  uint8_t sha256[32];
+  uint32_t imageSize;
+  uint32_t blockCount;
+  uint32_t nextBlock;
+  uint32_t target;    // flash address of the partition being written
+  uint32_t previous;  // partition running when the image was applied
+  OtaPhase phase;
+  uint8_t trialBoots;
+  uint8_t reserved[2];
+};
+
+enum OtaPayload : uint8_t { OTA_PAYLOAD_MANIFEST, OTA_PAYLOAD_BLOCK };
+
+// Trial boot bookkeeping and rollback; early in setup()
+void otaSetup();
+
+// One bounded step of the pending work; from an idle task
+void otaService();
+
+// Where the console puts the next payload; index is the block number.
+// A payload that never completes gives back the memory leased for it.
+uint8_t* otaExpect(OtaPayload kind, uint32_t index, uint32_t crc);
+void otaPayloadReceived(uint16_t length, bool complete);
+
+void otaFinish();
+void otaApply();
+void otaAbort();
+void printOta();  // OTA:<state>,<running>,<target>,<next block>,<blocks>
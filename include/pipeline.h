@@ -0,0 +1,273 @@
+/*
+  Compile-time Signal Pipeline
+  Typed stages composed with templates, so the whole per-sample chain is
+  resolved at compile time and inlined without virtual dispatch. Products
+  (tremor classifier, EOG cursor) assemble their own pipelines from the
+  same stages.
+
+  Per-sample stage:   float process(float x); void reset();
+                      void setSampleRate(float fs);
+  Feature set:        see feature_accumulators.h
+  Classifier:         Result classify(float* features);
+  Sink:               void onSample(float input, float output);
+                      void onWindow(Result result, float* features);
+
+  push() only does the O(1) per-sample work; a completed window's feature
+  values are parked until analyze() classifies them, so classification can
+  run as its own lower-priority task after the sample.
+*/
+
+#pragma once
+
+#include <math.h>
+
+// ADC counts to volts
+template <int FullScale = 4095>
+struct AdcToVolts {
+  float vref = 3.3f;
+  float offset = 0;  // volts, subtracted after scaling
+  float gain = 1;
+
+  inline float process(float raw) {
+    return ((raw / FullScale) * vref - offset) * gain;
+  }
+  inline void reset() {}
+  inline void setSampleRate(float) {}
+};
+
+// First-order low-pass that snaps to the input on extreme jumps
+struct AlphaLowPass {
+  float alpha = 0.1f;
+  float resetThreshold = 2.0f;
+  float y = 0;
+
+  inline float process(float x) {
+    y = alpha * x + (1 - alpha) * y;
+    if (fabsf(y - x) > resetThreshold) {
+      y = x;  // Reset filter on extreme change
+    }
+    return y;
+  }
+  inline void reset() { y = 0; }
+  inline void setSampleRate(float) {}  // alpha is per sample, as in the original sketch
+};
+
+// Second-order section, transposed direct form II (RBJ cookbook designs)
+struct Biquad {
+  float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+  float z1 = 0, z2 = 0;
+
+  inline float process(float x) {
+    float y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+  inline void reset() { z1 = z2 = 0; }
+
+  void design(float nb0, float nb1, float nb2, float a0, float na1, float na2) {
+    b0 = nb0 / a0; b1 = nb1 / a0; b2 = nb2 / a0;
+    a1 = na1 / a0; a2 = na2 / a0;
+  }
+
+  void lowPass(float fc, float fs, float q) {
+    float w = 2 * (float)M_PI * fc / fs, c = cosf(w), alpha = sinf(w) / (2 * q);
+    design((1 - c) / 2, 1 - c, (1 - c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+  }
+
+  void highPass(float fc, float fs, float q) {
+    float w = 2 * (float)M_PI * fc / fs, c = cosf(w), alpha = sinf(w) / (2 * q);
+    design((1 + c) / 2, -(1 + c), (1 + c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+  }
+
+  void notch(float f0, float fs, float q) {
+    float w = 2 * (float)M_PI * f0 / fs, c = cosf(w), alpha = sinf(w) / (2 * q);
+    design(1, -2 * c, 1, 1 + alpha, -2 * c, 1 - alpha);
+  }
+};
+
+// Mains notch. Params: FS_HZ, NOTCH_HZ, NOTCH_Q
+template <typename Params>
+struct NotchFilter {
+  Biquad section;
+
+  NotchFilter() { setSampleRate(Params::FS_HZ); }
+  inline float process(float x) { return section.process(x); }
+  inline void reset() { section.reset(); }
+  void setSampleRate(float fs) { section.notch(Params::NOTCH_HZ, fs, Params::NOTCH_Q); }
+};
+
+// Butterworth low-pass. Params: FS_HZ, HIGH_HZ
+template <typename Params>
+struct LowPassFilter {
+  Biquad section;
+
+  LowPassFilter() { setSampleRate(Params::FS_HZ); }
+  inline float process(float x) { return section.process(x); }
+  inline void reset() { section.reset(); }
+  void setSampleRate(float fs) { section.lowPass(Params::HIGH_HZ, fs, 0.7071f); }
+};
+
+// Butterworth high-pass. Params: FS_HZ, LOW_HZ
+template <typename Params>
+struct HighPassFilter {
+  Biquad section;
+
+  HighPassFilter() { setSampleRate(Params::FS_HZ); }
+  inline float process(float x) { return section.process(x); }
+  inline void reset() { section.reset(); }
+  void setSampleRate(float fs) { section.highPass(Params::LOW_HZ, fs, 0.7071f); }
+};
+
+// Band-pass as a high-pass/low-pass pair. Params: FS_HZ, LOW_HZ, HIGH_HZ
+template <typename Params>
+struct BandPassFilter {
+  Biquad high, low;
+
+  BandPassFilter() { setSampleRate(Params::FS_HZ); }
+  inline float process(float x) { return low.process(high.process(x)); }
+  inline void reset() { high.reset(); low.reset(); }
+  void setSampleRate(float fs) {
+    high.highPass(Params::LOW_HZ, fs, 0.7071f);
+    low.lowPass(Params::HIGH_HZ, fs, 0.7071f);
+  }
+};
+
+// Removes slow electrode drift from DC-coupled signals. The baseline
+// can be frozen while a real excursion (e.g. a saccade) is in progress.
+struct DriftCompensator {
+  float timeConstant = 10.0f;  // seconds
+  float rate = 0.0005f;        // per sample; 10 s at 200 Hz
+  float baseline = 0;
+  bool primed = false;
+  bool frozen = false;
+
+  inline float process(float x) {
+    if (!primed) {
+      baseline = x;
+      primed = true;
+    }
+    if (!frozen) {
+      baseline += rate * (x - baseline);
+    }
+    return x - baseline;
+  }
+  inline void reset() { primed = false; }
+  inline void setSampleRate(float fs) { rate = 1.0f / (timeConstant * fs); }
+};
+
+// Full-wave rectifier, ahead of a low-pass for a band-limited envelope
+struct Rectifier {
+  inline float process(float x) { return fabsf(x); }
+  inline void reset() {}
+  inline void setSampleRate(float) {}
+};
+
+// Rectified, smoothed amplitude envelope
+struct EnvelopeFollower {
+  float alpha = 0.05f;
+  float y = 0;
+
+  inline float process(float x) {
+    y += alpha * (fabsf(x) - y);
+    return y;
+  }
+  inline void reset() { y = 0; }
+  inline void setSampleRate(float) {}
+};
+
+// Per-sample stages applied left to right
+template <typename... Stages>
+struct FilterChain;
+
+template <>
+struct FilterChain<> {
+  inline float process(float x) { return x; }
+  inline void reset() {}
+  inline void setSampleRate(float) {}
+};
+
+template <typename First, typename... Rest>
+struct FilterChain<First, Rest...> {
+  First first;
+  FilterChain<Rest...> rest;
+
+  inline float process(float x) { return rest.process(first.process(x)); }
+  inline void reset() {
+    first.reset();
+    rest.reset();
+  }
+  void setSampleRate(float fs) {
+    first.setSampleRate(fs);
+    rest.setSampleRate(fs);
+  }
+};
+
+// Calibration -> filters -> windowed features -> classifier -> sink
+template <typename Calibration, typename Filters, typename Features,
+          typename Classifier, typename Sink>
+struct Pipeline {
+  Calibration calibration;
+  Filters filters;
+  Features features;
+  Classifier classifier;
+  Sink sink;
+  int windowSize;
+  int windowIndex = 0;
+  float windowValues[Features::COUNT];
+  bool windowPending = false;
+  bool held = false;
+
+  explicit Pipeline(int window) : windowSize(window) {}
+
+  // Returns true when a window has completed and is waiting for analyze()
+  inline bool push(float raw) {
+    float input = calibration.process(raw);
+    float output = filters.process(input);
+    sink.onSample(input, output);
+
+    // Accumulate features as samples arrive
+    if (held) return windowPending;
+    features.push(output);
+    if (++windowIndex >= windowSize) {
+      features.finalize(windowValues);
+      windowIndex = 0;
+      windowPending = true;
+    }
+    return windowPending;
+  }
+
+  // Classify and report the completed window, if any
+  bool analyze() {
+    if (!windowPending) return false;
+    windowPending = false;
+    sink.onWindow(classifier.classify(windowValues), windowValues);
+    return true;
+  }
+
+  // Drop the completed window unclassified (e.g. signal quality too low)
+  void discard() { windowPending = false; }
+
+  // While held, samples still reach the sink but not the features; they
+  // restart on release rather than mix what came before with what after
+  void hold(bool on) {
+    if (held && !on) {
+      features.reset();
+      windowIndex = 0;
+    }
+    held = on;
+  }
+
+  void reset() {
+    filters.reset();
+    features.reset();
+    windowIndex = 0;
+    windowPending = false;
+  }
+
+  void setSampleRate(float fs) {
+    filters.setSampleRate(fs);
+    features.setSampleRate(fs);
+    reset();
+  }
+};
@@ -0,0 +1,63 @@
+/*
+  Pipeline Budgets
+  The configurations each device mode runs, in the terms of the cycle
+  budget model (cycle_budget.h). The firmware static_asserts them and
+  checks runtime changes against them (pipelineFor); the host planner
+  starts from the tremor one, so its defaults are the shipped firmware.
+*/
+
+#pragma once
+
+#include "antagonist.h"
+#include "cycle_budget.h"
+#include "device_config.h"
+#include "eog.h"
+#include "imu.h"
+#include "line_enhancer.h"
+#include "motor_context.h"
+#include "prototypes.h"
+#include "tremor.h"
+#include "welch.h"
+
+#ifdef TREMOR_NAIVE_BAYES
+constexpr cycle_budget::ModelKind TREMOR_MODEL = cycle_budget::MODEL_NAIVE_BAYES;
+#else
+constexpr cycle_budget::ModelKind TREMOR_MODEL = cycle_budget::MODEL_RULES;
+#endif
+
+constexpr cycle_budget::PipelineConfig TREMOR_PIPELINE = {
+  1,                              // channels
+  SAMPLE_RATE,                    // sampleRate
+  BATCH_SIZE,                     // windowSize
+  FEATURE_COUNT,                  // features
+  TREMOR_MODEL,                   // model
+  cycle_budget::TELEMETRY_TEXT,   // telemetry
+  true,                           // streamingFeatures
+  BAUD_RATE,                      // baudRate
+  1, 1, 1,                        // acquisition/analysis/telemetry core
+  1,                              // auxChannels: extensor EMG
+  ANTAGONIST_FFT_SIZE,            // fftSize: antagonist and accelerometer segments
+  2.0f * ANTAGONIST_ENVELOPE_HZ / ANTAGONIST_FFT_SIZE,  // fftPerSecond
+  WELCH_SEGMENT_SIZE,             // psdSize
+  welchHop(50) * welchDecimation(SAMPLE_RATE),  // psdHop: default overlap, input samples
+  ALE_TAPS,                       // adaptiveTaps
+  imuRateFor(SAMPLE_RATE) * IMU_FRAME_BYTES,  // imuBusBytes: budgeted even when absent
+  imuBurstFrames(1000000UL / SAMPLE_RATE) * IMU_FRAME_BYTES,  // imuBurstBytes
+  CONTEXT_FILTER_SECTIONS,        // contextFilters
+  PROTOTYPE_CAPACITY,             // prototypes: budgeted full
+  true                            // anomalyScore
+};
+constexpr cycle_budget::PipelineConfig EOG_PIPELINE = {
+  EOG_CHANNELS,                     // channels
+  SAMPLE_RATE,                      // sampleRate
+  EOG_FRAME_DECIMATION,             // windowSize: one JSON frame
+  3,                                // features: drift, low-pass, velocity
+  cycle_budget::MODEL_EOG_EVENTS,   // model
+  cycle_budget::TELEMETRY_JSON,     // telemetry
+  true,                             // streamingFeatures
+  BAUD_RATE,                        // baudRate
+  1, 1, 1,                          // acquisition/analysis/telemetry core
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // no auxiliary channels, spectra, enhancer, IMU, context
+                                    // or prototypes
+  false                             // anomalyScore
+};
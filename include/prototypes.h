@@ -0,0 +1,86 @@
+/*
+  Patient Prototypes
+  Labelled windows a clinician enrolls from the console ("enroll mild"
+  while the patient shows their mild tremor), kept in a fixed table and
+  searched nearest-first for every classified window. Vectors are
+  stored normalized (each feature divided by its typical spread), so the
+  distance is a plain squared Euclidean one over PROTOTYPE_FEATURES
+  values, unrolled by four.
+
+  When full, a new prototype replaces the oldest one. The table is saved
+  to NVS by config_store, so enrollment survives a reset.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define PROTOTYPE_CAPACITY 32
+#define PROTOTYPE_FEATURES 8   // see prototypeVector() in tremor.h
+#define PROTOTYPE_K 3
+#define PROTOTYPE_RADIUS 2.0f  // normalized distance past which the global model decides
+
+struct Prototype {
+  float vector[PROTOTYPE_FEATURES];  // normalized
+  uint8_t label;                     // TremorClass
+  uint8_t reserved[3];               // keeps the stored record free of padding bytes
+};
+
+struct PrototypeTable {
+  static_assert(PROTOTYPE_FEATURES % 4 == 0, "distances are computed four features at a time");
+
+  Prototype entries[PROTOTYPE_CAPACITY];
+  uint16_t count = 0;
+  uint16_t next = 0;  // slot the next enrollment writes, oldest once full
+
+  void add(const float* vector, uint8_t label) {
+    Prototype& p = entries[next];
+    for (int i = 0; i < PROTOTYPE_FEATURES; i++) p.vector[i] = vector[i];
+    p.label = label;
+    p.reserved[0] = p.reserved[1] = p.reserved[2] = 0;
+    next = (next + 1) % PROTOTYPE_CAPACITY;
+    if (count < PROTOTYPE_CAPACITY) count++;
+  }
+
+  void clear() {
+    count = 0;
+    next = 0;
+  }
+
+  // Squared distance between normalized vectors
+  static inline float distance(const float* a, const float* b) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < PROTOTYPE_FEATURES; i += 4) {
+      float d0 = a[i] - b[i], d1 = a[i + 1] - b[i + 1];
+      float d2 = a[i + 2] - b[i + 2], d3 = a[i + 3] - b[i + 3];
+      s0 += d0 * d0;
+      s1 += d1 * d1;
+      s2 += d2 * d2;
+      s3 += d3 * d3;
+    }
+    return (s0 + s1) + (s2 + s3);
+  }
+
+  // Up to k nearest prototypes, closest first; returns how many
+  int nearest(const float* vector, int k, uint8_t* labels, float* distances) const {
+    int found = 0;
+    for (int p = 0; p < count; p++) {
+      float d = distance(vector, entries[p].vector);
+      if (found == k && d >= distances[k - 1]) continue;
+      int i = found < k ? found++ : k - 1;
+      for (; i > 0 && distances[i - 1] > d; i--) {
+        distances[i] = distances[i - 1];
+        labels[i] = labels[i - 1];
+      }
+      distances[i] = d;
+      labels[i] = entries[p].label;
+    }
+    return found;
+  }
+
+  int countLabel(uint8_t label) const {
+    int n = 0;
+    for (int p = 0; p < count; p++) n += entries[p].label == label;
+    return n;
+  }
+};
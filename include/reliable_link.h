@@ -0,0 +1,70 @@
+/*
+  Reliable Event Delivery
+  Classification records, anomaly events and EOG events are what the
+  host stores; a line lost to a UART overrun used to vanish unnoticed.
+  Once a host turns reliability on (console "reliable on"), each of them
+  goes out framed and stays in a retransmit window until acknowledged:
+
+    @<seq>,<base>,<ms>,<crc>:<line>   device -> host
+    ack <next> [<sack>]               host -> device (console)
+
+  seq counts frames since boot, base is the oldest frame still held (the
+  host stops waiting for anything before it), ms is millis() when the
+  line was first queued, and crc is the CRC-16/CCITT in hexadecimal of
+  everything between '@' and ':' except the crc field, followed by the
+  line. <next> acknowledges every frame before it; bit i of the hex
+  <sack> acknowledges frame next + 1 + i, so only the gaps are resent.
+
+  A frame is resent after RELIABLE_RTO_MS, doubling to RELIABLE_MAX_RTO_MS,
+  or sooner once the host has acknowledged frames past it. The host drops
+  duplicates by sequence number, so each event is delivered once. The
+  window is RELIABLE_WINDOW frames of static RAM. When it is full the
+  oldest frame is abandoned and counted, so a missing host never blocks
+  the pipeline.
+
+  Samples, status lines and replies stay plain best-effort lines. With
+  reliability off (the default, and after every reset) the events are
+  plain lines too, so existing readers see no change.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "telemetry.h"
+
+#define RELIABLE_WINDOW 16
+#define RELIABLE_FRAME_MAX 144       // line bytes; the header takes up to 40 more
+#define RELIABLE_RTO_MS 400
+#define RELIABLE_MAX_RTO_MS 3200
+#define RELIABLE_FAST_MS 100         // a gap acknowledged past is resent this soon
+#define RELIABLE_RESENDS_PER_SERVICE 2
+
+static_assert(RELIABLE_FRAME_MAX + 40 < TELEMETRY_LINE_MAX, "reliable frame exceeds a telemetry line");
+static_assert((RELIABLE_WINDOW & (RELIABLE_WINDOW - 1)) == 0, "window indexes by sequence bits");
+
+struct ReliableStats {
+  uint32_t sent;       // frames queued
+  uint32_t resent;     // retransmissions
+  uint32_t acked;
+  uint32_t abandoned;  // pushed out of a full window unacknowledged
+};
+
+void reliableEnable(bool on);
+bool reliableEnabled();
+
+// An event line: framed and held when reliability is on, plain otherwise
+bool reliablePrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// Host acknowledgement: everything before next, plus the sack bitmap
+void reliableAck(uint32_t next, uint32_t sack);
+
+// Retransmit what is due; from the telemetry task
+void reliableService();
+
+uint32_t reliableNextSequence();
+uint32_t reliableBase();
+const ReliableStats& reliableStats();
+
+// RELIABLE:on|off,next,base,in_flight,sent,resent,acked,abandoned
+void sendReliableStats();
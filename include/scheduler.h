@@ -0,0 +1,66 @@
+/*
+  Cooperative Task Scheduler
+  Deterministic run-to-completion scheduling for loop(). Each call to
+  schedulerRun() starts at most one task: the highest-priority task that
+  is due, or else the next idle task in turn. Since tasks never preempt
+  each other, the sampling task (priority 0) waits at most for one other
+  task to finish, and housekeeping only fills time nothing else wants.
+
+  Task kinds:
+    TASK_PERIODIC  released every periodUs on a fixed grid
+    TASK_EVENT     released by schedulerSignal() (e.g. a completed window)
+    TASK_IDLE      always ready, run round-robin when nothing else is due
+
+  A task misses its deadline when it starts more than deadlineUs after
+  its release. Per-task runs, cycles, start latency, misses and skipped
+  periods are kept for the console.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define SCHEDULER_MAX_TASKS 12  // 9 registered in setup(), room for a few more
+
+enum TaskKind : uint8_t { TASK_PERIODIC, TASK_EVENT, TASK_IDLE };
+
+typedef void (*TaskFunction)(uint32_t now);
+
+struct TaskStats {
+  uint32_t runs;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+  uint32_t maxLatencyUs;    // release to start
+  uint32_t deadlineMisses;
+  uint32_t skipped;         // periodic releases dropped after falling behind
+};
+
+struct Task {
+  const char* name;
+  TaskFunction run;
+  TaskKind kind;
+  uint8_t priority;  // 0 runs first
+  uint32_t periodUs;
+  uint32_t deadlineUs;
+  uint32_t release;  // µs timestamp of the pending release
+  bool ready;
+  TaskStats stats;
+};
+
+// Register a task; returns its id, or -1 if the table is full
+int schedulerAdd(const char* name, TaskFunction run, TaskKind kind, uint8_t priority,
+                 uint32_t periodUs, uint32_t deadlineUs);
+
+// Change a periodic task's period and deadline; the grid restarts now
+void schedulerSetPeriod(int id, uint32_t periodUs, uint32_t deadlineUs);
+
+// Release an event task
+void schedulerSignal(int id);
+
+// Run the next task, if any; call from loop()
+void schedulerRun();
+
+int schedulerTaskCount();
+const Task& schedulerTask(int id);
+uint64_t schedulerBusyCycles();  // non-idle task cycles since boot
+void schedulerResetStats();
@@ -0,0 +1,125 @@
+/*
+  Signal Quality Index
+  Per-channel electrode/lead-off check run on the raw ADC counts of every
+  sample. Each block (one second of samples) scores five symptoms of a
+  bad contact, and the SQI is the weakest of them, 0 (unusable) to 1:
+
+    saturation  fraction of samples at the ADC rails (lead off, railed amp)
+    flatline    longest run without change (open input, dead channel)
+    line noise  share of AC power at 50/60 Hz (Goertzel; floating input),
+                skipping a mains line that aliases to near DC or Nyquist
+    HF floor    quietest sub-block RMS of the second difference, so bursts
+                of real EMG do not count but constant broadband noise does
+    offset      distance of the block mean from mid-rail (impedance proxy:
+                a drying or lifting electrode drags the amplifier off centre)
+
+  Each score ramps linearly from 1 at its "good" limit to 0 at its "bad"
+  limit. Below SQI_GATE the channel's output is not classified.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "device_config.h"
+
+#define SQI_GATE 0.5f
+#define SQI_SUBBLOCKS 4
+#define SQI_MAINS_A_HZ 50.0f
+#define SQI_MAINS_B_HZ 60.0f
+#define SQI_MAINS_GUARD_HZ 2.0f  // aliased this close to DC or Nyquist: not measured
+
+enum SqiFlag : uint8_t {
+  SQI_SATURATED = 1 << 0,
+  SQI_FLATLINE = 1 << 1,
+  SQI_LINE_NOISE = 1 << 2,
+  SQI_HF_NOISE = 1 << 3,
+  SQI_OFFSET = 1 << 4,
+};
+
+struct SqiMetrics {
+  float saturation;  // fraction of samples
+  float flatline;    // longest flat run, fraction of block
+  float lineRatio;   // mains power / AC power
+  float hfNoise;     // volts RMS
+  float offset;      // volts from mid-rail
+};
+
+struct SignalQuality {
+  // Tuning: {good, bad} limits per metric
+  float saturationLimits[2] = {0.01f, 0.10f};
+  float flatlineLimits[2] = {0.10f, 0.50f};
+  float lineLimits[2] = {0.30f, 0.80f};
+  float hfLimits[2] = {0.05f, 0.30f};
+  float offsetLimits[2] = {0.40f, 1.20f};
+  float voltsPerCount = 3.3f / 4095;
+  float midRail = 1.65f;
+  int railLow = 8, railHigh = 4087;
+
+  // Latest block; optimistic until the first block completes
+  float score = 1;
+  uint8_t flags = 0;
+  SqiMetrics metrics = {0, 0, 0, 0, 0};
+
+  // Block accumulators
+  int blockSize = SAMPLE_RATE;
+  int n = 0;
+  int saturated = 0;
+  int prevRaw = -1;
+  int flatRun = 0, longestFlat = 0;
+  float sum = 0, sumSquares = 0;
+  float coeffA = 0, coeffB = 0;          // Goertzel 2cos(w)
+  bool lineA = true, lineB = true;       // mains line measurable at this rate
+  float a1 = 0, a2 = 0, b1 = 0, b2 = 0;  // Goertzel state
+  float x1 = 0, x2 = 0;                  // previous volts for the 2nd difference
+  float hfSum = 0, hfFloor = 0;
+  int hfCount = 0;
+
+  SignalQuality() { setSampleRate(SAMPLE_RATE); }
+
+  void setSampleRate(float fs);
+  void reset();
+  inline bool usable() const { return score >= SQI_GATE; }
+
+  inline void push(int raw) {
+    float x = raw * voltsPerCount;
+
+    if (raw <= railLow || raw >= railHigh) saturated++;
+    int step = raw - prevRaw;
+    flatRun = (prevRaw >= 0 && step >= -1 && step <= 1) ? flatRun + 1 : 0;
+    if (flatRun > longestFlat) longestFlat = flatRun;
+    prevRaw = raw;
+
+    sum += x;
+    sumSquares += x * x;
+    float a0 = x + coeffA * a1 - a2;
+    a2 = a1;
+    a1 = a0;
+    float b0 = x + coeffB * b1 - b2;
+    b2 = b1;
+    b1 = b0;
+
+    if (n >= 2) {
+      float d2 = x - 2 * x1 + x2;
+      hfSum += d2 * d2;
+      hfCount++;
+    }
+    x2 = x1;
+    x1 = x;
+
+    // Close a sub-block for the HF floor, then the whole block
+    if (++n % (blockSize / SQI_SUBBLOCKS) == 0 && hfCount > 0) {
+      float meanSquare = hfSum / hfCount;
+      if (n == blockSize / SQI_SUBBLOCKS || meanSquare < hfFloor) hfFloor = meanSquare;
+      hfSum = 0;
+      hfCount = 0;
+    }
+    if (n >= blockSize) evaluate();
+  }
+
+ private:
+  void evaluate();
+};
+
+// Lowest SQI across channels
+float minimumSqi(const SignalQuality* channels, int count);
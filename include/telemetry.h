@@ -0,0 +1,37 @@
+/*
+  Non-blocking Telemetry Channel
+  All device output is queued in a RAM ring buffer and drained to the
+  UART only as fast as its FIFO accepts bytes, so a slow link never
+  stalls the sampling path. Writes that do not fit are dropped whole and
+  counted rather than blocking.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_BUFFER_SIZE 2048
+#define TELEMETRY_LINE_MAX 192
+
+struct TelemetryStats {
+  uint32_t bytesSent;
+  uint32_t bytesDropped;
+  uint32_t writesDropped;
+  size_t highWater;  // peak ring occupancy in bytes
+};
+
+// Queue a complete record; false (and counted) if it does not fit
+bool telemetryWrite(const char* data, size_t length);
+// Lines longer than TELEMETRY_LINE_MAX are cut, and still end in "\r\n"
+bool telemetryPrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// Length of a vsnprintf() result in a TELEMETRY_LINE_MAX buffer, ending
+// a cut line in "\r\n" so the next one starts on its own line
+size_t telemetryLineLength(char* line, int length);
+
+// Move as many queued bytes as the UART accepts without waiting
+void telemetryFlush();
+
+size_t telemetryPending();
+const TelemetryStats& telemetryStats();
@@ -0,0 +1,204 @@
+/*
+  Tremor Classification Interface
+  Feature extraction and rule-based classification shared by the
+  sampling loop and the benchmark build.
+*/
+
+#pragma once
+
+#include "device_config.h"
+#include "downsample.h"
+#include "feature_accumulators.h"
+#include "harmonics.h"
+#include "imu_features.h"
+#include "line_enhancer.h"
+#include "motor_context.h"
+#include "naive_bayes.h"
+#include "pipeline.h"
+#include "prototypes.h"
+
+#define BATCH_SIZE 50
+#define TREMOR_MIN_PEAK_SHARE 0.25f  // spectral peak share of a periodic signal
+#define PROTOTYPE_MAX_HARMONIC_RATIO 4.0f
+
+// The rules use three; the backend and naive Bayes models also MODERATE
+enum TremorClass { NORMAL, MILD, MODERATE, SEVERE, TREMOR_CLASS_COUNT };
+static_assert(NB_CLASSES == TREMOR_CLASS_COUNT, "naive Bayes classes are the backend's four");
+
+// Window feature layout, in TremorFeatures order
+enum TremorFeatureIndex {
+  FEATURE_MEAN_AMPLITUDE,
+  FEATURE_RMS,
+  FEATURE_ZERO_CROSSING_RATE,
+  FEATURE_ZC_FREQUENCY,        // from the window's zero crossings
+  FEATURE_PEAK_FREQUENCY,      // Welch PSD peak, 0 until the first segment
+  FEATURE_PEAK_CONCENTRATION,  // share of 1-20 Hz power at the peak
+  FEATURE_FUNDAMENTAL,         // harmonic product spectrum, 3-12 Hz
+  FEATURE_SECOND_HARMONIC,     // 2nd harmonic / fundamental power
+  FEATURE_THIRD_HARMONIC,      // 3rd harmonic / fundamental power
+  FEATURE_HARMONIC_COUNT,      // harmonics above the local floor
+  FEATURE_ACCEL_FREQUENCY,     // acceleration peak, 0 without an IMU
+  FEATURE_ACCEL_AMPLITUDE,     // 3-12 Hz acceleration RMS, g
+  FEATURE_EMG_ACCEL_COHERENCE, // at the acceleration peak
+  FEATURE_MOTOR_CONTEXT,       // MotorContext the window was recorded in
+  FEATURE_COUNT
+};
+
+struct TremorBaselineParams {
+  static constexpr float FS_HZ = SAMPLE_RATE;
+  static constexpr float LOW_HZ = 1.0f;  // offset and drift out, settles in about a second
+};
+
+// Amplitude features see the low-passed signal; the frequency features
+// see it with the offset removed and the periodic part enhanced
+typedef Prefiltered<FilterChain<HighPassFilter<TremorBaselineParams>, AdaptiveLineEnhancer<>>,
+                    ZeroCrossingFeatures, WelchHarmonics>
+    TremorFrequencyFeatures;
+typedef FeatureSet<MeanAbsAmplitude, RmsAmplitude, TremorFrequencyFeatures, ImuWindowFeatures,
+                   ContextWindowFeatures>
+    TremorFeatures;
+static_assert(TremorFeatures::COUNT == FEATURE_COUNT, "feature layout changed");
+
+// Frequency the classifier decides on: the averaged PSD peak once there
+// is one (the fundamental when the peak is one of its harmonics), the
+// zero-crossing estimate before that
+inline float dominantFrequency(const float* features) {
+  float peak = features[FEATURE_PEAK_FREQUENCY];
+  float fundamental = features[FEATURE_FUNDAMENTAL];
+  if (peak <= 0) return features[FEATURE_ZC_FREQUENCY];
+  if (fundamental > 0 && features[FEATURE_HARMONIC_COUNT] >= 1) {
+    float order = peak / fundamental;
+    int nearest = (int)(order + 0.5f);
+    if (nearest >= 2 && fabsf(order - nearest) < 0.1f * nearest) return fundamental;
+  }
+  return peak;
+}
+
+// Tremor shows as a concentrated spectral peak or a harmonic series;
+// broadband EMG and motion artefacts show neither
+inline bool periodicSignature(const float* features) {
+  return features[FEATURE_HARMONIC_COUNT] >= 1 ||
+         features[FEATURE_PEAK_CONCENTRATION] >= TREMOR_MIN_PEAK_SHARE;
+}
+
+// With an accelerometer, tremor also moves the limb: measurably, and at
+// the EMG rhythm (coherent with the bursts, or at the same frequency)
+inline bool mechanicalSignature(const float* features, float emgFrequency) {
+  return features[FEATURE_ACCEL_AMPLITUDE] >= IMU_MIN_TREMOR_G &&
+         (features[FEATURE_EMG_ACCEL_COHERENCE] >= IMU_COHERENCE_MIN ||
+          fabsf(features[FEATURE_ACCEL_FREQUENCY] - emgFrequency) <= IMU_FREQUENCY_MATCH_HZ);
+}
+
+TremorClass classifyFromFeatures(float* features);
+void printClassification(TremorClass classification, float* features, float sqi);
+
+struct RuleClassifier {
+  inline TremorClass classify(float* features) { return classifyFromFeatures(features); }
+};
+
+// Window features onto the CLI trainer's columns, as the exporter
+// computes them: the frequency is the plain Welch peak it was trained on,
+// and the columns the device has no equivalent for stay 0
+inline void backendFeatures(const float* features, float* out) {
+  float mean = features[FEATURE_MEAN_AMPLITUDE];
+  float rms = features[FEATURE_RMS];
+  out[BACKEND_MEAN] = mean;
+  out[BACKEND_RMS] = rms;
+  out[BACKEND_VARIANCE] = rms * rms > mean * mean ? rms * rms - mean * mean : 0;
+  out[BACKEND_ZERO_CROSSINGS] = 0;
+  out[BACKEND_DOMINANT_FREQUENCY] = features[FEATURE_PEAK_FREQUENCY];
+  out[BACKEND_SPECTRAL_ENTROPY] = 0;
+}
+
+// Exported backend model in place of the rules (-DTREMOR_NAIVE_BAYES)
+struct NaiveBayesClassifier {
+  float logProbabilities[NB_CLASSES];  // of the last window, in TremorClass order
+
+  inline TremorClass classify(float* features) {
+    float backend[BACKEND_FEATURE_COUNT];
+    backendFeatures(features, backend);
+    return (TremorClass)naiveBayesLogProbabilities(backend, logProbabilities);
+  }
+};
+
+// Window features as a prototype vector: each over its typical spread
+// between windows, so one unit is a comparable change in every feature.
+// Zero crossings are left out: on broadband EMG they swing by several Hz
+// from one window to the next. Harmonic ratios are capped: over a weak
+// fundamental they run into the hundreds.
+inline void prototypeVector(const float* features, float* out) {
+  float mean = features[FEATURE_MEAN_AMPLITUDE];
+  float rms = features[FEATURE_RMS];
+  float variance = rms * rms > mean * mean ? rms * rms - mean * mean : 0;
+  out[0] = sqrtf(variance) / 0.02f;                     // EMG standard deviation, 20 mV
+  out[1] = dominantFrequency(features);                 // 1 Hz
+  out[2] = features[FEATURE_PEAK_CONCENTRATION] / 0.2f;
+  out[3] = fminf(features[FEATURE_SECOND_HARMONIC], PROTOTYPE_MAX_HARMONIC_RATIO) / 0.5f;
+  out[4] = fminf(features[FEATURE_THIRD_HARMONIC], PROTOTYPE_MAX_HARMONIC_RATIO) / 0.5f;
+  out[5] = features[FEATURE_HARMONIC_COUNT];
+  out[6] = features[FEATURE_ACCEL_AMPLITUDE] / 0.02f;   // 20 mg
+  out[7] = features[FEATURE_EMG_ACCEL_COHERENCE] / 0.3f;
+}
+
+// Patient prototypes over a global model: prototypes within reach vote,
+// the global model's decision breaks ties; an empty table changes nothing
+template <typename Global>
+struct PrototypeClassifier {
+  Global global;
+  PrototypeTable table;
+  float lastVector[PROTOTYPE_FEATURES];  // of the last classified window, for enrollment
+  bool lastValid = false;
+  float nearestDistance = -1;            // normalized, -1 without prototypes
+  bool patientSpecific = false;          // prototypes took part in the last decision
+
+  inline TremorClass classify(float* features) {
+    TremorClass base = global.classify(features);
+    prototypeVector(features, lastVector);
+    lastValid = true;
+
+    uint8_t labels[PROTOTYPE_K];
+    float distances[PROTOTYPE_K];
+    int found = table.nearest(lastVector, PROTOTYPE_K, labels, distances);
+    nearestDistance = found ? sqrtf(distances[0]) : -1;
+
+    float votes[TREMOR_CLASS_COUNT] = {};
+    votes[base] = 0.5f;
+    patientSpecific = false;
+    for (int i = 0; i < found && distances[i] <= PROTOTYPE_RADIUS * PROTOTYPE_RADIUS; i++) {
+      votes[labels[i]] += 1;
+      patientSpecific = true;
+    }
+    int best = base;
+    for (int k = 0; k < TREMOR_CLASS_COUNT; k++) {
+      if (votes[k] > votes[best]) best = k;
+    }
+    return (TremorClass)best;
+  }
+};
+
+#ifdef TREMOR_NAIVE_BAYES
+typedef PrototypeClassifier<NaiveBayesClassifier> TremorClassifier;
+#else
+typedef PrototypeClassifier<RuleClassifier> TremorClassifier;
+#endif
+
+// Streams samples for Python parsing (or a downsampled display stream)
+// and reports classification changes
+struct TremorSerialSink {
+  TremorClass currentClassification = NORMAL;
+  float sqi = 1;            // latest signal quality, sent with every record
+  bool poorSignal = false;  // windows are being discarded
+  DisplayMode displayMode = DISPLAY_RAW;
+  MinMaxDownsampler minMax;
+  LttbDownsampler lttb;
+
+  void setDisplay(DisplayMode mode, int bucketSize);
+  void onSample(float voltage, float filtered);
+  void onWindow(TremorClass classification, float* features);
+  void onPoorSignal(uint8_t flags);
+};
+
+// ADC -> volts -> low-pass with reset -> streaming features -> prototypes over
+// rules or model -> serial
+typedef Pipeline<AdcToVolts<>, FilterChain<AlphaLowPass>, TremorFeatures,
+                 TremorClassifier, TremorSerialSink> TremorPipeline;
@@ -0,0 +1,148 @@
+/*
+  Streaming Welch PSD
+  Averaged power spectrum of the filtered tremor signal, kept current as
+  samples arrive. A BATCH_SIZE window is a fraction of a second, and a
+  single periodogram that short is too noisy to pick a tremor frequency
+  from; the Welch average over overlapping Hann segments is not.
+
+  Every hop (WELCH_SEGMENT_SIZE scaled by 100 - overlap percent) a new
+  segment starts. Its work (windowing into bit-reversed order, the FFT
+  butterflies, then folding the power into the average) is split into
+  equal slices run on each following sample, finishing within one hop,
+  so there is no burst at window end and the spectrum is always ready.
+
+  Above WELCH_ANALYSIS_RATE the signal is first decimated by block means
+  (it is already low-passed), so the fixed segment keeps bins fine
+  enough for the 1-20 Hz search at any sample rate: at 1000 Hz a direct
+  256-point segment would have 3.9 Hz bins and no bins below 7.8 Hz.
+
+  The average is a running mean over the first psdAverages segments,
+  then exponential with the same weight. The periodic Hann window keeps
+  the DC offset in bins 0-1, below the peak search band.
+
+  As a feature accumulator it reports the peak frequency (parabolic
+  interpolation between bins; 0 until the first segment) and the share
+  of band power within one bin of the peak. Unlike the per-window
+  accumulators, finalize() does not restart the average.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "device_config.h"
+#include "fft.h"
+
+#define WELCH_SEGMENT_SIZE 256  // 1.28 s, 0.78 Hz bins at 200 Hz
+#define WELCH_ANALYSIS_RATE 200 // decimated to at most this, Hz
+#define WELCH_BINS (WELCH_SEGMENT_SIZE / 2 + 1)
+#define WELCH_MIN_HZ 1.0f       // peak search band
+#define WELCH_MAX_HZ 20.0f
+
+// Slices of work per segment: load, butterflies, accumulate
+#define WELCH_SEGMENT_UNITS \
+  (WELCH_SEGMENT_SIZE + WELCH_SEGMENT_SIZE / 2 * fftLog2(WELCH_SEGMENT_SIZE) + WELCH_BINS)
+
+// Samples between segment starts for an overlap in percent
+constexpr int welchHop(int overlapPercent) {
+  return WELCH_SEGMENT_SIZE * (100 - overlapPercent) / 100 > 0
+       ? WELCH_SEGMENT_SIZE * (100 - overlapPercent) / 100 : 1;
+}
+
+// Input samples averaged into one analysed sample at a sample rate
+constexpr int welchDecimation(float fs) {
+  return fs > WELCH_ANALYSIS_RATE ? (int)(fs / WELCH_ANALYSIS_RATE) : 1;
+}
+
+// Fractional bin offset of the peak at bin k, -0.5..0.5 (needs k +/- 1)
+float peakOffset(const float* psd, int k);
+
+struct WelchPsd {
+  static constexpr int COUNT = 2;
+
+  enum Stage : uint8_t { STAGE_IDLE, STAGE_LOAD, STAGE_TRANSFORM, STAGE_ACCUMULATE };
+
+  Fft<WELCH_SEGMENT_SIZE> fft;
+  float sampleRate = SAMPLE_RATE;  // after decimation
+  int decimation = 1;
+  float binHz = 0;
+  float scale = 0;  // |X|^2 to one-sided V^2/Hz
+  int minBin = 0, maxBin = 0;
+  int hop = WELCH_SEGMENT_SIZE / 2;
+  int averages = 8;
+  int unitsPerSample = 1;  // per input sample
+
+  // Block mean in progress
+  float decimationSum = 0;
+  int decimationCount = 0;
+
+  // Most recent WELCH_SEGMENT_SIZE samples
+  float ring[WELCH_SEGMENT_SIZE];
+  int head = 0;
+  int filled = 0;
+  int sinceHop = 0;
+
+  // Segment in progress
+  Stage stage = STAGE_IDLE;
+  int segmentStart = 0;
+  int cursor = 0;
+  Fft<WELCH_SEGMENT_SIZE>::Cursor butterfly;
+  float re[WELCH_SEGMENT_SIZE];
+  float im[WELCH_SEGMENT_SIZE];
+  float bandPower = 0;
+  int bestBin = 0;
+
+  // Averaged spectrum and its latest peak
+  float psd[WELCH_BINS];
+  int segments = 0;
+  uint32_t overruns = 0;
+  float peakHz = 0;
+  float concentration = 0;
+
+  WelchPsd() {
+    configure(50, 8);
+    setSampleRate(SAMPLE_RATE);
+  }
+
+  // Overlap in percent (0-MAX_PSD_OVERLAP) and segments averaged
+  void configure(int overlapPercent, int averageCount);
+  // Input rate; the spectrum is of the decimated signal
+  void setSampleRate(float fs);
+  void reset();
+
+  inline void push(float x) {
+    // Runs first: loading reads the oldest sample before it is replaced
+    if (stage != STAGE_IDLE) advance(unitsPerSample);
+
+    if (decimation > 1) {
+      decimationSum += x;
+      if (++decimationCount < decimation) return;
+      x = decimationSum / decimation;
+      decimationSum = 0;
+      decimationCount = 0;
+    }
+
+    ring[head] = x;
+    head = head + 1 < WELCH_SEGMENT_SIZE ? head + 1 : 0;
+    if (filled < WELCH_SEGMENT_SIZE) filled++;
+    if (++sinceHop >= hop && filled == WELCH_SEGMENT_SIZE) {
+      sinceHop = 0;
+      if (stage != STAGE_IDLE) {
+        overruns++;
+      } else {
+        stage = STAGE_LOAD;
+        segmentStart = head;
+        cursor = 0;
+      }
+    }
+  }
+
+  inline void finalize(float* out) {
+    out[0] = peakHz;
+    out[1] = concentration;
+  }
+
+ private:
+  void pace();
+  void advance(int units);
+};
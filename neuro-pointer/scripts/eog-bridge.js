@@ -42,11 +42,22 @@ port.on("data", (chunk) => {
       const payload = JSON.parse(line);
       const messages = Array.isArray(payload) ? payload : [payload];
       messages.forEach((message) => {
-        if (!message || !Array.isArray(message.channels)) return;
+        if (!message) return;
+        // Firmware event frames are sent the moment a saccade/blink is detected
+        if (typeof message.event === "string") {
+          broadcast(JSON.stringify({ timestamp: message.timestamp ?? Date.now(), ...message }));
+          return;
+        }
+        if (!Array.isArray(message.channels)) return;
         const normalized = {
           timestamp: message.timestamp ?? Date.now(),
           channels: message.channels,
         };
+        // Firmware EOG mode adds gaze deltas and saccade/blink events
+        if (Array.isArray(message.gaze)) normalized.gaze = message.gaze;
+        if (Array.isArray(message.events)) normalized.events = message.events;
+        // Per-channel signal quality (0-1); gaze is held while any is poor
+        if (Array.isArray(message.sqi)) normalized.sqi = message.sqi;
         broadcast(JSON.stringify(normalized));
       });
     } catch (error) {
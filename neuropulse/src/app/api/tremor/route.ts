@@ -22,6 +22,12 @@ function emitRealtimeUpdate(data: any) {
   }
 }
 
+// Minimum signal quality index (0-1) for a window to be stored
+const SQI_GATE = 0.5;
+
+// Motor contexts the firmware classifies windows in
+const MOTOR_CONTEXTS = ['REST', 'POSTURE', 'MOVEMENT'];
+
 // Handle local classification data from ESP32
 async function handleLocalClassification(body: any) {
   const {
@@ -31,7 +37,9 @@ async function handleLocalClassification(body: any) {
     amplitude,
     rms,
     classification,
-    firmwareVersion
+    firmwareVersion,
+    signalQuality,
+    context
   } = body;
 
   if (!deviceId || !classification) {
@@ -44,6 +52,18 @@ async function handleLocalClassification(body: any) {
     );
   }
 
+  // Windows recorded through a poor electrode contact are acknowledged but
+  // not stored, so they cannot skew the history
+  const quality = signalQuality === undefined ? 1 : parseFloat(signalQuality);
+  if (classification === 'POOR_SIGNAL' || !(quality >= SQI_GATE)) {
+    return NextResponse.json({
+      success: true,
+      stored: false,
+      reason: 'poor signal quality',
+      signalQuality: quality
+    });
+  }
+
   await dbConnect();
 
   // Find or create device for local classifier
@@ -86,6 +106,8 @@ async function handleLocalClassification(body: any) {
     frequency: parseFloat(frequency) || 0,
     amplitude: parseFloat(amplitude) || 0,
     severityIndex: severityIndex,
+    signalQuality: quality,
+    context: MOTOR_CONTEXTS.includes(context) ? context.toLowerCase() : undefined,
     rawData: {
       emg: [], // No raw EMG data for local classification
       localClassification: classification,
@@ -8,6 +8,8 @@ export interface ITremorData extends Document {
   frequency: number; // Hz
   amplitude: number; // m/s²
   severityIndex: number; // 0-100 scale
+  signalQuality?: number; // 0-1, electrode contact quality of the window
+  context?: 'rest' | 'posture' | 'movement'; // limb state the window was classified in
   rawData?: {
     emg?: number[];
     accelerometer?: {
@@ -68,6 +70,15 @@ const tremorDataSchema = new Schema<ITremorData>(
       min: [0, 'Severity index must be between 0 and 100'],
       max: [100, 'Severity index must be between 0 and 100'],
     },
+    signalQuality: {
+      type: Number,
+      min: [0, 'Signal quality must be between 0 and 1'],
+      max: [1, 'Signal quality must be between 0 and 1'],
+    },
+    context: {
+      type: String,
+      enum: ['rest', 'posture', 'movement'],
+    },
     rawData: {
       emg: [Number],
       accelerometer: {
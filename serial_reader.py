@@ -15,6 +15,7 @@ from datetime import datetime
 SERIAL_PORT = '/dev/ttyUSB0'  # Change to your ESP32 serial port
 BAUD_RATE = 115200
 API_URL = 'http://localhost:3000/api/tremor'  # Next.js API endpoint
+SQI_GATE = 0.5  # matches the firmware's signal quality gate
 
 def read_serial_data():
     """Read and parse classification data from ESP32"""
@@ -26,6 +27,14 @@ def read_serial_data():
             if ser.in_waiting > 0:
                 line = ser.readline().decode('utf-8').strip()
 
+                # Windows unlike anything in the device's calibration
+                if line.startswith("ANOMALY:"):
+                    parts = line.split(":")[1].split(",")
+                    if len(parts) >= 3:
+                        print(f"⚠️  Anomalous signal: score {float(parts[0]):.1f} over "
+                              f"{parts[1]} window(s), classified {parts[2]}")
+                    continue
+
                 # Check for classification data
                 if line.startswith("CLASSIFICATION:"):
                     parts = line.split(":")[1].split(",")
@@ -34,6 +43,15 @@ def read_serial_data():
                         frequency = float(parts[1])
                         amplitude = float(parts[2])
                         rms = float(parts[3])
+                        # Optional 5th field: signal quality index (0-1)
+                        sqi = float(parts[4]) if len(parts) >= 5 else 1.0
+                        # Optional 6th field: motor context of the window
+                        context = parts[5].strip() if len(parts) >= 6 else "UNKNOWN"
+
+                        # Windows from a poor contact are not stored
+                        if classification == "POOR_SIGNAL" or sqi < SQI_GATE:
+                            print(f"⚠️  Poor signal (SQI {sqi:.2f}), not sent")
+                            continue
 
                         # Prepare data for API
                         data = {
@@ -44,6 +62,8 @@ def read_serial_data():
                             "amplitude": amplitude,
                             "rms": rms,
                             "classification": classification,
+                            "signalQuality": sqi,
+                            "context": context,
                             "firmwareVersion": "3.1.0"
                         }
 
@@ -0,0 +1,118 @@
+/*
+  Anomaly Score
+  Calibration statistics, Cholesky factor and the per-window distance.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "anomaly.h"
+#include "reliable_link.h"
+#include "telemetry.h"
+
+// Packed lower-triangle index, column at or before the row
+static inline int packed(int row, int column) {
+  return row * (row + 1) / 2 + column;
+}
+
+void AnomalyDetector::startCalibration(uint16_t windows) {
+  target = windows;
+  count = 0;
+  memset(mean, 0, sizeof(mean));
+  memset(scatter, 0, sizeof(scatter));
+}
+
+bool AnomalyDetector::calibrate(const float* vector) {
+  if (!calibrating()) return false;
+
+  // Welford: running mean and co-moments, stable in single precision
+  float delta[ANOMALY_FEATURES];
+  count++;
+  for (int i = 0; i < ANOMALY_FEATURES; i++) {
+    delta[i] = vector[i] - mean[i];
+    mean[i] += delta[i] / count;
+  }
+  for (int i = 0; i < ANOMALY_FEATURES; i++) {
+    for (int j = 0; j <= i; j++) scatter[packed(i, j)] += delta[i] * (vector[j] - mean[j]);
+  }
+  if (count < target) return false;
+  target = 0;
+
+  // Covariance plus ridge, factored in place
+  AnomalyModel next = {};
+  memcpy(next.mean, mean, sizeof(mean));
+  for (int i = 0; i < ANOMALY_FEATURES; i++) {
+    for (int j = 0; j <= i; j++) {
+      float sum = scatter[packed(i, j)] / (count - 1) + (i == j ? ANOMALY_RIDGE : 0);
+      for (int k = 0; k < j; k++) sum -= next.cholesky[packed(i, k)] * next.cholesky[packed(j, k)];
+      if (i == j) {
+        if (!(sum > 0)) return false;  // not positive definite: keep the old model
+        next.cholesky[packed(i, i)] = sqrtf(sum);
+      } else {
+        next.cholesky[packed(i, j)] = sum / next.cholesky[packed(j, j)];
+      }
+    }
+  }
+  for (int i = 0; i < ANOMALY_FEATURES; i++) {
+    next.cholesky[packed(i, i)] = 1 / next.cholesky[packed(i, i)];
+  }
+  next.windows = count;
+  model = next;
+  pending.windows = 0;
+  return true;
+}
+
+float AnomalyDetector::score(const float* vector) const {
+  // Solve L y = x - mean; the distance is |y|^2
+  float y[ANOMALY_FEATURES];
+  float distance = 0;
+  const float* row = model.cholesky;
+  for (int i = 0; i < ANOMALY_FEATURES; i++) {
+    float sum = vector[i] - model.mean[i];
+    for (int j = 0; j < i; j++) sum -= row[j] * y[j];
+    y[i] = sum * row[i];
+    distance += y[i] * y[i];
+    row += i + 1;
+  }
+  return distance;
+}
+
+bool AnomalyDetector::check(const float* vector, uint8_t classification, float threshold,
+                            uint32_t now, AnomalyEvent& event) {
+  if (!ready()) {
+    lastScore = -1;
+    return false;
+  }
+  lastScore = score(vector);
+  if (lastScore >= threshold) {
+    if (pending.windows == 0 || lastScore > pending.score) {
+      pending.score = lastScore;
+      pending.classification = classification;
+      memcpy(pending.vector, vector, sizeof(pending.vector));
+    }
+    pending.windows++;
+  }
+
+  // The first anomaly after a quiet interval goes out at once
+  if (pending.windows == 0) return false;
+  if (reported && now - lastEvent < ANOMALY_EVENT_INTERVAL_MS) return false;
+  event = pending;
+  pending.windows = 0;
+  lastEvent = now;
+  reported = true;
+  return true;
+}
+
+void sendAnomaly(const AnomalyEvent& event, const char* const* classNames) {
+  static_assert(ANOMALY_FEATURES == 8, "ANOMALY line carries eight values");
+  const float* v = event.vector;
+  reliablePrintf("ANOMALY:%.1f,%u,%s,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\r\n", event.score,
+                 (unsigned)event.windows, classNames[event.classification], v[0], v[1], v[2],
+                 v[3], v[4], v[5], v[6], v[7]);
+}
+
+void sendAnomalyModel(const AnomalyDetector& detector, float threshold) {
+  telemetryPrintf("ANOMALY_MODEL:%u,%u,%u,%.1f,%.1f\r\n", (unsigned)detector.model.windows,
+                  (unsigned)detector.count, (unsigned)detector.target, threshold,
+                  detector.lastScore);
+}
@@ -0,0 +1,146 @@
+/*
+  Flexor/Extensor Coupling
+  Envelope cross-correlation and 3-12 Hz coherence per segment.
+*/
+
+#include <math.h>
+
+#include "antagonist.h"
+#include "telemetry.h"
+
+void AntagonistFeatures::setSampleRate(float fs) {
+  flexorEnvelope.setSampleRate(fs);
+  extensorEnvelope.setSampleRate(fs);
+  decimation = (int)(fs / ANTAGONIST_ENVELOPE_HZ + 0.5f);
+  if (decimation < 1) decimation = 1;
+  envelopeRate = fs / decimation;
+  reset();
+}
+
+void AntagonistFeatures::reset() {
+  flexorEnvelope.reset();
+  extensorEnvelope.reset();
+  phase = 0;
+  count = 0;
+  pending = false;
+  segments = 0;
+  for (int k = 0; k <= ANTAGONIST_FFT_SIZE / 2; k++) {
+    autoFlexor[k] = autoExtensor[k] = crossRe[k] = crossIm[k] = 0;
+  }
+}
+
+// Remove the mean; returns the remaining energy
+static float detrend(float* x, int n) {
+  float mean = 0;
+  for (int i = 0; i < n; i++) mean += x[i];
+  mean /= n;
+  float energy = 0;
+  for (int i = 0; i < n; i++) {
+    x[i] -= mean;
+    energy += x[i] * x[i];
+  }
+  return energy;
+}
+
+bool AntagonistFeatures::analyze(AntagonistResult& result) {
+  if (!pending) return false;
+  const int n = ANTAGONIST_FFT_SIZE;
+  float* x = flexor[filling ^ 1];
+  float* y = extensor[filling ^ 1];
+
+  float energyX = detrend(x, n);
+  float energyY = detrend(y, n);
+  float norm = energyX > 0 && energyY > 0 ? 1 / sqrtf(energyX * energyY) : 0;
+
+  // Cross-correlation over +/- half the longest tremor period
+  int maxLag = (int)(envelopeRate / (2 * ANTAGONIST_BAND_LOW_HZ) + 0.5f);
+  if (maxLag > ANTAGONIST_MAX_LAG) maxLag = ANTAGONIST_MAX_LAG;
+  result.correlationPeak = 0;
+  result.peakLagMs = 0;
+  for (int lag = -maxLag; lag <= maxLag; lag++) {
+    float sum = 0;
+    int from = lag < 0 ? -lag : 0, to = lag > 0 ? n - lag : n;
+    for (int i = from; i < to; i++) sum += x[i] * y[i + lag];
+    float r = sum * norm;
+    if (lag == 0) result.correlationZero = r;
+    if (fabsf(r) > fabsf(result.correlationPeak)) {
+      result.correlationPeak = r;
+      result.peakLagMs = 1000.0f * lag / envelopeRate;
+    }
+  }
+
+  // One transform for both channels; the segment buffers are reused in place
+  for (int i = 0; i < n; i++) {
+    float w = fft.hann(i);
+    x[i] *= w;
+    y[i] *= w;
+  }
+  fft.transform(x, y);
+
+  // Running mean over the first ANTAGONIST_AVERAGES segments, then exponential
+  if (segments < ANTAGONIST_AVERAGES) segments++;
+  float weight = 1.0f / segments;
+  float binHz = envelopeRate / n;
+  int first = (int)ceilf(ANTAGONIST_BAND_LOW_HZ / binHz);
+  int last = (int)(ANTAGONIST_BAND_HIGH_HZ / binHz);
+  if (last > n / 2) last = n / 2;
+
+  float sum = 0;
+  int bins = 0;
+  result.peakCoherence = 0;
+  result.peakHz = 0;
+  result.phaseDeg = 0;
+  for (int k = first; k <= last; k++) {
+    float fx[2], fy[2];
+    splitRealPair(x, y, n, k, fx, fy);
+    // Cross spectrum X conj(Y): positive phase when the extensor lags
+    float sxx = fx[0] * fx[0] + fx[1] * fx[1];
+    float syy = fy[0] * fy[0] + fy[1] * fy[1];
+    float sxyRe = fx[0] * fy[0] + fx[1] * fy[1];
+    float sxyIm = fx[1] * fy[0] - fx[0] * fy[1];
+    autoFlexor[k] += weight * (sxx - autoFlexor[k]);
+    autoExtensor[k] += weight * (syy - autoExtensor[k]);
+    crossRe[k] += weight * (sxyRe - crossRe[k]);
+    crossIm[k] += weight * (sxyIm - crossIm[k]);
+
+    float denominator = autoFlexor[k] * autoExtensor[k];
+    float coherence = denominator > 0
+                    ? (crossRe[k] * crossRe[k] + crossIm[k] * crossIm[k]) / denominator : 0;
+    sum += coherence;
+    bins++;
+    if (coherence > result.peakCoherence) {
+      result.peakCoherence = coherence;
+      result.peakHz = k * binHz;
+      result.phaseDeg = atan2f(crossIm[k], crossRe[k]) * (180.0f / (float)M_PI);
+    }
+  }
+  result.coherence = bins > 0 ? sum / bins : 0;
+
+  // A single segment is trivially coherent; wait for a real average
+  float phaseMagnitude = fabsf(result.phaseDeg);
+  if (segments < ANTAGONIST_MIN_SEGMENTS) result.pattern = PATTERN_UNKNOWN;
+  else if (result.peakCoherence < ANTAGONIST_COHERENCE_MIN) result.pattern = PATTERN_UNCOUPLED;
+  else if (phaseMagnitude > 120) result.pattern = PATTERN_ALTERNATING;
+  else if (phaseMagnitude < 60) result.pattern = PATTERN_CO_CONTRACTION;
+  else result.pattern = PATTERN_MIXED;
+  pending = false;
+  return true;
+}
+
+const char* tremorPatternName(TremorPattern pattern) {
+  switch (pattern) {
+    case PATTERN_UNKNOWN: return "UNKNOWN";
+    case PATTERN_UNCOUPLED: return "UNCOUPLED";
+    case PATTERN_ALTERNATING: return "ALTERNATING";
+    case PATTERN_CO_CONTRACTION: return "CO_CONTRACTION";
+    case PATTERN_MIXED: return "MIXED";
+  }
+  return "UNKNOWN";
+}
+
+void sendAntagonist(const AntagonistResult& result) {
+  telemetryPrintf("ANTAGONIST:%.2f,%.2f,%.0f,%.2f,%.2f,%.2f,%.0f,%s\r\n",
+                  result.correlationZero, result.correlationPeak, result.peakLagMs,
+                  result.coherence, result.peakCoherence, result.peakHz, result.phaseDeg,
+                  tremorPatternName(result.pattern));
+}
@@ -0,0 +1,275 @@
+/*
+  On-target Benchmarks
+  Measures the per-stage cycle costs used by the cycle budget model.
+*/
+
+#ifdef BENCHMARK_MODE
+
+#include <Arduino.h>
+
+#include "anomaly.h"
+#include "antagonist.h"
+#include "benchmark.h"
+#include "cycle_budget.h"
+#include "eog.h"
+#include "telemetry.h"
+#include "tremor.h"
+
+#define BENCH_EMG_PIN 34
+#define BENCH_ITERATIONS 1000
+#define BENCH_WINDOW BATCH_SIZE
+
+// Synthetic EOG scenario: onsets in samples at 200 Hz
+#define BENCH_EOG_SAMPLES 800
+#define BENCH_SACCADE_AT 200  // 100 mV rightward saccade over 40 ms
+#define BENCH_UPWARD_AT 350   // 80 mV upward saccade over 50 ms
+#define BENCH_BLINK_AT 550    // 300 mV, 300 ms blink
+
+static float benchBuffer[BENCH_WINDOW];
+static float fftRe[ANTAGONIST_FFT_SIZE], fftIm[ANTAGONIST_FFT_SIZE];
+static volatile float benchSink;
+
+static void drainTelemetry() {
+  while (telemetryPending() > 0) {
+    telemetryFlush();
+  }
+  Serial.flush();
+}
+
+// Average cycles per call of fn over BENCH_ITERATIONS runs
+template <typename Fn>
+static uint32_t measureCycles(Fn fn, int iterations = BENCH_ITERATIONS) {
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < iterations; i++) {
+    fn();
+  }
+  return (ESP.getCycleCount() - start) / iterations;
+}
+
+// Raised-cosine step from 0 to 1 over duration samples
+static float easedStep(int i, int start, int duration) {
+  if (i < start) return 0;
+  if (i >= start + duration) return 1;
+  return 0.5f * (1 - cosf(PI * (i - start) / duration));
+}
+
+// Runs the EOG processor over a scripted saccade/blink sequence and
+// reports detection latency against the true onsets; returns the
+// average cycles per processed sample
+static uint32_t benchmarkEog() {
+  EogProcessor processor;
+  processor.begin(2);
+  EogFrame frame;
+  EogEventRecord event;
+  uint32_t cycles = 0;
+  int saccadeAt = -1, upwardAt = -1, blinkAt = -1;
+
+  for (int i = 0; i < BENCH_EOG_SAMPLES; i++) {
+    // Small deterministic fixation jitter so the noise floor is realistic
+    float jitter = 0.0003f * sinf(i * 2.3f) + 0.0002f * sinf(i * 5.9f);
+    float blink = (i >= BENCH_BLINK_AT && i < BENCH_BLINK_AT + 60)
+                ? 0.15f * (1 - cosf(2 * PI * (i - BENCH_BLINK_AT) / 60)) : 0;
+    float volts[2] = {
+      1.6f + jitter + 0.1f * easedStep(i, BENCH_SACCADE_AT, 8),
+      1.6f - jitter + 0.08f * easedStep(i, BENCH_UPWARD_AT, 10) + blink,
+    };
+
+    uint32_t start = ESP.getCycleCount();
+    processor.push(volts, i * 1000 / SAMPLE_RATE, frame);
+    cycles += ESP.getCycleCount() - start;
+
+    if (processor.takeEvent(event)) {
+      if (event.type == EOG_SACCADE_ONSET && i >= BENCH_UPWARD_AT && upwardAt < 0) upwardAt = i;
+      else if (event.type == EOG_SACCADE_ONSET && i >= BENCH_SACCADE_AT && saccadeAt < 0) saccadeAt = i;
+      else if (event.type == EOG_BLINK && blinkAt < 0) blinkAt = i;
+    }
+  }
+
+  const float msPerSample = 1000.0f / SAMPLE_RATE;
+  Serial.println("=== Benchmark: EOG detection latency (onset to event) ===");
+  Serial.printf("Saccade:        %s%.0f ms\n", saccadeAt < 0 ? "MISSED " : "",
+                (saccadeAt - BENCH_SACCADE_AT) * msPerSample);
+  Serial.printf("Upward saccade: %s%.0f ms\n", upwardAt < 0 ? "MISSED " : "",
+                (upwardAt - BENCH_UPWARD_AT) * msPerSample);
+  Serial.printf("Blink:          %s%.0f ms\n", blinkAt < 0 ? "MISSED " : "",
+                (blinkAt - BENCH_BLINK_AT) * msPerSample);
+  Serial.printf("Cycles per sample: %u\n", cycles / BENCH_EOG_SAMPLES);
+  return cycles / BENCH_EOG_SAMPLES;
+}
+
+// 5 Hz tremor bursts, extensor in anti-phase with the flexor; returns the
+// average cycles per analysed segment
+static uint32_t benchmarkAntagonist() {
+  static AntagonistFeatures features;
+  features.reset();
+  AntagonistResult result = {};
+  uint32_t cycles = 0;
+  int analysed = 0;
+
+  for (int i = 0; i < (ANTAGONIST_MIN_SEGMENTS + 1) * ANTAGONIST_FFT_SIZE * features.decimation; i++) {
+    float t = (float)i / SAMPLE_RATE;
+    float burst = sinf(2 * PI * 5.0f * t);
+    float carrier = sinf(2 * PI * 60.0f * t + 0.7f * sinf(i * 1.3f));
+    float flexor = 1.65f + 0.3f * (burst > 0 ? burst : 0) * carrier;
+    float extensor = 1.65f + 0.3f * (burst < 0 ? -burst : 0) * carrier;
+
+    if (features.push(flexor, extensor)) {
+      uint32_t start = ESP.getCycleCount();
+      features.analyze(result);
+      cycles += ESP.getCycleCount() - start;
+      analysed++;
+    }
+  }
+
+  Serial.println("=== Benchmark: flexor/extensor coupling (anti-phase 5 Hz) ===");
+  Serial.printf("Pattern: %s, r0 %.2f, coherence %.2f at %.1f Hz, phase %.0f deg\n",
+                tremorPatternName(result.pattern), result.correlationZero,
+                result.peakCoherence, result.peakHz, result.phaseDeg);
+  return analysed > 0 ? cycles / analysed : 0;
+}
+
+void runBenchmarks() {
+  const cycle_budget::Calibration& def = cycle_budget::DEFAULT_CALIBRATION;
+  Serial.println("=== Benchmark: measuring stage costs ===");
+  Serial.flush();
+
+  for (int i = 0; i < BENCH_WINDOW; i++) {
+    benchBuffer[i] = 1.65f + 0.5f * sinf(2 * PI * 5.0f * i / 200.0f);
+  }
+
+  AdcToVolts<> calibration;
+  uint32_t adc = measureCycles([&] {
+    benchSink = calibration.process(analogRead(BENCH_EMG_PIN));
+  });
+
+  AlphaLowPass lowPass;
+  int filterIndex = 0;
+  uint32_t filter = measureCycles([&] {
+    benchSink = lowPass.process(benchBuffer[filterIndex]);
+    filterIndex = filterIndex + 1 < BENCH_WINDOW ? filterIndex + 1 : 0;
+  });
+
+  AdaptiveLineEnhancer<> enhancer;
+  int enhancerIndex = 0;
+  uint32_t enhance = measureCycles([&] {
+    benchSink = enhancer.process(benchBuffer[enhancerIndex]);
+    enhancerIndex = enhancerIndex + 1 < BENCH_WINDOW ? enhancerIndex + 1 : 0;
+  });
+
+  TremorFeatures accumulators;
+  int benchIndex = 0;
+  uint32_t accumulate = measureCycles([&] {
+    accumulators.push(benchBuffer[benchIndex]);
+    benchIndex = benchIndex + 1 < BENCH_WINDOW ? benchIndex + 1 : 0;
+  });
+  // The enhancer ahead of the frequency features is costed separately
+  accumulate = (accumulate > enhance ? accumulate - enhance : 0) / FEATURE_COUNT;
+
+  float features[FEATURE_COUNT];
+  uint32_t finalize = measureCycles([&] {
+    accumulators.push(benchBuffer[0]);
+    accumulators.finalize(features);
+  }) / FEATURE_COUNT;
+  finalize = finalize > accumulate ? finalize - accumulate : 0;
+  for (int i = 0; i < BENCH_WINDOW; i++) {
+    accumulators.push(benchBuffer[i]);
+  }
+  accumulators.finalize(features);
+
+  uint32_t rules = measureCycles([&] {
+    benchSink = classifyFromFeatures(features);
+  });
+  NaiveBayesClassifier naiveBayes;
+  uint32_t naiveBayesCycles = measureCycles([&] {
+    benchSink = naiveBayes.classify(features);
+  });
+
+  // A full table, searched from the window's own vector
+  static PrototypeTable prototypes;
+  float vector[PROTOTYPE_FEATURES];
+  prototypeVector(features, vector);
+  for (int p = 0; p < PROTOTYPE_CAPACITY; p++) {
+    vector[p % PROTOTYPE_FEATURES] += 0.1f;
+    prototypes.add(vector, p % TREMOR_CLASS_COUNT);
+  }
+  uint8_t labels[PROTOTYPE_K];
+  float distances[PROTOTYPE_K];
+  uint32_t prototypeSearch = measureCycles([&] {
+    benchSink = prototypes.nearest(vector, PROTOTYPE_K, labels, distances);
+  }, 100) / PROTOTYPE_CAPACITY;
+
+  // Calibrated on jittered copies of the window, then scoring it
+  AnomalyDetector anomaly;
+  anomaly.startCalibration(ANOMALY_MIN_WINDOWS);
+  for (int w = 0; w < ANOMALY_MIN_WINDOWS; w++) {
+    vector[w % ANOMALY_FEATURES] += (w % 3 - 1) * 0.2f;
+    anomaly.calibrate(vector);
+  }
+  uint32_t anomalyCycles = measureCycles([&] {
+    prototypeVector(features, vector);
+    benchSink = anomaly.score(vector);
+  });
+
+  static Fft<ANTAGONIST_FFT_SIZE> fft;
+  for (int i = 0; i < ANTAGONIST_FFT_SIZE; i++) {
+    fftRe[i] = benchBuffer[i % BENCH_WINDOW];
+    fftIm[i] = 0;
+  }
+  const uint32_t butterflies = ANTAGONIST_FFT_SIZE / 2 * cycle_budget::log2Floor(ANTAGONIST_FFT_SIZE);
+  uint32_t fftCycles = measureCycles([&] { fft.transform(fftRe, fftIm); }, 20);
+  uint32_t segment = benchmarkAntagonist();
+  uint32_t spectralPoint = segment > fftCycles ? (segment - fftCycles) / ANTAGONIST_FFT_SIZE : 0;
+
+  uint8_t bytes[32];
+  memset(bytes, 'x', sizeof(bytes));
+  Serial.flush();
+  uint32_t txByte = measureCycles([&] {
+    Serial.write(bytes, sizeof(bytes));
+  }, 1) / sizeof(bytes);
+  Serial.println();
+  Serial.flush();
+
+  // Formatting into the telemetry ring; the UART cost is txByteCycles
+  uint32_t textSample = measureCycles([] {
+    telemetryPrintf("%.3f,%.3f\r\n", 1.234f, 1.234f);
+  }, 20);
+  drainTelemetry();
+
+  uint32_t textWindow = measureCycles([&] {
+    printClassification(MILD, features, 1.0f);
+  }, 5);
+  drainTelemetry();
+
+  uint32_t eogFrame = benchmarkEog() * EOG_FRAME_DECIMATION;
+  drainTelemetry();
+
+  unsigned long lastTime = 0;
+  uint32_t overhead = measureCycles([&] {
+    unsigned long now = millis();
+    if (now - lastTime >= 1000) lastTime = now;
+    benchSink = lastTime;
+  });
+
+  Serial.println("=== Benchmark: paste into include/cycle_budget.h ===");
+  Serial.println("constexpr Calibration DEFAULT_CALIBRATION = {");
+  Serial.printf("  %u,  // adcReadCycles\n", adc);
+  Serial.printf("  %u,  // filterCycles\n", filter);
+  Serial.printf("  %u,  // featureSampleCycles\n", accumulate);
+  Serial.printf("  %u,  // featureBatchCycles\n", def.featureBatchCycles);
+  Serial.printf("  %u,  // featureFinalizeCycles\n", finalize);
+  Serial.printf("  %u,  // fftButterflyCycles\n", fftCycles / butterflies);
+  Serial.printf("  %u,  // spectralPointCycles\n", spectralPoint);
+  Serial.printf("  %u,  // adaptiveTapCycles\n", enhance / ALE_TAPS);
+  Serial.printf("  %u,  // busByteCycles (bus-bound, not measured)\n", def.busByteCycles);
+  Serial.printf("  {%u, %u, %u}, // modelCycles\n", rules, eogFrame, naiveBayesCycles);
+  Serial.printf("  %u,  // prototypeCycles\n", prototypeSearch);
+  Serial.printf("  %u,  // anomalyCycles\n", anomalyCycles);
+  Serial.printf("  %u,  // textSampleCycles\n", textSample);
+  Serial.printf("  %u,  // textWindowCycles\n", textWindow);
+  Serial.printf("  %u,  // txByteCycles\n", txByte);
+  Serial.printf("  %u,  // loopOverheadCycles\n", overhead);
+  Serial.println("};");
+  Serial.println("==========================");
+}
+
+#endif  // BENCHMARK_MODE
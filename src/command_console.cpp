@@ -0,0 +1,423 @@
+/*
+  Serial Command Console
+  Incremental line parser and command dispatch.
+*/
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anomaly.h"
+#include "command_console.h"
+#include "config_store.h"
+#include "device_config.h"
+#include "diagnostics.h"
+#include "downsample.h"
+#include "imu.h"
+#include "memory_budget.h"
+#include "ota_update.h"
+#include "reliable_link.h"
+#include "telemetry.h"
+#include "tremor.h"
+
+static const char* ENROLL_LABELS[TREMOR_CLASS_COUNT] = {"normal", "mild", "moderate", "severe"};
+
+static char lineBuffer[CONSOLE_LINE_MAX];
+static int lineLength = 0;
+static bool lineOverflow = false;
+static char lineEnd = '\n';
+
+static uint8_t* payloadBuffer = nullptr;
+static uint16_t payloadLength = 0;
+static uint16_t payloadReceived = 0;
+static PayloadHandler payloadDone = nullptr;
+static uint32_t payloadActivity = 0;
+static bool payloadActive = false;
+
+static bool parseInt(const char* token, long minimum, long maximum, long& value) {
+  if (!token) return false;
+  char* end;
+  value = strtol(token, &end, 10);
+  return *token && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+static bool parseUnsigned(const char* token, int base, uint32_t& value) {
+  if (!token) return false;
+  char* end;
+  unsigned long parsed = strtoul(token, &end, base);
+  value = (uint32_t)parsed;
+  return *token && *token != '-' && *end == '\0' && parsed <= 0xFFFFFFFFUL;
+}
+
+static bool parseFloat(const char* token, float& value) {
+  if (!token) return false;
+  char* end;
+  value = strtof(token, &end);
+  return *token && *end == '\0' && isfinite(value);
+}
+
+static void printConfig() {
+  const DeviceConfig& c = deviceConfig;
+  const char* displayNames[] = {"raw", "minmax", "lttb"};
+  telemetryPrintf("CONFIG:mode=%s,rate=%u,window=%u,display=%s,display_rate=%u\r\n",
+                  c.mode == MODE_EOG ? "eog" : "tremor", (unsigned)c.sampleRate,
+                  (unsigned)c.windowSize, displayNames[c.displayMode], (unsigned)c.displayRate);
+  telemetryPrintf("CONFIG:freq=%.2f/%.2f/%.2f,amp=%.2f/%.2f/%.2f,saccade=%.1f,blink=%.0f\r\n",
+                  c.freqThresholds[0], c.freqThresholds[1], c.freqThresholds[2],
+                  c.ampThresholds[0], c.ampThresholds[1], c.ampThresholds[2],
+                  c.saccadeFactor, c.blinkVelocity);
+  telemetryPrintf("CONFIG:psd_overlap=%u,psd_averages=%u\r\n",
+                  (unsigned)c.psdOverlap, (unsigned)c.psdAverages);
+  telemetryPrintf("CONFIG:posture=%.2f/%.2f/%.2f,movement=%.2f/%.2f/%.2f\r\n",
+                  c.postureFreqThresholds[0], c.postureFreqThresholds[1],
+                  c.postureFreqThresholds[2],
+                  c.movementFreqThresholds[0], c.movementFreqThresholds[1],
+                  c.movementFreqThresholds[2]);
+  telemetryPrintf("CONFIG:anomaly=%.1f\r\n", c.anomalyThreshold);
+}
+
+static void printHelp() {
+  telemetryPrintf("OK commands: mode tremor|eog, rate <hz>, window <n>, "
+                  "thresholds freq|posture|movement|amp <a> <b> <c>, "
+                  "thresholds saccade|blink|anomaly <v>\r\n");
+  telemetryPrintf("OK display raw|minmax|lttb [points/s], psd [overlap%% [averages]]\r\n");
+  telemetryPrintf("OK imu [off|probe|sim [hz [g]]]\r\n");
+  telemetryPrintf("OK enroll [normal|mild|moderate|severe|clear]: last window as a patient "
+                  "prototype\r\n");
+  telemetryPrintf("OK calibrate [windows]: new anomaly baseline from the next windows\r\n");
+  telemetryPrintf("OK queries: config, stats, profiler [reset], quantiles, quality, context, "
+                  "anomaly, memory, log, capture <n>\r\n");
+  telemetryPrintf("OK reliable [on|off]: framed, acknowledged events; ack <next> [sack hex]\r\n");
+  telemetryPrintf("OK ota [begin|block|finish|apply|abort]: firmware update, "
+                  "streamed by ingest_daemon --update\r\n");
+  telemetryPrintf("OK storage: save (settings also save 5 s after the last change), defaults\r\n");
+}
+
+// Three ascending thresholds, or a single positive one
+static bool setThresholds(char** tokens, int count) {
+  const char* kind = count > 1 ? tokens[1] : "";
+  DeviceConfig& c = deviceConfig;
+
+  if (strcmp(kind, "freq") == 0 || strcmp(kind, "posture") == 0 ||
+      strcmp(kind, "movement") == 0 || strcmp(kind, "amp") == 0) {
+    float values[3];
+    if (count != 5) return false;
+    for (int i = 0; i < 3; i++) {
+      if (!parseFloat(tokens[2 + i], values[i]) || values[i] < 0) return false;
+      if (i > 0 && values[i] < values[i - 1]) return false;
+    }
+    float* target = kind[0] == 'f'   ? c.freqThresholds
+                  : kind[0] == 'p' ? c.postureFreqThresholds
+                  : kind[0] == 'm' ? c.movementFreqThresholds
+                                   : c.ampThresholds;
+    memcpy(target, values, sizeof(values));
+  } else if (strcmp(kind, "saccade") == 0 || strcmp(kind, "blink") == 0 ||
+             strcmp(kind, "anomaly") == 0) {
+    float value;
+    if (count != 3 || !parseFloat(tokens[2], value) || value <= 0) return false;
+    if (kind[0] == 's') c.saccadeFactor = value;
+    else if (kind[0] == 'b') c.blinkVelocity = value;
+    else if (value >= 1) c.anomalyThreshold = value;
+    else return false;
+  } else {
+    return false;
+  }
+
+  applyThresholds();
+  deviceLog("thresholds %s changed", kind);
+  return true;
+}
+
+static void dispatch(char** tokens, int count) {
+  const char* command = tokens[0];
+  long value;
+
+  if (strcmp(command, "mode") == 0) {
+    const char* mode = count == 2 ? tokens[1] : "";
+    bool eog = strcmp(mode, "eog") == 0;
+    if (!eog && strcmp(mode, "tremor") != 0) {
+      telemetryPrintf("ERR mode: expected tremor|eog\r\n");
+    } else if (applyMode(eog ? MODE_EOG : MODE_TREMOR)) {
+      telemetryPrintf("OK mode %s\r\n", mode);
+    } else {
+      telemetryPrintf("ERR mode %s: over budget\r\n", mode);
+    }
+  } else if (strcmp(command, "rate") == 0) {
+    if (count != 2 || !parseInt(tokens[1], MIN_SAMPLE_RATE, MAX_SAMPLE_RATE, value)) {
+      telemetryPrintf("ERR rate: expected %d-%d Hz\r\n", MIN_SAMPLE_RATE, MAX_SAMPLE_RATE);
+    } else if (applySampleRate((uint16_t)value)) {
+      telemetryPrintf("OK rate %ld\r\n", value);
+    } else {
+      telemetryPrintf("ERR rate %ld: over budget\r\n", value);
+    }
+  } else if (strcmp(command, "window") == 0) {
+    if (count != 2 || !parseInt(tokens[1], MIN_WINDOW_SIZE, MAX_WINDOW_SIZE, value)) {
+      telemetryPrintf("ERR window: expected %d-%d samples\r\n", MIN_WINDOW_SIZE, MAX_WINDOW_SIZE);
+    } else if (applyWindowSize((uint16_t)value)) {
+      telemetryPrintf("OK window %ld\r\n", value);
+    } else {
+      telemetryPrintf("ERR window %ld: over budget\r\n", value);
+    }
+  } else if (strcmp(command, "thresholds") == 0) {
+    if (setThresholds(tokens, count)) {
+      telemetryPrintf("OK thresholds %s\r\n", tokens[1]);
+    } else {
+      telemetryPrintf("ERR thresholds: expected freq|posture|movement|amp <a> <b> <c> "
+                      "ascending, or saccade|blink|anomaly <value>\r\n");
+    }
+  } else if (strcmp(command, "display") == 0) {
+    const char* name = count >= 2 ? tokens[1] : "";
+    DisplayMode mode = strcmp(name, "lttb") == 0     ? DISPLAY_LTTB
+                     : strcmp(name, "minmax") == 0   ? DISPLAY_MINMAX
+                                                     : DISPLAY_RAW;
+    value = deviceConfig.displayRate;
+    if ((mode == DISPLAY_RAW && strcmp(name, "raw") != 0) || count > 3 ||
+        (count == 3 && !parseInt(tokens[2], 1, MAX_SAMPLE_RATE, value))) {
+      telemetryPrintf("ERR display: expected raw|minmax|lttb [points/s]\r\n");
+    } else if (applyDisplay(mode, (uint16_t)value)) {
+      telemetryPrintf("OK display %s %ld\r\n", name, value);
+    } else {
+      telemetryPrintf("ERR display %s %ld: needs 2-%d samples per bucket\r\n",
+                      name, value, DOWNSAMPLE_MAX_BUCKET);
+    }
+  } else if (strcmp(command, "psd") == 0) {
+    long averages = deviceConfig.psdAverages;
+    if (count == 1) {
+      printPsd();
+    } else if (count > 3 || !parseInt(tokens[1], 0, MAX_PSD_OVERLAP, value) ||
+               (count == 3 && !parseInt(tokens[2], 1, MAX_PSD_AVERAGES, averages))) {
+      telemetryPrintf("ERR psd: expected overlap 0-%d %% [averages 1-%d]\r\n",
+                      MAX_PSD_OVERLAP, MAX_PSD_AVERAGES);
+    } else if (applyPsd((uint8_t)value, (uint8_t)averages)) {
+      telemetryPrintf("OK psd %ld%% %ld\r\n", value, averages);
+    } else {
+      telemetryPrintf("ERR psd %ld%%: over budget\r\n", value);
+    }
+  } else if (strcmp(command, "imu") == 0) {
+    const char* source = count >= 2 ? tokens[1] : "";
+    float hz = IMU_SIM_HZ, g = IMU_SIM_G;
+    if (count == 1) {
+      printImu();
+    } else if (strcmp(source, "off") == 0 && count == 2) {
+      applyImu(IMU_NONE, hz, g);
+      telemetryPrintf("OK imu off\r\n");
+    } else if (strcmp(source, "probe") == 0 && count == 2) {
+      if (applyImu(IMU_MPU6050, hz, g)) telemetryPrintf("OK imu mpu6050\r\n");
+      else telemetryPrintf("ERR imu: no sensor at 0x%02x\r\n", IMU_I2C_ADDRESS);
+    } else if (strcmp(source, "sim") == 0 && count <= 4 &&
+               (count < 3 || (parseFloat(tokens[2], hz) && hz > 0 && hz < IMU_MAX_RATE / 2)) &&
+               (count < 4 || (parseFloat(tokens[3], g) && g >= 0 && g < 2))) {
+      applyImu(IMU_SIMULATED, hz, g);
+      telemetryPrintf("OK imu sim %.2f Hz %.3f g\r\n", hz, g);
+    } else {
+      telemetryPrintf("ERR imu: expected off|probe|sim [hz [g]]\r\n");
+    }
+  } else if (strcmp(command, "capture") == 0) {
+    if (count != 2 || !parseInt(tokens[1], 1, CAPTURE_MAX_SAMPLES, value)) {
+      telemetryPrintf("ERR capture: expected 1-%d samples\r\n", CAPTURE_MAX_SAMPLES);
+    } else if (startCapture((uint16_t)value)) {
+      telemetryPrintf("OK capture %ld\r\n", value);
+    } else if (scratchOwner() == SCRATCH_UPDATE) {
+      telemetryPrintf("ERR capture: memory in use by a firmware update\r\n");
+    } else {
+      telemetryPrintf("ERR capture: already running\r\n");
+    }
+  } else if (strcmp(command, "config") == 0) {
+    printConfig();
+  } else if (strcmp(command, "save") == 0) {
+    configRequestSave();  // taskConfig writes and replies
+  } else if (strcmp(command, "defaults") == 0) {
+    configRequestErase();
+    if (applyConfig(DEFAULT_DEVICE_CONFIG)) telemetryPrintf("OK defaults\r\n");
+    else telemetryPrintf("ERR defaults: partly applied\r\n");
+  } else if (strcmp(command, "stats") == 0) {
+    printStats();
+  } else if (strcmp(command, "profiler") == 0) {
+    if (count == 2 && strcmp(tokens[1], "reset") == 0) {
+      profileReset();
+      telemetryPrintf("OK profiler reset\r\n");
+    } else {
+      printProfiler();
+    }
+  } else if (strcmp(command, "quality") == 0) {
+    printSignalQuality();
+  } else if (strcmp(command, "context") == 0) {
+    printContext();
+  } else if (strcmp(command, "anomaly") == 0) {
+    printAnomaly();
+  } else if (strcmp(command, "calibrate") == 0) {
+    value = ANOMALY_DEFAULT_WINDOWS;
+    if (count > 2 || (count == 2 && !parseInt(tokens[1], ANOMALY_MIN_WINDOWS,
+                                                ANOMALY_MAX_WINDOWS, value))) {
+      telemetryPrintf("ERR calibrate: expected %d-%d windows\r\n", ANOMALY_MIN_WINDOWS,
+                      ANOMALY_MAX_WINDOWS);
+    } else {
+      startAnomalyCalibration((uint16_t)value);
+      telemetryPrintf("OK calibrate %ld\r\n", value);
+    }
+  } else if (strcmp(command, "enroll") == 0) {
+    const char* label = count == 2 ? tokens[1] : "";
+    int tremorClass = 0;
+    while (tremorClass < TREMOR_CLASS_COUNT && strcmp(label, ENROLL_LABELS[tremorClass]) != 0) {
+      tremorClass++;
+    }
+    if (count == 1) {
+      printPrototypes();
+    } else if (strcmp(label, "clear") == 0) {
+      clearPrototypes();
+      telemetryPrintf("OK enroll clear\r\n");
+    } else if (tremorClass == TREMOR_CLASS_COUNT) {
+      telemetryPrintf("ERR enroll: expected normal|mild|moderate|severe|clear\r\n");
+    } else if (enrollPrototype((uint8_t)tremorClass)) {
+      telemetryPrintf("OK enroll %s\r\n", label);
+    } else {
+      telemetryPrintf("ERR enroll: no classified window yet\r\n");
+    }
+  } else if (strcmp(command, "reliable") == 0) {
+    const char* state = count == 2 ? tokens[1] : "";
+    if (count == 1) {
+      sendReliableStats();
+    } else if (strcmp(state, "on") == 0 || strcmp(state, "off") == 0) {
+      reliableEnable(state[1] == 'n');
+      telemetryPrintf("OK reliable %s next=%lu base=%lu\r\n", state,
+                      (unsigned long)reliableNextSequence(), (unsigned long)reliableBase());
+    } else {
+      telemetryPrintf("ERR reliable: expected on|off\r\n");
+    }
+  } else if (strcmp(command, "ack") == 0) {
+    // Silent when valid: acknowledgements arrive several times a second
+    uint32_t next, sack = 0;
+    if (count < 2 || count > 3 || !parseUnsigned(tokens[1], 10, next) ||
+        (count == 3 && !parseUnsigned(tokens[2], 16, sack))) {
+      telemetryPrintf("ERR ack: expected <next> [sack hex]\r\n");
+    } else {
+      reliableAck(next, sack);
+    }
+  } else if (strcmp(command, "ota") == 0) {
+    const char* action = count >= 2 ? tokens[1] : "";
+    bool begin = strcmp(action, "begin") == 0 && count == 4;
+    bool block = strcmp(action, "block") == 0 && count == 5;
+    uint32_t index = 0, length, crc;
+    if (count == 1) {
+      printOta();
+    } else if (begin || block) {
+      int at = block ? 3 : 2;
+      if ((block && !parseUnsigned(tokens[2], 10, index)) ||
+          !parseUnsigned(tokens[at], 10, length) || !parseUnsigned(tokens[at + 1], 16, crc) ||
+          length == 0 || length > OTA_CHUNK_MAX) {
+        telemetryPrintf("ERR ota %s: expected 1-%d payload bytes and a crc\r\n", action,
+                        OTA_CHUNK_MAX);
+      } else {
+        OtaPayload kind = block ? OTA_PAYLOAD_BLOCK : OTA_PAYLOAD_MANIFEST;
+        consoleReadPayload(otaExpect(kind, index, crc), (uint16_t)length, otaPayloadReceived);
+      }
+    } else if (strcmp(action, "finish") == 0 && count == 2) {
+      otaFinish();
+    } else if (strcmp(action, "apply") == 0 && count == 2) {
+      otaApply();
+    } else if (strcmp(action, "abort") == 0 && count == 2) {
+      otaAbort();
+    } else {
+      telemetryPrintf("ERR ota: expected begin <bytes> <crc>|block <i> <bytes> <crc>|finish|"
+                      "apply|abort\r\n");
+    }
+  } else if (strcmp(command, "quantiles") == 0) {
+    printQuantiles();
+  } else if (strcmp(command, "memory") == 0) {
+    printMemory();
+  } else if (strcmp(command, "log") == 0) {
+    printLog();
+  } else if (strcmp(command, "help") == 0) {
+    printHelp();
+  } else {
+    telemetryPrintf("ERR unknown command: %s\r\n", command);
+  }
+}
+
+// Split the line on spaces in place and run it
+static void runLine() {
+  char* tokens[CONSOLE_MAX_TOKENS];
+  int count = 0;
+  char* cursor = lineBuffer;
+
+  while (*cursor) {
+    while (*cursor == ' ' || *cursor == '\t') *cursor++ = '\0';
+    if (!*cursor) break;
+    if (count == CONSOLE_MAX_TOKENS) {
+      telemetryPrintf("ERR too many arguments\r\n");
+      return;
+    }
+    tokens[count++] = cursor;
+    while (*cursor && *cursor != ' ' && *cursor != '\t') cursor++;
+  }
+
+  if (count > 0) dispatch(tokens, count);
+}
+
+void consoleReadPayload(uint8_t* buffer, uint16_t length, PayloadHandler done) {
+  payloadBuffer = buffer;
+  payloadLength = length;
+  payloadReceived = 0;
+  payloadDone = done;
+  payloadActivity = millis();
+  payloadActive = true;
+}
+
+// Payload bytes straight from the UART; the line parser waits meanwhile
+static void readPayload() {
+  uint32_t now = millis();
+  for (int budget = CONSOLE_PAYLOAD_PER_POLL; budget > 0 && Serial.available() > 0; budget--) {
+    int c = Serial.read();
+    if (c < 0) break;
+    // The '\n' of a "\r\n" ending is not payload
+    if (payloadReceived == 0 && lineEnd == '\r' && c == '\n') {
+      lineEnd = '\n';
+      continue;
+    }
+    lineEnd = '\n';
+    if (payloadBuffer) payloadBuffer[payloadReceived] = (uint8_t)c;
+    payloadActivity = now;
+    if (++payloadReceived == payloadLength) {
+      payloadActive = false;
+      if (payloadDone) payloadDone(payloadLength, true);
+      return;
+    }
+  }
+  if (now - payloadActivity >= CONSOLE_PAYLOAD_TIMEOUT_MS) {
+    payloadActive = false;
+    telemetryPrintf("ERR payload: %u of %u bytes arrived\r\n", (unsigned)payloadReceived,
+                    (unsigned)payloadLength);
+    if (payloadDone) payloadDone(payloadReceived, false);
+  }
+}
+
+void consolePoll() {
+  if (payloadActive) {
+    readPayload();
+    return;
+  }
+  for (int budget = CONSOLE_BYTES_PER_POLL; budget > 0 && Serial.available() > 0; budget--) {
+    int c = Serial.read();
+    if (c < 0) return;
+
+    if (c == '\n' || c == '\r') {
+      lineEnd = (char)c;
+      if (lineOverflow) {
+        telemetryPrintf("ERR line longer than %d bytes\r\n", CONSOLE_LINE_MAX - 1);
+      } else if (lineLength > 0) {
+        lineBuffer[lineLength] = '\0';
+        runLine();
+      }
+      lineLength = 0;
+      lineOverflow = false;
+      // One command per poll keeps the reply work bounded too
+      return;
+    }
+
+    if (lineLength < CONSOLE_LINE_MAX - 1) {
+      lineBuffer[lineLength++] = (char)c;
+    } else {
+      lineOverflow = true;
+    }
+  }
+}
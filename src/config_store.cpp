@@ -0,0 +1,321 @@
+/*
+  Persistent Configuration Store
+  NVS-backed DeviceConfig, patient prototypes, anomaly calibration and
+  update progress with versioning, CRC and coalesced writes.
+*/
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+#include <string.h>
+
+#include "config_store.h"
+#include "diagnostics.h"
+#include "memory_budget.h"
+#include "telemetry.h"
+#include "tremor.h"
+
+#define CONFIG_RECORD_MAX (sizeof(ConfigRecordHeader) + sizeof(DeviceConfig) + sizeof(uint32_t))
+#define PROTOTYPE_RECORD_MAX \
+  (sizeof(ConfigRecordHeader) + sizeof(PrototypeTable) + sizeof(uint32_t))
+#define PROTOTYPE_KEY "prototypes"  // one table for both builds: only the tremor pipeline has one
+#define ANOMALY_RECORD_MAX (sizeof(ConfigRecordHeader) + sizeof(AnomalyModel) + sizeof(uint32_t))
+#define ANOMALY_KEY "anomaly"
+#define OTA_PROGRESS_RECORD_MAX \
+  (sizeof(ConfigRecordHeader) + sizeof(OtaProgress) + sizeof(uint32_t))
+#define OTA_PROGRESS_KEY "ota"
+
+static Preferences preferences;
+static bool opened = false;
+static bool dirty = false;
+static uint32_t lastChange = 0;
+static bool saveRequested = false;
+static bool eraseRequested = false;
+static uint32_t savedCrc = 0;  // payload CRC of what NVS holds
+static bool prototypesDirty = false;
+static uint32_t prototypesChange = 0;
+static bool anomalyDirty = false;
+static uint32_t anomalyChange = 0;
+
+static const char* configKey() {
+  return DEFAULT_MODE == MODE_EOG ? "cfg-eog" : "cfg-tremor";
+}
+
+static bool openStore() {
+  if (!opened) opened = preferences.begin(CONFIG_NAMESPACE, false);
+  return opened;
+}
+
+// Bitwise CRC-32 (IEEE); only runs at boot, on save and per update block
+uint32_t crc32(const uint8_t* data, uint32_t length, uint32_t crc) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static bool inRange(float value, float minimum, float maximum) {
+  return isfinite(value) && value >= minimum && value <= maximum;
+}
+
+static bool configValid(const DeviceConfig& c) {
+  if (c.mode != MODE_TREMOR && c.mode != MODE_EOG) return false;
+  if (c.sampleRate < MIN_SAMPLE_RATE || c.sampleRate > MAX_SAMPLE_RATE) return false;
+  if (c.windowSize < MIN_WINDOW_SIZE || c.windowSize > MAX_WINDOW_SIZE) return false;
+  for (int i = 0; i < 3; i++) {
+    if (!inRange(c.freqThresholds[i], 0, MAX_SAMPLE_RATE)) return false;
+    if (!inRange(c.ampThresholds[i], 0, 1e6f)) return false;
+    if (!inRange(c.postureFreqThresholds[i], 0, MAX_SAMPLE_RATE)) return false;
+    if (!inRange(c.movementFreqThresholds[i], 0, MAX_SAMPLE_RATE)) return false;
+  }
+  if (!inRange(c.anomalyThreshold, 1, 1e6f)) return false;
+  if (c.displayMode > DISPLAY_LTTB || c.displayRate < 1 || c.displayRate > MAX_SAMPLE_RATE) return false;
+  if (c.psdOverlap > MAX_PSD_OVERLAP || c.psdAverages < 1 || c.psdAverages > MAX_PSD_AVERAGES) return false;
+  return inRange(c.saccadeFactor, 0.1f, 1000) && inRange(c.blinkVelocity, 1, 1e6f);
+}
+
+// Stored record under key, checked for magic, version, size and CRC;
+// CONFIG_LOADED leaves it in record with its header
+static ConfigLoadStatus readRecord(const char* key, uint32_t magic, uint16_t version,
+                                   uint8_t* record, size_t capacity, ConfigRecordHeader& header) {
+  if (!openStore()) return CONFIG_DEFAULTS;
+
+  size_t length = preferences.getBytesLength(key);
+  if (length == 0) return CONFIG_DEFAULTS;
+  if (length < sizeof(ConfigRecordHeader) + sizeof(uint32_t) || length > capacity) {
+    return CONFIG_INVALID;
+  }
+  preferences.getBytes(key, record, length);
+
+  memcpy(&header, record, sizeof(header));
+  uint32_t storedCrc;
+  memcpy(&storedCrc, record + length - sizeof(storedCrc), sizeof(storedCrc));
+  if (header.magic != magic || header.version > version ||
+      sizeof(header) + header.payloadSize + sizeof(storedCrc) != length ||
+      crc32(record, length - sizeof(storedCrc)) != storedCrc) {
+    return CONFIG_INVALID;
+  }
+  return CONFIG_LOADED;
+}
+
+// Header, payload and CRC assembled in record and written under key
+static bool writeRecord(const char* key, uint32_t magic, uint16_t version, const void* payload,
+                        uint16_t size, uint8_t* record) {
+  if (!openStore()) return false;
+
+  ConfigRecordHeader header = {magic, version, size};
+  memcpy(record, &header, sizeof(header));
+  memcpy(record + sizeof(header), payload, size);
+  uint32_t length = sizeof(header) + size;
+  uint32_t crc = crc32(record, length);
+  memcpy(record + length, &crc, sizeof(crc));
+  length += sizeof(crc);
+  // NVS allocates while it writes; saves are coalesced and rare
+  memoryExemptBegin();
+  bool written = preferences.putBytes(key, record, length) == length;
+  memoryExemptEnd();
+  return written;
+}
+
+ConfigLoadStatus configLoad(DeviceConfig& config) {
+  uint8_t record[CONFIG_RECORD_MAX];
+  ConfigRecordHeader header;
+  ConfigLoadStatus status =
+      readRecord(configKey(), CONFIG_MAGIC, CONFIG_VERSION, record, sizeof(record), header);
+  if (status != CONFIG_LOADED) return status;
+
+  // Older versions hold a prefix of today's fields; the rest keep defaults
+  DeviceConfig loaded = config;
+  size_t copied = header.payloadSize < sizeof(loaded) ? header.payloadSize : sizeof(loaded);
+  memcpy(&loaded, record + sizeof(header), copied);
+  if (!configValid(loaded)) return CONFIG_INVALID;
+
+  config = loaded;
+  savedCrc = crc32((const uint8_t*)&config, sizeof(config));
+  return header.version == CONFIG_VERSION ? CONFIG_LOADED : CONFIG_MIGRATED;
+}
+
+void configMarkDirty(uint32_t now) {
+  dirty = true;
+  lastChange = now;
+}
+
+static bool configSave() {
+  dirty = false;
+  uint32_t payloadCrc = crc32((const uint8_t*)&deviceConfig, sizeof(deviceConfig));
+  if (payloadCrc == savedCrc) return true;  // changed back, or already stored
+
+  uint8_t record[CONFIG_RECORD_MAX];
+  uint32_t start = millis();
+  if (!writeRecord(configKey(), CONFIG_MAGIC, CONFIG_VERSION, &deviceConfig, sizeof(deviceConfig),
+                   record)) {
+    deviceLog("config save failed");
+    return false;
+  }
+  savedCrc = payloadCrc;
+  deviceLog("config saved in %lu ms", (unsigned long)(millis() - start));
+  return true;
+}
+
+static void configErase() {
+  if (openStore()) preferences.remove(configKey());
+  dirty = false;
+  savedCrc = 0;
+  deviceLog("config erased");
+}
+
+void configRequestSave() {
+  saveRequested = true;
+}
+
+void configRequestErase() {
+  eraseRequested = true;
+  saveRequested = false;
+}
+
+void configService(uint32_t now) {
+  if (eraseRequested) {
+    eraseRequested = false;
+    configErase();
+  }
+  if (saveRequested) {
+    saveRequested = false;
+    if (configSave()) telemetryPrintf("OK saved\r\n");
+    else telemetryPrintf("ERR save failed\r\n");
+    return;
+  }
+  if (!dirty || now - lastChange < CONFIG_SAVE_DELAY_MS) return;
+  configSave();
+}
+
+static bool prototypesValid(const PrototypeTable& table) {
+  if (table.count > PROTOTYPE_CAPACITY || table.next >= PROTOTYPE_CAPACITY) return false;
+  for (int p = 0; p < table.count; p++) {
+    if (table.entries[p].label >= TREMOR_CLASS_COUNT) return false;
+    for (int i = 0; i < PROTOTYPE_FEATURES; i++) {
+      if (!isfinite(table.entries[p].vector[i])) return false;
+    }
+  }
+  return true;
+}
+
+ConfigLoadStatus prototypesLoad(PrototypeTable& table) {
+  uint8_t record[PROTOTYPE_RECORD_MAX];
+  ConfigRecordHeader header;
+  ConfigLoadStatus status = readRecord(PROTOTYPE_KEY, PROTOTYPE_MAGIC, PROTOTYPE_VERSION, record,
+                                       sizeof(record), header);
+  if (status != CONFIG_LOADED) return status;
+  if (header.payloadSize != sizeof(PrototypeTable)) return CONFIG_INVALID;
+
+  PrototypeTable loaded;
+  memcpy(&loaded, record + sizeof(header), sizeof(loaded));
+  if (!prototypesValid(loaded)) return CONFIG_INVALID;
+  table = loaded;
+  return CONFIG_LOADED;
+}
+
+void prototypesMarkDirty(uint32_t now) {
+  prototypesDirty = true;
+  prototypesChange = now;
+}
+
+void prototypesService(const PrototypeTable& table, uint32_t now) {
+  if (!prototypesDirty || now - prototypesChange < CONFIG_SAVE_DELAY_MS) return;
+  prototypesDirty = false;
+
+  uint8_t record[PROTOTYPE_RECORD_MAX];
+  if (!writeRecord(PROTOTYPE_KEY, PROTOTYPE_MAGIC, PROTOTYPE_VERSION, &table, sizeof(table),
+                   record)) {
+    deviceLog("prototype save failed");
+    return;
+  }
+  deviceLog("%d prototypes saved", table.count);
+}
+
+static bool anomalyModelValid(const AnomalyModel& model) {
+  if (model.windows < ANOMALY_MIN_WINDOWS) return false;
+  for (int i = 0; i < ANOMALY_FEATURES; i++) {
+    if (!isfinite(model.mean[i])) return false;
+  }
+  for (int i = 0; i < ANOMALY_TRIANGLE; i++) {
+    if (!isfinite(model.cholesky[i])) return false;
+  }
+  return true;
+}
+
+ConfigLoadStatus anomalyModelLoad(AnomalyModel& model) {
+  uint8_t record[ANOMALY_RECORD_MAX];
+  ConfigRecordHeader header;
+  ConfigLoadStatus status =
+      readRecord(ANOMALY_KEY, ANOMALY_MAGIC, ANOMALY_VERSION, record, sizeof(record), header);
+  if (status != CONFIG_LOADED) return status;
+  if (header.payloadSize != sizeof(AnomalyModel)) return CONFIG_INVALID;
+
+  AnomalyModel loaded;
+  memcpy(&loaded, record + sizeof(header), sizeof(loaded));
+  if (!anomalyModelValid(loaded)) return CONFIG_INVALID;
+  model = loaded;
+  return CONFIG_LOADED;
+}
+
+void anomalyModelMarkDirty(uint32_t now) {
+  anomalyDirty = true;
+  anomalyChange = now;
+}
+
+void anomalyModelService(const AnomalyModel& model, uint32_t now) {
+  if (!anomalyDirty || now - anomalyChange < CONFIG_SAVE_DELAY_MS) return;
+  anomalyDirty = false;
+
+  uint8_t record[ANOMALY_RECORD_MAX];
+  if (!writeRecord(ANOMALY_KEY, ANOMALY_MAGIC, ANOMALY_VERSION, &model, sizeof(model), record)) {
+    deviceLog("anomaly model save failed");
+    return;
+  }
+  deviceLog("anomaly model saved");
+}
+
+ConfigLoadStatus otaProgressLoad(OtaProgress& progress) {
+  uint8_t record[OTA_PROGRESS_RECORD_MAX];
+  ConfigRecordHeader header;
+  ConfigLoadStatus status = readRecord(OTA_PROGRESS_KEY, OTA_PROGRESS_MAGIC, OTA_PROGRESS_VERSION,
+                                       record, sizeof(record), header);
+  if (status != CONFIG_LOADED) return status;
+  if (header.payloadSize != sizeof(OtaProgress)) return CONFIG_INVALID;
+
+  OtaProgress loaded;
+  memcpy(&loaded, record + sizeof(header), sizeof(loaded));
+  if (loaded.phase > OTA_PHASE_ROLLED_BACK || loaded.nextBlock > loaded.blockCount) {
+    return CONFIG_INVALID;
+  }
+  progress = loaded;
+  return CONFIG_LOADED;
+}
+
+bool otaProgressSave(const OtaProgress& progress) {
+  uint8_t record[OTA_PROGRESS_RECORD_MAX];
+  if (!writeRecord(OTA_PROGRESS_KEY, OTA_PROGRESS_MAGIC, OTA_PROGRESS_VERSION, &progress,
+                   sizeof(progress), record)) {
+    deviceLog("update progress save failed");
+    return false;
+  }
+  return true;
+}
+
+void otaProgressErase() {
+  if (openStore()) preferences.remove(OTA_PROGRESS_KEY);
+}
+
+const char* configStatusName(ConfigLoadStatus status) {
+  switch (status) {
+    case CONFIG_LOADED: return "loaded";
+    case CONFIG_MIGRATED: return "migrated";
+    case CONFIG_DEFAULTS: return "defaults";
+    case CONFIG_INVALID: return "invalid";
+  }
+  return "unknown";
+}
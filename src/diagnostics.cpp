@@ -0,0 +1,217 @@
+/*
+  Runtime Diagnostics
+  Profiler, capture buffer and log ring behind the serial console.
+*/
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include "device_config.h"
+#include "diagnostics.h"
+#include "memory_budget.h"
+#include "scheduler.h"
+#include "telemetry.h"
+
+#define CAPTURE_SAMPLES_PER_LINE 16
+
+RuntimeStats runtimeStats = {0, 0, 0, 0, 0, 0};
+
+static CycleHistogram sampleHistogram;
+static uint32_t sampleMaxCycles = 0;
+static uint32_t lastRollover = 0;
+static uint32_t lastRolloverSamples = 0;
+static uint64_t lastRolloverBusy = 0;
+
+enum CaptureState : uint8_t { CAPTURE_IDLE, CAPTURE_RECORDING, CAPTURE_DUMPING };
+static uint16_t* captureBuffer = nullptr;  // the scratch arena while capturing
+static uint16_t captureLength = 0;
+static uint16_t captureIndex = 0;
+static CaptureState captureState = CAPTURE_IDLE;
+
+static char logRing[LOG_ENTRIES][LOG_LINE_MAX];
+static uint32_t logTimes[LOG_ENTRIES];
+static uint32_t logCount = 0;
+
+static_assert(CAPTURE_MAX_SAMPLES * sizeof(uint16_t) <= MEMORY_SCRATCH_BYTES,
+              "capture does not fit the scratch arena");
+constexpr MemoryRegion diagnosticsMemory = {
+    "diagnostics", sizeof(sampleHistogram) + sizeof(logRing) + sizeof(logTimes),
+    MEMORY_BUDGET_DIAGNOSTICS};
+static_assert(diagnosticsMemory.bytes <= diagnosticsMemory.budget,
+              "diagnostics exceed their memory budget");
+
+// Bucket index: exact below 4, then 4 linear steps per power of two
+static int bucketOf(uint32_t cycles) {
+  if (cycles < 4) return cycles;
+  int exponent = 31 - __builtin_clz(cycles);
+  int bucket = (exponent - 1) * 4 + ((cycles >> (exponent - 2)) & 3);
+  return bucket < PROFILE_HISTOGRAM_BUCKETS ? bucket : PROFILE_HISTOGRAM_BUCKETS - 1;
+}
+
+static uint32_t bucketUpperBound(int bucket) {
+  if (bucket < 4) return bucket;
+  int exponent = bucket / 4 + 1;
+  uint32_t step = 1u << (exponent - 2);
+  return ((4u + bucket % 4) << (exponent - 2)) + step - 1;
+}
+
+void CycleHistogram::record(uint32_t cycles) {
+  buckets[bucketOf(cycles)]++;
+  count++;
+}
+
+uint32_t CycleHistogram::quantile(float q) const {
+  if (count == 0) return 0;
+  uint32_t rank = (uint32_t)(q * (count - 1)) + 1;
+  uint32_t seen = 0;
+  for (int b = 0; b < PROFILE_HISTOGRAM_BUCKETS; b++) {
+    seen += buckets[b];
+    if (seen >= rank) return bucketUpperBound(b);
+  }
+  return bucketUpperBound(PROFILE_HISTOGRAM_BUCKETS - 1);
+}
+
+void CycleHistogram::clear() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+}
+
+void profileSample(uint32_t start) {
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sampleHistogram.record(cycles);
+  if (cycles > sampleMaxCycles) sampleMaxCycles = cycles;
+}
+
+void profileReset() {
+  sampleHistogram.clear();
+  sampleMaxCycles = 0;
+  schedulerResetStats();
+}
+
+void rolloverStats(uint32_t now) {
+  uint32_t elapsedUs = now - lastRollover;
+  uint64_t busy = schedulerBusyCycles();
+  if (lastRollover != 0 && elapsedUs > 0) {
+    runtimeStats.samplesPerSecond =
+        (uint32_t)((uint64_t)(runtimeStats.samples - lastRolloverSamples) * 1000000 / elapsedUs);
+    runtimeStats.cpuLoad = (float)(busy - lastRolloverBusy) / ((float)elapsedUs * ESP.getCpuFreqMHz());
+  }
+  lastRollover = now;
+  lastRolloverSamples = runtimeStats.samples;
+  lastRolloverBusy = busy;
+}
+
+bool startCapture(uint16_t samples) {
+  if (captureState != CAPTURE_IDLE || samples == 0 || samples > CAPTURE_MAX_SAMPLES) {
+    return false;
+  }
+  captureBuffer = (uint16_t*)scratchAcquire(SCRATCH_CAPTURE);
+  if (!captureBuffer) return false;  // a firmware update holds it
+  captureLength = samples;
+  captureIndex = 0;
+  captureState = CAPTURE_RECORDING;
+  return true;
+}
+
+void captureSample(uint16_t raw) {
+  if (captureState != CAPTURE_RECORDING) return;
+  captureBuffer[captureIndex++] = raw;
+  if (captureIndex >= captureLength) {
+    captureIndex = 0;
+    captureState = CAPTURE_DUMPING;
+    telemetryPrintf("CAPTURE:BEGIN,%u,%u\r\n", (unsigned)captureLength,
+                    (unsigned)deviceConfig.sampleRate);
+  }
+}
+
+// Queue a few lines at a time, and only while the ring has room, so a
+// long dump neither drops lines nor delays the next sample
+void serviceCapture() {
+  if (captureState != CAPTURE_DUMPING) return;
+
+  for (int line = 0; line < CAPTURE_LINES_PER_SERVICE; line++) {
+    if (TELEMETRY_BUFFER_SIZE - telemetryPending() < TELEMETRY_LINE_MAX) return;
+    if (captureIndex >= captureLength) {
+      telemetryPrintf("CAPTURE:END\r\n");
+      captureState = CAPTURE_IDLE;
+      scratchRelease(SCRATCH_CAPTURE);
+      captureBuffer = nullptr;
+      return;
+    }
+
+    char text[TELEMETRY_LINE_MAX];
+    int n = snprintf(text, sizeof(text), "CAPTURE:%u", (unsigned)captureIndex);
+    for (int i = 0; i < CAPTURE_SAMPLES_PER_LINE && captureIndex < captureLength; i++) {
+      n += snprintf(text + n, sizeof(text) - n, ",%u", (unsigned)captureBuffer[captureIndex++]);
+    }
+    n += snprintf(text + n, sizeof(text) - n, "\r\n");
+    telemetryWrite(text, n);
+  }
+}
+
+void deviceLog(const char* format, ...) {
+  int slot = logCount % LOG_ENTRIES;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(logRing[slot], LOG_LINE_MAX, format, args);
+  va_end(args);
+  logTimes[slot] = millis();
+  logCount++;
+}
+
+void printStats() {
+  const TelemetryStats& tx = telemetryStats();
+  uint32_t misses = 0, skipped = 0;
+  for (int i = 0; i < schedulerTaskCount(); i++) {
+    misses += schedulerTask(i).stats.deadlineMisses;
+    skipped += schedulerTask(i).stats.skipped;
+  }
+  telemetryPrintf("STATS:uptime=%lu,boot_ms=%lu,samples=%lu,windows=%lu,events=%lu\r\n",
+                  (unsigned long)millis(), (unsigned long)runtimeStats.bootMs,
+                  (unsigned long)runtimeStats.samples, (unsigned long)runtimeStats.windows,
+                  (unsigned long)runtimeStats.events);
+  telemetryPrintf("STATS:rate=%lu,load=%.1f%%,deadline_misses=%lu,skipped=%lu\r\n",
+                  (unsigned long)runtimeStats.samplesPerSecond, runtimeStats.cpuLoad * 100,
+                  (unsigned long)misses, (unsigned long)skipped);
+  telemetryPrintf("STATS:tx_sent=%lu,tx_dropped=%lu,tx_drops=%lu,tx_high_water=%u,tx_pending=%u\r\n",
+                  (unsigned long)tx.bytesSent, (unsigned long)tx.bytesDropped,
+                  (unsigned long)tx.writesDropped, (unsigned)tx.highWater,
+                  (unsigned)telemetryPending());
+}
+
+void printProfiler() {
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  for (int i = 0; i < schedulerTaskCount(); i++) {
+    const Task& task = schedulerTask(i);
+    const TaskStats& stat = task.stats;
+    uint32_t average = stat.runs ? (uint32_t)(stat.totalCycles / stat.runs) : 0;
+    telemetryPrintf("PROFILE:%s,prio=%u,runs=%lu,avg_us=%.1f,max_us=%.1f,"
+                    "max_latency_us=%lu,misses=%lu,skipped=%lu\r\n",
+                    task.name, (unsigned)task.priority, (unsigned long)stat.runs,
+                    (float)average / mhz, (float)stat.maxCycles / mhz,
+                    (unsigned long)stat.maxLatencyUs, (unsigned long)stat.deadlineMisses,
+                    (unsigned long)stat.skipped);
+  }
+}
+
+void printQuantiles() {
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  const float quantiles[] = {0.5f, 0.9f, 0.99f, 0.999f};
+  const char* names[] = {"p50", "p90", "p99", "p999"};
+  for (int i = 0; i < 4; i++) {
+    uint32_t cycles = sampleHistogram.quantile(quantiles[i]);
+    telemetryPrintf("QUANTILE:sample,%s,cycles=%lu,us=%.1f\r\n",
+                    names[i], (unsigned long)cycles, (float)cycles / mhz);
+  }
+  telemetryPrintf("QUANTILE:sample,max,cycles=%lu,us=%.1f\r\n",
+                  (unsigned long)sampleMaxCycles, (float)sampleMaxCycles / mhz);
+}
+
+void printLog() {
+  uint32_t first = logCount > LOG_ENTRIES ? logCount - LOG_ENTRIES : 0;
+  for (uint32_t i = first; i < logCount; i++) {
+    int slot = i % LOG_ENTRIES;
+    telemetryPrintf("LOG:%lu,%s\r\n", (unsigned long)logTimes[slot], logRing[slot]);
+  }
+  telemetryPrintf("LOG:END,%lu\r\n", (unsigned long)logCount);
+}
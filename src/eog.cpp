@@ -0,0 +1,144 @@
+/*
+  EOG Cursor Processing
+  Per-sample drift compensation, saccade/blink detection and gaze deltas.
+*/
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include "eog.h"
+#include "reliable_link.h"
+#include "telemetry.h"
+
+void EogProcessor::begin(uint8_t channels) {
+  channelCount = channels;
+  for (int c = 0; c < EOG_MAX_CHANNELS; c++) {
+    filters[c].reset();
+    quality[c].reset();
+  }
+  detector.reset();
+  gated = false;
+  dx = dy = 0;
+  pendingEvents = 0;
+  frameIndex = 0;
+  eventReady = false;
+}
+
+void EogProcessor::setSampleRate(float fs) {
+  for (int c = 0; c < EOG_MAX_CHANNELS; c++) {
+    filters[c].setSampleRate(fs);
+    quality[c].setSampleRate(fs);
+  }
+  detector.setSampleRate(fs);
+  begin(channelCount);
+}
+
+bool EogProcessor::push(const float* volts, uint32_t timestamp, EogFrame& frame) {
+  // Hold the drift baselines while the eyes are actually moving
+  bool hold = detector.active();
+  float mv[EOG_MAX_CHANNELS];
+  for (int c = 0; c < channelCount; c++) {
+    filters[c].first.frozen = hold;
+    mv[c] = filters[c].process(volts[c] * 1000.0f);
+  }
+
+  // Horizontal and vertical derivations
+  float h, v;
+  if (channelCount == 4) {
+    h = mv[1] - mv[0];
+    v = mv[2] - mv[3];
+  } else {
+    h = mv[0];
+    v = mv[1];
+  }
+
+  // A bad contact must not move the cursor: hold the detector in reset
+  bool usable = minimumSqi(quality, channelCount) >= SQI_GATE;
+  if (!usable) {
+    if (!gated) detector.reset();
+    gated = true;
+    eventReady = false;
+  } else {
+    gated = false;
+
+    // Only saccades move the cursor; blinks and fixation noise do not
+    eventReady = detector.push(h, v, timestamp, lastEvent);
+    dx += detector.moveDx;
+    dy += detector.moveDy;
+  }
+  if (eventReady) {
+    if (lastEvent.type == EOG_SACCADE_ONSET) pendingEvents |= EOG_EVENT_SACCADE;
+    if (lastEvent.type == EOG_BLINK) pendingEvents |= EOG_EVENT_BLINK;
+  }
+
+  if (++frameIndex < EOG_FRAME_DECIMATION) {
+    return false;
+  }
+
+  frame.timestamp = timestamp;
+  frame.channelCount = channelCount;
+  for (int c = 0; c < channelCount; c++) {
+    frame.channels[c] = mv[c];
+    frame.sqi[c] = quality[c].score;
+  }
+  frame.gazeDx = dx;
+  frame.gazeDy = dy;
+  frame.events = pendingEvents;
+
+  dx = dy = 0;
+  pendingEvents = 0;
+  frameIndex = 0;
+  return true;
+}
+
+bool EogProcessor::takeEvent(EogEventRecord& event) {
+  if (!eventReady) return false;
+  event = lastEvent;
+  eventReady = false;
+  return true;
+}
+
+// snprintf at n, with n clamped to the buffer once a piece no longer fits
+static int append(char* line, size_t size, int n, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+static int append(char* line, size_t size, int n, const char* format, ...) {
+  int full = (int)size;
+  if (n >= full) return full;
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(line + n, size - n, format, args);
+  va_end(args);
+  return written < 0 || n + written >= full ? full : n + written;
+}
+
+void sendEogFrame(const EogFrame& frame) {
+  char line[TELEMETRY_LINE_MAX];
+  size_t size = sizeof(line);
+  int n = append(line, size, 0, "{\"timestamp\":%lu,\"channels\":[",
+                 (unsigned long)frame.timestamp);
+  for (int c = 0; c < frame.channelCount; c++) {
+    n = append(line, size, n, c ? ",%.3f" : "%.3f", frame.channels[c]);
+  }
+  n = append(line, size, n, "],\"gaze\":[%.3f,%.3f],\"sqi\":[", frame.gazeDx, frame.gazeDy);
+  for (int c = 0; c < frame.channelCount; c++) {
+    n = append(line, size, n, c ? ",%.2f" : "%.2f", frame.sqi[c]);
+  }
+  n = append(line, size, n, "]");
+  if (frame.events) {
+    n = append(line, size, n, ",\"events\":[%s%s%s]",
+               (frame.events & EOG_EVENT_SACCADE) ? "\"saccade\"" : "",
+               (frame.events & EOG_EVENT_SACCADE) && (frame.events & EOG_EVENT_BLINK) ? "," : "",
+               (frame.events & EOG_EVENT_BLINK) ? "\"blink\"" : "");
+  }
+  n = append(line, size, n, "}\n");
+
+  // A cut-off frame is not JSON; the next one follows in a few ms
+  if ((size_t)n < size) telemetryWrite(line, n);
+}
+
+void sendEogEvent(const EogEventRecord& event, float sqi) {
+  reliablePrintf("{\"timestamp\":%lu,\"event\":\"%s\",\"gaze\":[%.3f,%.3f],"
+                 "\"velocity\":%.0f,\"latency\":%u,\"sqi\":%.2f}\n",
+                 (unsigned long)event.timestamp, eogEventName(event.type),
+                 event.dx, event.dy, event.peakVelocity, (unsigned)event.latencyMs, sqi);
+}
@@ -0,0 +1,232 @@
+/*
+  EOG Event Detector
+  Per-sample saccade/blink state machine.
+*/
+
+#include <math.h>
+
+#include "eog_events.h"
+
+EogEventDetector::EogEventDetector() {
+  // Default blink: lid velocity rises, then falls through zero at closure
+  for (int i = 0; i < EOG_BLINK_TEMPLATE_LEN; i++) {
+    blinkTemplate[i] = sinf((float)M_PI * i / (EOG_BLINK_TEMPLATE_LEN - 2));
+  }
+}
+
+void EogEventDetector::reset() {
+  state = IDLE;
+  primed = false;
+  warmup = (int)(EOG_WARMUP_MS * sampleRate / 1000);
+  moveDx = moveDy = 0;
+  quietCount = holdCount = candidateCount = 0;
+}
+
+// Blink timing is in ms; the sample counts follow the rate
+void EogEventDetector::setSampleRate(float fs) {
+  sampleRate = fs;
+  noiseAlpha = 1000.0f / (EOG_NOISE_TAU_MS * fs);
+  maxWait = (int)(EOG_BLINK_MAX_WAIT_MS * fs / 1000);
+  if (maxWait > EOG_BLINK_CANDIDATE_MAX) maxWait = EOG_BLINK_CANDIDATE_MAX;
+  if (maxWait < 3) maxWait = 3;  // matchBlink() needs three points
+  holdSamples = (int)(EOG_BLINK_HOLD_MS * fs / 1000);
+  blinkSettle = (int)(EOG_BLINK_SETTLE_MS * fs / 1000);
+  if (blinkSettle < 3) blinkSettle = 3;
+  saccadeSettle = (int)(EOG_SACCADE_SETTLE_MS * fs / 1000);
+  if (saccadeSettle < 2) saccadeSettle = 2;
+  reset();
+}
+
+bool EogEventDetector::push(float h, float v, uint32_t timestamp, EogEventRecord& event) {
+  if (!primed) {
+    prevH = h;
+    prevV = v;
+    primed = true;
+  }
+  float dh = h - prevH;
+  float dv = v - prevV;
+  float vh = dh * sampleRate;
+  float vv = dv * sampleRate;
+  float speed = sqrtf(vh * vh + vv * vv);
+  float limit = threshold();
+  sampleIndex++;
+  moveDx = moveDy = 0;
+
+  bool emitted = false;
+  switch (state) {
+    case IDLE:
+      // Noise floor from fixation, clipped so movements cannot inflate it
+      noise += noiseAlpha * ((speed < limit ? speed : limit) - noise);
+      if (warmup > 0) {
+        warmup--;
+        lastQuietSample = sampleIndex;
+        break;
+      }
+      if (speed <= limit) {
+        if (speed < 2 * noise) lastQuietSample = sampleIndex;
+        break;
+      }
+      onsetSample = lastQuietSample + 1;
+      sumDx = dh;
+      sumDy = dv;
+      peak = speed;
+      if (vv > 2 * fabsf(vh)) {
+        // Upward onset could be a blink: follow it before committing
+        state = BLINK_CANDIDATE;
+        candidate[0] = dv;
+        candidateCount = 1;
+        quietCount = 0;
+        peakUp = vv;
+      } else {
+        state = SACCADE;
+        quietCount = 0;
+        moveDx = dh;
+        moveDy = dv;
+        fill(event, EOG_SACCADE_ONSET, timestamp);
+        emitted = true;
+      }
+      break;
+
+    case BLINK_CANDIDATE:
+      candidate[candidateCount++] = dv;
+      sumDx += dh;
+      sumDy += dv;
+      if (speed > peak) peak = speed;
+
+      if (vv < -limit) {
+        // Vertical reversal: blink if the profile matches, else a saccade
+        if (matchBlink() >= blinkMatch) {
+          adaptTemplate();
+          state = BLINK_HOLD;
+          holdCount = holdSamples;
+          fill(event, EOG_BLINK, timestamp);
+        } else {
+          releaseSaccade(event, timestamp);
+        }
+        emitted = true;
+        break;
+      }
+
+      // Peaked too slowly for a lid, settled without reversing, or took
+      // too long: an upward saccade
+      if (vv > peakUp) peakUp = vv;
+      quietCount = speed < 0.5f * limit ? quietCount + 1 : 0;
+      if ((peakUp < blinkVelocity && vv < 0.7f * peakUp) ||
+          quietCount >= blinkSettle || candidateCount >= maxWait) {
+        releaseSaccade(event, timestamp);
+        emitted = true;
+      }
+      break;
+
+    case SACCADE:
+      sumDx += dh;
+      sumDy += dv;
+      moveDx = dh;
+      moveDy = dv;
+      if (speed > peak) peak = speed;
+
+      // Hysteresis: a few slow samples end the saccade
+      quietCount = speed < 0.5f * limit ? quietCount + 1 : 0;
+      if (quietCount >= saccadeSettle) {
+        state = IDLE;
+        lastQuietSample = sampleIndex;
+        fill(event, EOG_SACCADE_END, timestamp);
+        emitted = true;
+      }
+      break;
+
+    case BLINK_HOLD:
+      if (--holdCount <= 0) {
+        state = IDLE;
+        lastQuietSample = sampleIndex;
+      }
+      break;
+  }
+
+  prevH = h;
+  prevV = v;
+  return emitted;
+}
+
+// Template value at a fractional index, linearly interpolated
+float EogEventDetector::templateAt(float position) const {
+  int i = (int)position;
+  if (i >= EOG_BLINK_TEMPLATE_LEN - 1) return blinkTemplate[EOG_BLINK_TEMPLATE_LEN - 1];
+  float frac = position - i;
+  return blinkTemplate[i] + frac * (blinkTemplate[i + 1] - blinkTemplate[i]);
+}
+
+// Normalized cross-correlation of the candidate velocity with the
+// template, stretched so both span onset to the observed reversal
+float EogEventDetector::matchBlink() {
+  int n = candidateCount;
+  if (n < 3) return 0;
+  float scale = (float)(EOG_BLINK_TEMPLATE_LEN - 1) / (n - 1);
+
+  float meanC = 0, meanT = 0;
+  for (int i = 0; i < n; i++) {
+    meanC += candidate[i];
+    meanT += templateAt(i * scale);
+  }
+  meanC /= n;
+  meanT /= n;
+
+  float dot = 0, energyC = 0, energyT = 0;
+  for (int i = 0; i < n; i++) {
+    float c = candidate[i] - meanC;
+    float t = templateAt(i * scale) - meanT;
+    dot += c * t;
+    energyC += c * c;
+    energyT += t * t;
+  }
+  if (energyC <= 0 || energyT <= 0) return 0;
+  return dot / sqrtf(energyC * energyT);
+}
+
+// Blend the confirmed blink, resampled to the template length and scaled
+// to a peak of 1, into the template
+void EogEventDetector::adaptTemplate() {
+  int n = candidateCount;
+  float peakAbs = 0;
+  for (int i = 0; i < n; i++) {
+    if (fabsf(candidate[i]) > peakAbs) peakAbs = fabsf(candidate[i]);
+  }
+  if (peakAbs <= 0) return;
+
+  float scale = (float)(n - 1) / (EOG_BLINK_TEMPLATE_LEN - 1);
+  for (int j = 0; j < EOG_BLINK_TEMPLATE_LEN; j++) {
+    float position = j * scale;
+    int i = (int)position;
+    float value = i >= n - 1 ? candidate[n - 1]
+                : candidate[i] + (position - i) * (candidate[i + 1] - candidate[i]);
+    blinkTemplate[j] += templateAlpha * (value / peakAbs - blinkTemplate[j]);
+  }
+}
+
+// A held upward movement turned out to be a saccade: hand over everything
+// accumulated while waiting
+void EogEventDetector::releaseSaccade(EogEventRecord& event, uint32_t timestamp) {
+  state = SACCADE;
+  quietCount = 0;
+  moveDx = sumDx;
+  moveDy = sumDy;
+  fill(event, EOG_SACCADE_ONSET, timestamp);
+}
+
+void EogEventDetector::fill(EogEventRecord& event, EogEventType type, uint32_t timestamp) {
+  event.timestamp = timestamp;
+  event.type = type;
+  event.dx = sumDx;
+  event.dy = sumDy;
+  event.peakVelocity = peak;
+  event.latencyMs = (uint16_t)((sampleIndex - onsetSample) * 1000 / sampleRate);
+}
+
+const char* eogEventName(EogEventType type) {
+  switch (type) {
+    case EOG_SACCADE_ONSET: return "saccade";
+    case EOG_SACCADE_END: return "saccade_end";
+    case EOG_BLINK: return "blink";
+  }
+  return "unknown";
+}
@@ -0,0 +1,86 @@
+/*
+  Harmonic Structure
+  Harmonic product spectrum and harmonic power ratios on the Welch PSD.
+*/
+
+#include <math.h>
+
+#include "harmonics.h"
+
+// Largest bin within one of k
+static int peakBin(const float* psd, int bins, int k) {
+  int best = k;
+  for (int j = k - 1; j <= k + 1; j++) {
+    if (j > 0 && j < bins && psd[j] > psd[best]) best = j;
+  }
+  return best;
+}
+
+// Its power, and optionally the main-lobe power around it
+static float peakNear(const float* psd, int bins, int k, float* lobePower) {
+  int best = peakBin(psd, bins, k);
+  if (lobePower) {
+    *lobePower = psd[best];
+    if (best > 0) *lobePower += psd[best - 1];
+    if (best + 1 < bins) *lobePower += psd[best + 1];
+  }
+  return psd[best];
+}
+
+void analyzeHarmonics(const float* psd, int bins, float binHz, float* out) {
+  for (int i = 0; i < HARMONIC_COUNT; i++) out[i] = 0;
+
+  int first = (int)ceilf(HARMONIC_MIN_HZ / binHz);
+  int last = (int)(HARMONIC_MAX_HZ / binHz);
+  if (first < 2) first = 2;
+  if (last > bins - 2) last = bins - 2;
+  if (first > last) return;
+
+  float maximum = 0;
+  for (int k = first; k < bins; k++) {
+    if (psd[k] > maximum) maximum = psd[k];
+  }
+  if (maximum <= 0) return;
+
+  // Harmonic product spectrum on exact multiples (the Hann main lobe is
+  // wide enough to catch a harmonic that falls between bins; searching
+  // around each one invites sub-harmonic errors). Past the spectrum a
+  // harmonic counts as floor.
+  int fundamental = 0;
+  float bestProduct = 0;
+  for (int k = first; k <= last; k++) {
+    float product = 1;
+    for (int h = 1; h <= HARMONIC_ORDER; h++) {
+      int bin = h * k;
+      product *= bin < bins ? psd[bin] / maximum : 1e-3f;
+    }
+    if (product > bestProduct) {
+      bestProduct = product;
+      fundamental = k;
+    }
+  }
+  if (fundamental == 0) return;
+
+  // Harmonics are placed from the interpolated fundamental, so they do
+  // not drift off by a bin per order
+  float fundamentalBin = fundamental + peakOffset(psd, fundamental);
+  float fundamentalPower;
+  peakNear(psd, bins, fundamental, &fundamentalPower);
+  out[0] = fundamentalBin * binHz;
+
+  int present = 0;
+  int gap = (int)(fundamentalBin / 2 + 0.5f);
+  for (int h = 2; h <= HARMONIC_ORDER; h++) {
+    int bin = (int)(h * fundamentalBin + 0.5f);
+    if (bin + gap >= bins) break;
+
+    float power;
+    float peak = peakNear(psd, bins, bin, &power);
+    if (h <= 3 && fundamentalPower > 0) out[h - 1] = power / fundamentalPower;
+
+    // Floor midway to the neighbouring harmonics
+    float floor = 0.5f * (psd[bin - gap] + psd[bin + gap]);
+    if (peak > HARMONIC_SNR * floor) present++;
+  }
+  out[3] = present;
+}
@@ -0,0 +1,241 @@
+/*
+  Inertial Sensor Input
+  MPU-6050 FIFO bursts, the simulated source and clock synchronization.
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <math.h>
+
+#include "imu.h"
+
+// MPU-6050 registers
+#define REG_SMPLRT_DIV 0x19
+#define REG_CONFIG 0x1A
+#define REG_GYRO_CONFIG 0x1B
+#define REG_ACCEL_CONFIG 0x1C
+#define REG_FIFO_EN 0x23
+#define REG_USER_CTRL 0x6A
+#define REG_PWR_MGMT_1 0x6B
+#define REG_FIFO_COUNT_H 0x72
+#define REG_FIFO_R_W 0x74
+#define REG_WHO_AM_I 0x75
+
+#define FIFO_EN_ACCEL_GYRO 0x78  // accel, then gyro x/y/z
+#define USER_CTRL_FIFO_EN 0x40
+#define USER_CTRL_FIFO_RESET 0x04
+
+static bool writeRegister(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(IMU_I2C_ADDRESS);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+static bool readRegisters(uint8_t reg, uint8_t* out, uint8_t count) {
+  Wire.beginTransmission(IMU_I2C_ADDRESS);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom((uint16_t)IMU_I2C_ADDRESS, count) != count) return false;
+  return Wire.readBytes(out, count) == count;
+}
+
+static int16_t readInt16(const uint8_t* bytes) {
+  return (int16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+static void writeInt16(uint8_t* bytes, float value) {
+  long v = lroundf(value);
+  if (v > 32767) v = 32767;
+  if (v < -32768) v = -32768;
+  bytes[0] = (uint8_t)((uint16_t)v >> 8);
+  bytes[1] = (uint8_t)v;
+}
+
+const char* imuSourceName(ImuSource source) {
+  switch (source) {
+    case IMU_NONE: return "none";
+    case IMU_MPU6050: return "mpu6050";
+    case IMU_SIMULATED: return "simulated";
+  }
+  return "none";
+}
+
+void decodeImuFrame(const uint8_t* bytes, ImuFrame& frame) {
+  for (int axis = 0; axis < 3; axis++) {
+    frame.accel[axis] = readInt16(bytes + 2 * axis) / IMU_ACCEL_LSB_PER_G;
+    frame.gyro[axis] = readInt16(bytes + 6 + 2 * axis) / IMU_GYRO_LSB_PER_DPS;
+  }
+}
+
+bool ImuDevice::begin(ImuSource requested, uint16_t emgRate, uint32_t nowUs) {
+  end();
+  rate = imuRateFor(emgRate);
+
+  if (requested == IMU_MPU6050) {
+    Wire.begin();
+    Wire.setClock(IMU_I2C_HZ);
+    uint8_t id = 0;
+    // MPU-6050 answers 0x68, the MPU-6500 0x70 and the MPU-9250 0x71
+    if (!readRegisters(REG_WHO_AM_I, &id, 1) || (id != 0x68 && id != 0x70 && id != 0x71)) {
+      return false;
+    }
+    bool ok = writeRegister(REG_PWR_MGMT_1, 0x01)           // awake, gyro PLL clock
+           && writeRegister(REG_CONFIG, 0x03)               // 44 Hz DLPF, 1 kHz internal rate
+           && writeRegister(REG_SMPLRT_DIV, (uint8_t)(1000 / rate - 1))
+           && writeRegister(REG_GYRO_CONFIG, 0x00)          // +/-250 deg/s
+           && writeRegister(REG_ACCEL_CONFIG, 0x00)         // +/-2 g
+           && writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_RESET)
+           && writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_EN)
+           && writeRegister(REG_FIFO_EN, FIFO_EN_ACCEL_GYRO);
+    if (!ok) {
+      busErrors++;
+      return false;
+    }
+  } else if (requested == IMU_SIMULATED) {
+    simulation.phase = 0;
+    simulation.pendingFrames = 0;
+    simulation.lastUs = nowUs;
+  } else {
+    return requested == IMU_NONE;
+  }
+
+  source = requested;
+  return true;
+}
+
+void ImuDevice::end() {
+  if (source == IMU_MPU6050) writeRegister(REG_FIFO_EN, 0);
+  source = IMU_NONE;
+  frames = 0;
+  fifoOverflows = 0;
+  busErrors = 0;
+}
+
+int ImuDevice::read(ImuFrame* out, int maxFrames, uint32_t nowUs) {
+  if (maxFrames > IMU_MAX_BURST_FRAMES) maxFrames = IMU_MAX_BURST_FRAMES;
+  int count = source == IMU_MPU6050   ? readSensor(out, maxFrames)
+            : source == IMU_SIMULATED ? readSimulated(out, maxFrames, nowUs)
+                                      : 0;
+  frames += count;
+  return count;
+}
+
+int ImuDevice::readSensor(ImuFrame* out, int maxFrames) {
+  uint8_t bytes[IMU_MAX_BURST_FRAMES * IMU_FRAME_BYTES];
+  if (!readRegisters(REG_FIFO_COUNT_H, bytes, 2)) {
+    busErrors++;
+    return 0;
+  }
+
+  // 1024 is not a whole number of frames: once full, alignment is lost
+  int queued = (bytes[0] << 8) | bytes[1];
+  if (queued > IMU_FIFO_BYTES - IMU_FRAME_BYTES) {
+    fifoOverflows++;
+    writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_RESET | USER_CTRL_FIFO_EN);
+    return 0;
+  }
+
+  int count = queued / IMU_FRAME_BYTES;
+  if (count > maxFrames) count = maxFrames;
+  if (count == 0) return 0;
+  if (!readRegisters(REG_FIFO_R_W, bytes, (uint8_t)(count * IMU_FRAME_BYTES))) {
+    busErrors++;
+    return 0;
+  }
+  for (int i = 0; i < count; i++) decodeImuFrame(bytes + i * IMU_FRAME_BYTES, out[i]);
+  return count;
+}
+
+int ImuDevice::readSimulated(ImuFrame* out, int maxFrames, uint32_t nowUs) {
+  ImuSimulation& sim = simulation;
+  const float frameRate = rate * (1 + IMU_SIM_CLOCK_ERROR);
+  sim.pendingFrames += (uint32_t)(nowUs - sim.lastUs) * 1e-6f * frameRate;
+  sim.lastUs = nowUs;
+  if (sim.pendingFrames > IMU_FIFO_BYTES / IMU_FRAME_BYTES) {
+    fifoOverflows++;
+    sim.pendingFrames = 0;
+    return 0;
+  }
+
+  // Tremor along a fixed oblique axis, gravity on z, gyro still
+  static const float AXIS[3] = {0.6f, 0.8f, 0.0f};
+  const float step = 2 * (float)M_PI * sim.tremorHz / frameRate;
+  int count = 0;
+  for (; count < maxFrames && sim.pendingFrames >= 1; count++, sim.pendingFrames -= 1) {
+    float tremor = sim.tremorG * sinf(sim.phase);
+    sim.phase += step;
+    if (sim.phase > 2 * (float)M_PI) sim.phase -= 2 * (float)M_PI;
+
+    uint8_t bytes[IMU_FRAME_BYTES];
+    for (int axis = 0; axis < 3; axis++) {
+      sim.seed = sim.seed * 1103515245u + 12345u;
+      float noise = IMU_SIM_NOISE_G * ((int)((sim.seed >> 16) & 0x7fff) / 16384.0f - 1);
+      float g = (axis == 2 ? 1.0f : 0.0f) + AXIS[axis] * tremor + noise;
+      writeInt16(bytes + 2 * axis, g * IMU_ACCEL_LSB_PER_G);
+      writeInt16(bytes + 6 + 2 * axis, 0);  // the features use acceleration only
+    }
+    decodeImuFrame(bytes, out[count]);
+  }
+  return count;
+}
+
+void ImuSync::configure(float imuRate, float emgRate) {
+  nominal = imuRate / emgRate;
+  gain = 1 / (IMU_SYNC_TIME_S * imuRate);
+  smoothing = 1 / (IMU_SYNC_SMOOTHING_S * emgRate);
+  reset();
+}
+
+void ImuSync::reset() {
+  written = 0;
+  readIndex = 0;
+  fraction = 0;
+  ratio = nominal;
+  fillAverage = IMU_SYNC_TARGET;
+  primed = false;
+}
+
+void ImuSync::push(const ImuFrame& frame) {
+  queue[written % IMU_QUEUE] = frame;
+  written++;
+  // Keep the newest frames; the reader restarts at the target fill
+  if (written - readIndex > IMU_QUEUE - 1) {
+    overruns++;
+    readIndex = written - (uint32_t)IMU_SYNC_TARGET;
+    fraction = 0;
+  }
+}
+
+bool ImuSync::next(float* accel) {
+  if (!primed) {
+    if (written - readIndex < IMU_SYNC_TARGET) return false;
+    primed = true;
+  }
+
+  // Hold the last frame rather than read past the newest one
+  if (written - readIndex < 2) {
+    underruns++;
+    const ImuFrame& last = queue[(written - 1) % IMU_QUEUE];
+    for (int axis = 0; axis < 3; axis++) accel[axis] = last.accel[axis];
+    return true;
+  }
+
+  const ImuFrame& a = queue[readIndex % IMU_QUEUE];
+  const ImuFrame& b = queue[(readIndex + 1) % IMU_QUEUE];
+  for (int axis = 0; axis < 3; axis++) {
+    accel[axis] = a.accel[axis] + fraction * (b.accel[axis] - a.accel[axis]);
+  }
+
+  // Servo the read rate on the averaged fill
+  float fill = (written - readIndex) - fraction;
+  fillAverage += smoothing * (fill - fillAverage);
+  ratio = nominal * (1 + gain * (fillAverage - IMU_SYNC_TARGET));
+
+  fraction += ratio;
+  while (fraction >= 1) {
+    fraction -= 1;
+    readIndex++;
+  }
+  return true;
+}
@@ -0,0 +1,134 @@
+/*
+  Accelerometer Tremor Features
+  Principal-axis projection, acceleration spectrum and EMG coherence per
+  segment.
+*/
+
+#include <math.h>
+
+#include "imu_features.h"
+#include "telemetry.h"
+#include "welch.h"
+
+void ImuFeatures::setSampleRate(float fs) {
+  envelope.setSampleRate(fs);
+  for (int i = 0; i < 3; i++) filters[i].setSampleRate(fs);
+  decimation = (int)(fs / IMU_SEGMENT_HZ + 0.5f);
+  if (decimation < 1) decimation = 1;
+  segmentRate = fs / decimation;
+  reset();
+}
+
+void ImuFeatures::reset() {
+  envelope.reset();
+  for (int i = 0; i < 3; i++) filters[i].reset();
+  phase = 0;
+  count = 0;
+  pending = false;
+  segments = 0;
+  // Diagonal start: not orthogonal to any single-axis movement
+  axis[0] = axis[1] = axis[2] = 0.57735f;
+  for (int k = 0; k <= IMU_SEGMENT_SIZE / 2; k++) {
+    autoEmg[k] = autoAccel[k] = crossRe[k] = crossIm[k] = 0;
+  }
+}
+
+static void removeMean(float* x, int n) {
+  float mean = 0;
+  for (int i = 0; i < n; i++) mean += x[i];
+  mean /= n;
+  for (int i = 0; i < n; i++) x[i] -= mean;
+}
+
+// Dominant eigenvector of a symmetric 3x3 matrix, refined from axis
+static void principalAxis(const float c[3][3], float* axis) {
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[3];
+    for (int i = 0; i < 3; i++) {
+      next[i] = c[i][0] * axis[0] + c[i][1] * axis[1] + c[i][2] * axis[2];
+    }
+    float norm = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (norm <= 0) return;  // no movement: keep the previous axis
+    for (int i = 0; i < 3; i++) axis[i] = next[i] / norm;
+  }
+}
+
+bool ImuFeatures::analyze(ImuResult& result) {
+  if (!pending) return false;
+  const int n = IMU_SEGMENT_SIZE;
+  float* x = emg[filling ^ 1];
+  float (*a)[IMU_SEGMENT_SIZE] = accel[filling ^ 1];
+
+  removeMean(x, n);
+  float covariance[3][3] = {};
+  for (int i = 0; i < 3; i++) removeMean(a[i], n);
+  for (int t = 0; t < n; t++) {
+    for (int i = 0; i < 3; i++) {
+      for (int j = i; j < 3; j++) covariance[i][j] += a[i][t] * a[j][t];
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < i; j++) covariance[i][j] = covariance[j][i];
+  }
+
+  // Power iteration keeps the direction it started from, so the sign
+  // stays put unless the axis really turns over
+  float previous[3] = {axis[0], axis[1], axis[2]};
+  principalAxis(covariance, axis);
+  if (axis[0] * previous[0] + axis[1] * previous[1] + axis[2] * previous[2] < 0) {
+    for (int i = 0; i < 3; i++) axis[i] = -axis[i];
+  }
+
+  // The projection overwrites the first axis buffer
+  float* y = a[0];
+  for (int t = 0; t < n; t++) {
+    float w = fft.hann(t);
+    x[t] *= w;
+    y[t] = w * (axis[0] * a[0][t] + axis[1] * a[1][t] + axis[2] * a[2][t]);
+  }
+  fft.transform(x, y);
+
+  if (segments < IMU_AVERAGES) segments++;
+  float weight = 1.0f / segments;
+  float binHz = segmentRate / n;
+  int first = (int)ceilf(ANTAGONIST_BAND_LOW_HZ / binHz);
+  int last = (int)(ANTAGONIST_BAND_HIGH_HZ / binHz);
+  if (last > n / 2 - 1) last = n / 2 - 1;
+
+  // One bin either side of the band for the peak interpolation
+  for (int k = first - 1; k <= last + 1; k++) {
+    float fx[2], fy[2];
+    splitRealPair(x, y, n, k, fx, fy);
+    float sxx = fx[0] * fx[0] + fx[1] * fx[1];
+    float syy = fy[0] * fy[0] + fy[1] * fy[1];
+    autoEmg[k] += weight * (sxx - autoEmg[k]);
+    autoAccel[k] += weight * (syy - autoAccel[k]);
+    crossRe[k] += weight * (fx[0] * fy[0] + fx[1] * fy[1] - crossRe[k]);
+    crossIm[k] += weight * (fx[1] * fy[0] - fx[0] * fy[1] - crossIm[k]);
+  }
+
+  float bandPower = 0, sum = 0;
+  int best = first;
+  for (int k = first; k <= last; k++) {
+    bandPower += autoAccel[k];
+    if (autoAccel[k] > autoAccel[best]) best = k;
+    float denominator = autoEmg[k] * autoAccel[k];
+    sum += denominator > 0 ? (crossRe[k] * crossRe[k] + crossIm[k] * crossIm[k]) / denominator : 0;
+  }
+  float peakDenominator = autoEmg[best] * autoAccel[best];
+
+  // Hann: sum of squared weights is 3N/8; both sides of the spectrum
+  result.amplitudeG = sqrtf(2 * bandPower / (n * 3.0f * n / 8));
+  result.coherence = last >= first ? sum / (last - first + 1) : 0;
+  result.peakCoherence = peakDenominator > 0
+      ? (crossRe[best] * crossRe[best] + crossIm[best] * crossIm[best]) / peakDenominator : 0;
+  result.peakHz = segments >= IMU_MIN_SEGMENTS ? (best + peakOffset(autoAccel, best)) * binHz : 0;
+  for (int i = 0; i < 3; i++) result.axis[i] = axis[i];
+  pending = false;
+  return true;
+}
+
+void sendImu(const ImuResult& result) {
+  telemetryPrintf("ACCEL:%.2f,%.4f,%.2f,%.2f\r\n", result.peakHz, result.amplitudeG,
+                  result.coherence, result.peakCoherence);
+}
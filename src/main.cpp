@@ -2,159 +2,747 @@
   EMG Tremor Measurement (Local Classification)
   Hardware: ESP32 + BioAmp EXG Pill
   Objective: Capture raw EMG signals and classify tremors locally
-  Features: No WiFi, local signal processing, rule-based classification
+  Features: No WiFi, local signal processing, rule-based classification,
+            EOG cursor mode for neuro-pointer on the same acquisition core
 */
 
-#define EMG_PIN 34
-#define SAMPLE_RATE 200
-#define SAMPLE_DELAY (1000 / SAMPLE_RATE)
-#define BATCH_SIZE 50
+#include <Arduino.h>
 
-unsigned long lastSampleTime = 0;
-float alpha = 0.1;
-float filteredValue = 0;
-float emgBuffer[BATCH_SIZE];
-int bufferIndex = 0;
+#include "anomaly.h"
+#include "antagonist.h"
+#include "benchmark.h"
+#include "command_console.h"
+#include "config_store.h"
+#include "cycle_budget.h"
+#include "device_config.h"
+#include "diagnostics.h"
+#include "eog.h"
+#include "imu.h"
+#include "memory_budget.h"
+#include "ota_update.h"
+#include "pipeline_budget.h"
+#include "reliable_link.h"
+#include "scheduler.h"
+#include "signal_quality.h"
+#include "telemetry.h"
+#include "tremor.h"
 
-// Local classification parameters (derived from trained model)
-const float FREQ_THRESHOLDS[3] = {1.0, 3.0, 6.0};  // Hz boundaries for normal, mild, severe
-const float AMP_THRESHOLDS[3] = {0.5, 1.5, 2.5};  // Amplitude boundaries
+#define EMG_PIN 34       // flexor
+#define EXTENSOR_PIN 35  // antagonist channel for the coupling features
 
-// Classification results
-enum TremorClass { NORMAL, MILD, SEVERE };
-TremorClass currentClassification = NORMAL;
+// Mode configurations (pipeline_budget.h), checked against the real-time
+// budget at compile time
+constexpr cycle_budget::Prediction TREMOR_BUDGET = cycle_budget::predict(TREMOR_PIPELINE);
+static_assert(cycle_budget::coresWithinBudget(TREMOR_BUDGET), "tremor pipeline exceeds CPU budget");
+static_assert(cycle_budget::latencyWithinBudget(TREMOR_BUDGET), "tremor window work exceeds one sample period");
+static_assert(cycle_budget::linkWithinBudget(TREMOR_BUDGET), "tremor telemetry exceeds serial link bandwidth");
+
+constexpr cycle_budget::Prediction EOG_BUDGET = cycle_budget::predict(EOG_PIPELINE);
+static_assert(cycle_budget::coresWithinBudget(EOG_BUDGET), "EOG pipeline exceeds CPU budget");
+static_assert(cycle_budget::latencyWithinBudget(EOG_BUDGET), "EOG frame work exceeds one sample period");
+static_assert(cycle_budget::linkWithinBudget(EOG_BUDGET), "EOG frames exceed serial link bandwidth");
+
+// Boot defaults; thresholds are the local classification parameters
+// derived from the trained model
+const DeviceConfig DEFAULT_DEVICE_CONFIG = {
+  DEFAULT_MODE,
+  SAMPLE_RATE,
+  BATCH_SIZE,
+  {1.0, 3.0, 6.0},  // Hz boundaries for normal, mild, severe, at rest
+  {0.5, 1.5, 2.5},  // Amplitude boundaries
+  6.0f,             // saccade threshold factor
+  1000.0f,          // blink velocity, mV/s
+  50,               // display points per second when downsampling
+  DISPLAY_RAW,      // every sample, as the Python tools expect
+  0,
+  50,               // PSD segment overlap, percent
+  8,                // PSD segments averaged
+  0,
+  {1.0, 4.0, 8.0},  // posture: physiological tremor above 8 Hz is normal
+  {2.0, 4.0, 8.0},  // movement: below 2 Hz is the movement itself
+  ANOMALY_DEFAULT_THRESHOLD,
+};
+
+static const char* const TREMOR_CLASS_NAMES[TREMOR_CLASS_COUNT] = {
+    "NORMAL", "MILD", "MODERATE", "SEVERE"};
+
+// Running configuration, restored from NVS in setup()
+DeviceConfig deviceConfig = DEFAULT_DEVICE_CONFIG;
+
+unsigned long samplePeriodUs = 1000000UL / SAMPLE_RATE;
+TremorPipeline tremorPipeline(BATCH_SIZE);
+SignalQuality tremorQuality;
+SignalQuality extensorQuality;
+AntagonistFeatures antagonist;
+ImuDevice imuDevice;
+ImuSync imuSync;
+ImuFeatures imuFeatures;
+MotorContextEstimator motorContext;
+AnomalyDetector anomalyDetector;
+EogProcessor eogProcessor;
+AdcToVolts<> eogCalibration;
+
+constexpr MemoryRegion tremorMemory = {
+    "tremor",
+    sizeof(tremorPipeline) + sizeof(tremorQuality) + sizeof(extensorQuality) +
+        sizeof(antagonist) + sizeof(motorContext) + sizeof(anomalyDetector),
+    MEMORY_BUDGET_TREMOR};
+constexpr MemoryRegion imuMemory = {
+    "imu", sizeof(imuDevice) + sizeof(imuSync) + sizeof(imuFeatures), MEMORY_BUDGET_IMU};
+constexpr MemoryRegion eogMemory = {
+    "eog", sizeof(eogProcessor) + sizeof(eogCalibration), MEMORY_BUDGET_EOG};
+static_assert(tremorMemory.bytes <= tremorMemory.budget, "tremor state exceeds its memory budget");
+static_assert(imuMemory.bytes <= imuMemory.budget, "IMU state exceeds its memory budget");
+static_assert(eogMemory.bytes <= eogMemory.budget, "EOG state exceeds its memory budget");
+
+// Scheduled work, highest priority first
+#define TELEMETRY_PERIOD_US 2000   // UART FIFO holds ~11 ms at 115200 baud
+#define CONSOLE_PERIOD_US 5000
+#define STATS_PERIOD_US 1000000
+#define IMU_IDLE_PERIOD_US 1000000
+
+int sampleTask = -1;
+int analysisTask = -1;
+int imuTask = -1;
+
+void taskSample(uint32_t now);
+void taskAnalyze(uint32_t now);
+void taskImu(uint32_t now);
+void taskTelemetry(uint32_t now);
+void taskConsole(uint32_t now);
+void taskStats(uint32_t now);
+void taskCapture(uint32_t now);
+void taskConfig(uint32_t now);
+void taskOta(uint32_t now);
+
+void sampleTremor();
+void sampleEog();
+void printBanner();
+void reportBootTime(unsigned long now);
+
+ConfigLoadStatus configStatus = CONFIG_DEFAULTS;
+bool firstSample = true;
 
 void setup() {
-  Serial.begin(115200);
-  pinMode(EMG_PIN, INPUT);
+  Serial.setRxBufferSize(CONSOLE_RX_BUFFER);  // room for update blocks between polls
+  Serial.begin(BAUD_RATE);
   analogReadResolution(12);
+  // Counts a trial boot of an updated image, or goes back to the previous one
+  otaSetup();
+
+  // Sampling is never delayed by more than one other task's run
+  sampleTask = schedulerAdd("sample", taskSample, TASK_PERIODIC, 0, samplePeriodUs, samplePeriodUs / 4);
+  analysisTask = schedulerAdd("analysis", taskAnalyze, TASK_EVENT, 1, 0, samplePeriodUs);
+  imuTask = schedulerAdd("imu", taskImu, TASK_PERIODIC, 2, IMU_IDLE_PERIOD_US, IMU_IDLE_PERIOD_US);
+  bool scheduled = sampleTask >= 0 && analysisTask >= 0 && imuTask >= 0;
+  scheduled &= schedulerAdd("telemetry", taskTelemetry, TASK_PERIODIC, 2, TELEMETRY_PERIOD_US,
+                            TELEMETRY_PERIOD_US) >= 0;
+  scheduled &= schedulerAdd("console", taskConsole, TASK_PERIODIC, 3, CONSOLE_PERIOD_US,
+                            2 * CONSOLE_PERIOD_US) >= 0;
+  scheduled &= schedulerAdd("stats", taskStats, TASK_PERIODIC, 4, STATS_PERIOD_US,
+                            STATS_PERIOD_US / 100) >= 0;
+  scheduled &= schedulerAdd("capture", taskCapture, TASK_IDLE, 5, 0, 0) >= 0;
+  scheduled &= schedulerAdd("config", taskConfig, TASK_IDLE, 5, 0, 0) >= 0;
+  scheduled &= schedulerAdd("ota", taskOta, TASK_IDLE, 5, 0, 0) >= 0;
+  if (!scheduled) deviceLog("scheduler: table full, raise SCHEDULER_MAX_TASKS");
 
-  Serial.println("=== EMG Local Classification Started ===");
-  Serial.println("Processing EMG signals locally on ESP32");
-  Serial.println("Tremor frequency: 4–6 Hz | Sample rate: 200 Hz");
+  DeviceConfig stored = DEFAULT_DEVICE_CONFIG;
+  configStatus = configLoad(stored);
+  prototypesLoad(tremorPipeline.classifier.table);
+  // A first boot calibrates on its first windows
+  if (anomalyModelLoad(anomalyDetector.model) != CONFIG_LOADED) {
+    anomalyDetector.startCalibration(ANOMALY_DEFAULT_WINDOWS);
+  }
+  if (!applyConfig(stored)) {
+    deviceLog("config: stored settings over budget, partly restored");
+  }
+  // Optional hardware: a missing sensor leaves the EMG-only features
+  applyImu(IMU_MPU6050, IMU_SIM_HZ, IMU_SIM_G);
+  printBanner();
+  printMemory();
+
+#ifdef BENCHMARK_MODE
+  runBenchmarks();
+#endif
+  // First sample is due on the first loop pass
+  schedulerSetPeriod(sampleTask, samplePeriodUs, samplePeriodUs / 4);
+  // Everything is allocated: from here on the heap is off limits
+  memorySeal();
 }
 
 void loop() {
-  unsigned long currentTime = millis();
-
-  if (currentTime - lastSampleTime >= SAMPLE_DELAY) {
-    lastSampleTime = currentTime;
-
-    // Read and filter EMG signal
-    int rawValue = analogRead(EMG_PIN);
-    float voltage = (rawValue / 4095.0) * 3.3;
-    
-    // Apply low-pass filter
-    filteredValue = alpha * voltage + (1 - alpha) * filteredValue;
-    
-    // Noise threshold - discard extreme values
-    if (abs(filteredValue - voltage) > 2.0) {
-      filteredValue = voltage;  // Reset filter on extreme change
+  schedulerRun();
+}
+
+void taskSample(uint32_t now) {
+  if (firstSample) reportBootTime(now);
+
+  uint32_t start = profileStart();
+  if (deviceConfig.mode == MODE_EOG) {
+    sampleEog();
+  } else {
+    sampleTremor();
+  }
+  profileSample(start);
+  runtimeStats.samples++;
+}
+
+// Windows recorded while the electrodes were bad are not classified
+void taskAnalyze(uint32_t now) {
+  if (tremorPipeline.windowPending) {
+    if (tremorQuality.usable()) {
+      tremorPipeline.analyze();
+    } else {
+      tremorPipeline.discard();
+      tremorPipeline.sink.onPoorSignal(tremorQuality.flags);
     }
-    
-    // Store in buffer
-    emgBuffer[bufferIndex] = filteredValue;
-    bufferIndex++;
-
-    // Print real-time values for Python parsing
-    Serial.print(voltage, 3);
-    Serial.print(",");
-    Serial.println(filteredValue, 3);
-
-    // Classify when buffer is full
-    if (bufferIndex >= BATCH_SIZE) {
-      classifyTremorLocally();
-      bufferIndex = 0;
+  }
+
+  // Segments spanning vigorous movement say nothing about tremor
+  bool moving = motorContext.context == CONTEXT_VIGOROUS;
+
+  // Acceleration against the flexor EMG; feeds the next window's features
+  if (imuFeatures.pending) {
+    ImuResult result;
+    if (!tremorQuality.usable() || moving) {
+      imuFeatures.discard();
+    } else if (imuFeatures.analyze(result)) {
+      tremorPipeline.features.get<ImuWindowFeatures>().update(result);
+      sendImu(result);
+    }
+  }
+
+  // Coupling needs both muscles; silent when no extensor is wired up
+  if (antagonist.pending) {
+    AntagonistResult result;
+    if (!tremorQuality.usable() || !extensorQuality.usable() || moving) {
+      antagonist.discard();
+    } else if (antagonist.analyze(result)) {
+      sendAntagonist(result);
     }
   }
 }
 
-void classifyTremorLocally() {
-  // Extract features from buffer
-  float features[4];
-  extractFeatures(emgBuffer, BATCH_SIZE, features);
+// One FIFO burst onto the EMG clock; idle in EOG mode
+void taskImu(uint32_t now) {
+  if (imuDevice.source == IMU_NONE || deviceConfig.mode != MODE_TREMOR) return;
+  ImuFrame frames[IMU_MAX_BURST_FRAMES];
+  int count = imuDevice.read(frames, imuBurstFrames(samplePeriodUs), now);
+  for (int i = 0; i < count; i++) imuSync.push(frames[i]);
+}
 
-  // Simple rule-based classification (based on trained model thresholds)
-  TremorClass classification = classifyFromFeatures(features);
+// Drain queued output without blocking the next sample
+void taskTelemetry(uint32_t now) {
+  reliableService();
+  telemetryFlush();
+}
 
-  // Update classification if changed
-  if (classification != currentClassification) {
-    currentClassification = classification;
-    printClassification(classification, features);
+void taskConsole(uint32_t now) {
+  consolePoll();
+}
+
+void taskStats(uint32_t now) {
+  rolloverStats(now);
+  memoryService();
+}
+
+void taskCapture(uint32_t now) {
+  serviceCapture();
+}
+
+// Settled console changes go to flash in idle time, never inside a sample
+void taskConfig(uint32_t now) {
+  configService(millis());
+  prototypesService(tremorPipeline.classifier.table, millis());
+  anomalyModelService(anomalyDetector.model, millis());
+}
+
+// Firmware update work, one bounded flash step per idle pass
+void taskOta(uint32_t now) {
+  otaService();
+}
+
+void reportBootTime(unsigned long now) {
+  firstSample = false;
+  runtimeStats.bootMs = now / 1000;
+  telemetryPrintf("BOOT:first_sample_ms=%lu,target_ms=%d,config=%s\r\n",
+                  (unsigned long)runtimeStats.bootMs, BOOT_TO_FIRST_SAMPLE_TARGET_MS,
+                  configStatusName(configStatus));
+  if (runtimeStats.bootMs > BOOT_TO_FIRST_SAMPLE_TARGET_MS) {
+    deviceLog("boot took %lu ms, over target", (unsigned long)runtimeStats.bootMs);
+  }
+}
+
+// Queued rather than printed so the banner does not hold up the first sample
+void printBanner() {
+  if (deviceConfig.mode == MODE_EOG) {
+    telemetryPrintf("=== EOG Cursor Mode Started ===\r\n");
+    telemetryPrintf("Channels: %d | Sample rate: %u Hz | Frames: JSON\r\n",
+                    EOG_CHANNELS, (unsigned)deviceConfig.sampleRate);
+  } else {
+    telemetryPrintf("=== EMG Local Classification Started ===\r\n");
+    telemetryPrintf("Processing EMG signals locally on ESP32\r\n");
+    telemetryPrintf("Tremor frequency: 4–6 Hz | Sample rate: %u Hz\r\n",
+                    (unsigned)deviceConfig.sampleRate);
+  }
+  telemetryPrintf("Type 'help' for console commands\r\n");
+}
+
+// Budget model of a mode at a candidate rate, window and PSD overlap
+cycle_budget::PipelineConfig pipelineFor(DeviceMode mode, uint16_t rate, uint16_t window,
+                                         uint8_t overlap = deviceConfig.psdOverlap) {
+  cycle_budget::PipelineConfig config = mode == MODE_EOG ? EOG_PIPELINE : TREMOR_PIPELINE;
+  config.sampleRate = rate;
+  if (mode == MODE_TREMOR) {
+    config.windowSize = window;
+    config.psdHop = welchHop(overlap) * welchDecimation(rate);
+    config.imuBusBytes = imuRateFor(rate) * IMU_FRAME_BYTES;
+    config.imuBurstBytes = imuBurstFrames(1000000UL / rate) * IMU_FRAME_BYTES;
+  }
+  return config;
+}
+
+// Context starts over unknown, with the tremor features running
+static void resetContext() {
+  motorContext.reset();
+  tremorPipeline.hold(false);
+  tremorPipeline.features.get<ContextWindowFeatures>().reset();
+}
+
+// Sensor rate, burst size and resampling follow the EMG rate
+static bool restartImu(ImuSource source = imuDevice.source) {
+  bool ok = imuDevice.begin(source, deviceConfig.sampleRate, micros());
+  imuSync.configure(imuDevice.rate, deviceConfig.sampleRate);
+  imuFeatures.reset();
+  tremorPipeline.features.get<ImuWindowFeatures>().reset();
+
+  // Read twice per burst's worth of frames, so the FIFO never backs up
+  uint32_t period = imuDevice.source == IMU_NONE
+                  ? IMU_IDLE_PERIOD_US
+                  : 500000UL * imuBurstFrames(samplePeriodUs) / imuDevice.rate;
+  schedulerSetPeriod(imuTask, period, period);
+  return ok;
+}
+
+bool applyMode(DeviceMode mode) {
+  if (!cycle_budget::withinBudget(
+          pipelineFor(mode, deviceConfig.sampleRate, deviceConfig.windowSize))) {
+    return false;
+  }
+
+  if (mode == MODE_EOG) {
+    for (int c = 0; c < EOG_CHANNELS; c++) {
+      pinMode(EOG_PINS[c], INPUT);
+    }
+    eogProcessor.begin(EOG_CHANNELS);
+  } else {
+    pinMode(EMG_PIN, INPUT);
+    pinMode(EXTENSOR_PIN, INPUT);
+    tremorPipeline.reset();
+    tremorQuality.reset();
+    extensorQuality.reset();
+    antagonist.reset();
+    resetContext();
+    restartImu();
+  }
+  if (mode != deviceConfig.mode) deviceLog("mode %s", mode == MODE_EOG ? "eog" : "tremor");
+  deviceConfig.mode = mode;
+  configMarkDirty(millis());
+  return true;
+}
+
+bool applySampleRate(uint16_t rate) {
+  if (rate < MIN_SAMPLE_RATE || rate > MAX_SAMPLE_RATE ||
+      !cycle_budget::withinBudget(
+          pipelineFor(deviceConfig.mode, rate, deviceConfig.windowSize))) {
+    return false;
+  }
+
+  if (rate != deviceConfig.sampleRate) deviceLog("rate %u Hz", (unsigned)rate);
+  deviceConfig.sampleRate = rate;
+  samplePeriodUs = 1000000UL / rate;
+  schedulerSetPeriod(sampleTask, samplePeriodUs, samplePeriodUs / 4);
+  schedulerSetPeriod(analysisTask, 0, samplePeriodUs);
+  tremorPipeline.setSampleRate(rate);
+  tremorQuality.setSampleRate(rate);
+  extensorQuality.setSampleRate(rate);
+  antagonist.setSampleRate(rate);
+  imuFeatures.setSampleRate(rate);
+  motorContext.setSampleRate(rate);
+  resetContext();
+  restartImu();
+  eogProcessor.setSampleRate(rate);
+  applyDisplay(deviceConfig.displayMode, deviceConfig.displayRate);
+  configMarkDirty(millis());
+  return true;
+}
+
+bool applyWindowSize(uint16_t window) {
+  if (window < MIN_WINDOW_SIZE || window > MAX_WINDOW_SIZE ||
+      !cycle_budget::withinBudget(
+          pipelineFor(MODE_TREMOR, deviceConfig.sampleRate, window))) {
+    return false;
+  }
+
+  if (window != deviceConfig.windowSize) deviceLog("window %u", (unsigned)window);
+  deviceConfig.windowSize = window;
+  tremorPipeline.windowSize = window;
+  tremorPipeline.reset();
+  // The motor context still holds; only the features start over
+  tremorPipeline.features.get<ContextWindowFeatures>().context = motorContext.context;
+  configMarkDirty(millis());
+  return true;
+}
+
+void applyThresholds() {
+  eogProcessor.detector.thresholdFactor = deviceConfig.saccadeFactor;
+  eogProcessor.detector.blinkVelocity = deviceConfig.blinkVelocity;
+  configMarkDirty(millis());
+}
+
+static void printChannelQuality(int channel, const SignalQuality& q) {
+  telemetryPrintf("QUALITY:%d,sqi=%.2f,flags=0x%02x,saturation=%.3f,flatline=%.3f,"
+                  "line=%.2f,hf=%.3f,offset=%.2f\r\n",
+                  channel, q.score, q.flags, q.metrics.saturation, q.metrics.flatline,
+                  q.metrics.lineRatio, q.metrics.hfNoise, q.metrics.offset);
+}
+
+void printSignalQuality() {
+  if (deviceConfig.mode == MODE_EOG) {
+    for (int c = 0; c < EOG_CHANNELS; c++) {
+      printChannelQuality(c, eogProcessor.quality[c]);
+    }
+  } else {
+    printChannelQuality(0, tremorQuality);
+    printChannelQuality(1, extensorQuality);
+  }
+}
+
+// Samples per bucket for a display rate; min-max sends two points a bucket
+int displayBucket(DisplayMode mode, uint16_t rate, uint16_t pointsPerSecond) {
+  int pointsPerBucket = mode == DISPLAY_MINMAX ? 2 : 1;
+  return (rate * pointsPerBucket + pointsPerSecond / 2) / pointsPerSecond;
+}
+
+bool applyDisplay(DisplayMode mode, uint16_t pointsPerSecond) {
+  if (pointsPerSecond == 0) return false;
+  int bucket = displayBucket(mode, deviceConfig.sampleRate, pointsPerSecond);
+  if (mode != DISPLAY_RAW && (bucket < 2 || bucket > DOWNSAMPLE_MAX_BUCKET)) return false;
+
+  if (mode != deviceConfig.displayMode || pointsPerSecond != deviceConfig.displayRate) {
+    deviceLog("display %d at %u points/s", (int)mode, (unsigned)pointsPerSecond);
   }
+  deviceConfig.displayMode = mode;
+  deviceConfig.displayRate = pointsPerSecond;
+  tremorPipeline.sink.setDisplay(mode, bucket);
+  configMarkDirty(millis());
+  return true;
 }
 
-void extractFeatures(float* signal, int length, float* features) {
-  // Calculate basic features
-  float sum = 0, sumSquares = 0, zeroCrossings = 0;
+bool applyPsd(uint8_t overlapPercent, uint8_t averages) {
+  if (overlapPercent > MAX_PSD_OVERLAP || averages < 1 || averages > MAX_PSD_AVERAGES ||
+      !cycle_budget::withinBudget(pipelineFor(MODE_TREMOR, deviceConfig.sampleRate,
+                                              deviceConfig.windowSize, overlapPercent))) {
+    return false;
+  }
+
+  if (overlapPercent != deviceConfig.psdOverlap || averages != deviceConfig.psdAverages) {
+    deviceLog("psd overlap %u%%, %u averages", (unsigned)overlapPercent, (unsigned)averages);
+  }
+  deviceConfig.psdOverlap = overlapPercent;
+  deviceConfig.psdAverages = averages;
+  tremorPipeline.features.get<WelchPsd>().configure(overlapPercent, averages);
+  configMarkDirty(millis());
+  return true;
+}
 
-  for (int i = 1; i < length; i++) {
-    sum += abs(signal[i]);
-    sumSquares += signal[i] * signal[i];
+void printPsd() {
+  const WelchPsd& psd = tremorPipeline.features.get<WelchPsd>();
+  telemetryPrintf("PSD:peak_hz=%.2f,share=%.2f,segments=%d,overlap=%u,averages=%d,"
+                  "bin_hz=%.2f,overruns=%lu\r\n",
+                  psd.peakHz, psd.concentration, psd.segments, (unsigned)deviceConfig.psdOverlap,
+                  psd.averages, psd.binHz, (unsigned long)psd.overruns);
+}
+
+bool applyImu(ImuSource source, float simulatedHz, float simulatedG) {
+  imuDevice.simulation.tremorHz = simulatedHz;
+  imuDevice.simulation.tremorG = simulatedG;
+  if (!restartImu(source)) return false;
+  deviceLog("imu %s at %u Hz", imuSourceName(source), (unsigned)imuDevice.rate);
+  return true;
+}
+
+void printImu() {
+  const float* axis = imuFeatures.axis;
+  telemetryPrintf("IMU:source=%s,rate=%u,frames=%lu,fifo_overflows=%lu,bus_errors=%lu,"
+                  "ratio=%.5f,fill=%.1f,underruns=%lu,overruns=%lu,segments=%d,"
+                  "axis=%.2f/%.2f/%.2f\r\n",
+                  imuSourceName(imuDevice.source), (unsigned)imuDevice.rate,
+                  (unsigned long)imuDevice.frames, (unsigned long)imuDevice.fifoOverflows,
+                  (unsigned long)imuDevice.busErrors, imuSync.ratio, imuSync.fillAverage,
+                  (unsigned long)imuSync.underruns, (unsigned long)imuSync.overruns,
+                  imuFeatures.segments, axis[0], axis[1], axis[2]);
+}
+
+void printContext() {
+  sendContext(motorContext);
+}
+
+void startAnomalyCalibration(uint16_t windows) {
+  anomalyDetector.startCalibration(windows);
+  deviceLog("anomaly calibration over %u windows", (unsigned)windows);
+}
+
+void printAnomaly() {
+  sendAnomalyModel(anomalyDetector, deviceConfig.anomalyThreshold);
+}
+
+bool enrollPrototype(uint8_t label) {
+  TremorClassifier& classifier = tremorPipeline.classifier;
+  if (!classifier.lastValid) return false;
+  classifier.table.add(classifier.lastVector, label);
+  prototypesMarkDirty(millis());
+  deviceLog("prototype %d enrolled, label %d", classifier.table.count, label);
+  return true;
+}
+
+void clearPrototypes() {
+  tremorPipeline.classifier.table.clear();
+  prototypesMarkDirty(millis());
+  deviceLog("prototypes cleared");
+}
+
+// PROTOTYPES:count,capacity,normal,mild,moderate,severe,nearest
+void printPrototypes() {
+  const TremorClassifier& classifier = tremorPipeline.classifier;
+  const PrototypeTable& table = classifier.table;
+  telemetryPrintf("PROTOTYPES:%d,%d,%d,%d,%d,%d,%.2f\r\n", table.count, PROTOTYPE_CAPACITY,
+                  table.countLabel(NORMAL), table.countLabel(MILD), table.countLabel(MODERATE),
+                  table.countLabel(SEVERE), classifier.nearestDistance);
+}
 
-    if ((signal[i-1] > 0 && signal[i] < 0) || (signal[i-1] < 0 && signal[i] > 0)) {
-      zeroCrossings++;
+bool applyConfig(const DeviceConfig& config) {
+  memcpy(deviceConfig.freqThresholds, config.freqThresholds, sizeof(config.freqThresholds));
+  memcpy(deviceConfig.postureFreqThresholds, config.postureFreqThresholds,
+         sizeof(config.postureFreqThresholds));
+  memcpy(deviceConfig.movementFreqThresholds, config.movementFreqThresholds,
+         sizeof(config.movementFreqThresholds));
+  memcpy(deviceConfig.ampThresholds, config.ampThresholds, sizeof(config.ampThresholds));
+  deviceConfig.saccadeFactor = config.saccadeFactor;
+  deviceConfig.blinkVelocity = config.blinkVelocity;
+  deviceConfig.anomalyThreshold = config.anomalyThreshold;
+  applyThresholds();
+
+  // Mode first: its budget is checked at the current (default) rate
+  bool ok = applyMode(config.mode);
+  ok = applySampleRate(config.sampleRate) && ok;
+  ok = applyWindowSize(config.windowSize) && ok;
+  ok = applyDisplay(config.displayMode, config.displayRate) && ok;
+  ok = applyPsd(config.psdOverlap, config.psdAverages) && ok;
+  return ok;
+}
+
+void sampleTremor() {
+  // Read, filter, accumulate and classify
+  int raw = analogRead(EMG_PIN);
+  int extensorRaw = analogRead(EXTENSOR_PIN);
+  captureSample(raw);
+  tremorQuality.push(raw);
+  extensorQuality.push(extensorRaw);
+  tremorPipeline.sink.sqi = tremorQuality.score;
+
+  bool windowReady = tremorPipeline.push(raw);
+  AdcToVolts<>& volts = tremorPipeline.calibration;
+  float flexorVolts = volts.process(raw);
+  bool segmentReady = antagonist.push(flexorVolts, volts.process(extensorRaw));
+
+  // Acceleration resampled to this tick, once the sensor queue has filled
+  float accel[3];
+  bool hasAccel = imuDevice.source != IMU_NONE && imuSync.next(accel);
+  if (hasAccel) {
+    segmentReady = imuFeatures.push(flexorVolts, accel) || segmentReady;
+  }
+
+  // Tremor features pause through vigorous movement
+  if (motorContext.push(flexorVolts, hasAccel ? accel : nullptr)) {
+    tremorPipeline.hold(motorContext.context == CONTEXT_VIGOROUS);
+    tremorPipeline.features.get<ContextWindowFeatures>().context = motorContext.context;
+    sendContext(motorContext);
+  }
+  if (windowReady || segmentReady) schedulerSignal(analysisTask);
+}
+
+void sampleEog() {
+  float volts[EOG_MAX_CHANNELS];
+  for (int c = 0; c < EOG_CHANNELS; c++) {
+    int raw = analogRead(EOG_PINS[c]);
+    if (c == 0) captureSample(raw);
+    eogProcessor.quality[c].push(raw);
+    volts[c] = eogCalibration.process(raw);
+  }
+
+  // Events go out ahead of the periodic frame that also carries them
+  EogFrame frame;
+  EogEventRecord event;
+  bool frameReady = eogProcessor.push(volts, millis(), frame);
+  if (eogProcessor.takeEvent(event)) {
+    runtimeStats.events++;
+    sendEogEvent(event, minimumSqi(eogProcessor.quality, EOG_CHANNELS));
+  }
+  if (frameReady) {
+    sendEogFrame(frame);
+  }
+}
+
+void TremorSerialSink::setDisplay(DisplayMode mode, int bucketSize) {
+  displayMode = mode;
+  minMax.bucketSize = bucketSize;
+  lttb.bucketSize = bucketSize;
+  minMax.reset();
+  lttb.reset();
+}
+
+void TremorSerialSink::onSample(float voltage, float filtered) {
+  DisplayPoint points[2];
+  int count = 0;
+
+  switch (displayMode) {
+    case DISPLAY_RAW:
+      // Print real-time values for Python parsing
+      telemetryPrintf("%.3f,%.3f,%.2f\r\n", voltage, filtered, sqi);
+      return;
+    case DISPLAY_MINMAX:
+      count = minMax.push(filtered, points);
+      break;
+    case DISPLAY_LTTB:
+      count = lttb.push(filtered, points[0]) ? 1 : 0;
+      break;
+  }
+  for (int i = 0; i < count; i++) {
+    telemetryPrintf("DISPLAY:%lu,%.3f,%.2f\r\n", (unsigned long)points[i].index, points[i].value, sqi);
+  }
+}
+
+// Calibration windows, or the window's distance from them
+static void checkAnomaly(TremorClass classification, const float* features) {
+  float vector[ANOMALY_FEATURES];
+  prototypeVector(features, vector);
+  if (anomalyDetector.calibrating()) {
+    if (anomalyDetector.calibrate(vector)) {
+      anomalyModelMarkDirty(millis());
+      printAnomaly();
+    } else if (!anomalyDetector.calibrating()) {
+      deviceLog("anomaly calibration failed, previous model kept");
     }
+    return;
+  }
+  AnomalyEvent event;
+  if (anomalyDetector.check(vector, classification, deviceConfig.anomalyThreshold, millis(),
+                            event)) {
+    sendAnomaly(event, TREMOR_CLASS_NAMES);
   }
+}
 
-  float meanAmp = sum / length;
-  float rms = sqrt(sumSquares / length);
-  float zcr = zeroCrossings / length;
+void TremorSerialSink::onWindow(TremorClass classification, float* features) {
+  runtimeStats.windows++;
+  checkAnomaly(classification, features);
 
-  // Improved dominant frequency calculation using zero-crossings
-  float domFreq = 0;
-  if (zcr > 0) {
-    domFreq = (SAMPLE_RATE / (2 * length)) * zeroCrossings;  // More accurate for EMG
+  // Update classification if changed, or when the signal came back
+  if (classification != currentClassification || poorSignal) {
+    currentClassification = classification;
+    poorSignal = false;
+    printClassification(classification, features, sqi);
   }
+}
+
+void TremorSerialSink::onPoorSignal(uint8_t flags) {
+  if (poorSignal) return;
+  poorSignal = true;
+
+  // Same record shape, so consumers see the state change and can drop it
+  telemetryPrintf("=== POOR SIGNAL: check electrodes (flags 0x%02x) ===\r\n", flags);
+  reliablePrintf("CLASSIFICATION:POOR_SIGNAL,0.00,0.00,0.00,%.2f\r\n", sqi);
+}
 
-  features[0] = meanAmp;  // Mean amplitude
-  features[1] = rms;     // RMS amplitude
-  features[2] = zcr;     // Zero crossing rate
-  features[3] = domFreq; // Dominant frequency
+// Frequency boundaries for the context a window was recorded in; rest
+// and an unknown context use the original set
+static const float* frequencyThresholds(MotorContext context) {
+  switch (context) {
+    case CONTEXT_POSTURE:
+      return deviceConfig.postureFreqThresholds;
+    case CONTEXT_MOVEMENT:
+    case CONTEXT_VIGOROUS:
+      return deviceConfig.movementFreqThresholds;
+    default:
+      return deviceConfig.freqThresholds;
+  }
 }
 
 TremorClass classifyFromFeatures(float* features) {
-  float meanAmp = features[0];
-  float rms = features[1];
-  float zcr = features[2];
-  float domFreq = features[3];
+  float domFreq = dominantFrequency(features);
+  const float* thresholds = frequencyThresholds((MotorContext)features[FEATURE_MOTOR_CONTEXT]);
 
-  // Rule-based classification (frequency-based)
-  if (domFreq < FREQ_THRESHOLDS[0]) {
+  // Rule-based classification (frequency-based), once the spectrum
+  // shows something periodic; before the first segment, frequency only
+  if (features[FEATURE_PEAK_FREQUENCY] > 0 && !periodicSignature(features)) {
+    return NORMAL;
+  } else if (features[FEATURE_ACCEL_FREQUENCY] > 0 && !mechanicalSignature(features, domFreq)) {
+    return NORMAL;  // EMG rhythm the limb does not follow: effort, not tremor
+  } else if (domFreq < thresholds[0]) {
     return NORMAL;
-  } else if (domFreq < FREQ_THRESHOLDS[1]) {
+  } else if (domFreq < thresholds[1]) {
     return MILD;
-  } else if (domFreq <= FREQ_THRESHOLDS[2]) {
+  } else if (domFreq <= thresholds[2]) {
     return SEVERE;
   } else {
     return NORMAL;  // Default to normal for noise
   }
 }
 
-void printClassification(TremorClass classification, float* features) {
-  const char* classNames[] = {"NORMAL", "MILD", "SEVERE"};
+void printClassification(TremorClass classification, float* features, float sqi) {
+  const char* context = motorContextName((MotorContext)features[FEATURE_MOTOR_CONTEXT]);
 
-  Serial.println("=== TREMOR CLASSIFICATION ===");
-  Serial.print("Classification: ");
-  Serial.println(classNames[classification]);
-  Serial.print("Mean Amplitude: ");
-  Serial.println(features[0], 2);
-  Serial.print("RMS: ");
-  Serial.println(features[1], 2);
-  Serial.print("Zero Crossing Rate: ");
-  Serial.println(features[2], 3);
-  Serial.print("Dominant Frequency: ");
-  Serial.println(features[3], 2);
-  Serial.println("Confidence: HIGH (Local Classification)");
-  Serial.println("==========================");
+  telemetryPrintf("=== TREMOR CLASSIFICATION ===\r\n");
+  telemetryPrintf("Classification: %s\r\n", TREMOR_CLASS_NAMES[classification]);
+  telemetryPrintf("Mean Amplitude: %.2f\r\n", features[FEATURE_MEAN_AMPLITUDE]);
+  telemetryPrintf("RMS: %.2f\r\n", features[FEATURE_RMS]);
+  telemetryPrintf("Zero Crossing Rate: %.3f\r\n", features[FEATURE_ZERO_CROSSING_RATE]);
+  telemetryPrintf("Dominant Frequency: %.2f\r\n", dominantFrequency(features));
+  telemetryPrintf("Spectral Peak Share: %.2f\r\n", features[FEATURE_PEAK_CONCENTRATION]);
+  telemetryPrintf("Harmonics: %.0f (f0 %.2f Hz, H2/F %.2f, H3/F %.2f)\r\n",
+                  features[FEATURE_HARMONIC_COUNT], features[FEATURE_FUNDAMENTAL],
+                  features[FEATURE_SECOND_HARMONIC], features[FEATURE_THIRD_HARMONIC]);
+  if (features[FEATURE_ACCEL_FREQUENCY] > 0) {
+    telemetryPrintf("Acceleration: %.2f Hz, %.3f g RMS, EMG coherence %.2f\r\n",
+                    features[FEATURE_ACCEL_FREQUENCY], features[FEATURE_ACCEL_AMPLITUDE],
+                    features[FEATURE_EMG_ACCEL_COHERENCE]);
+  }
+  telemetryPrintf("Context: %s\r\n", context);
+  const TremorClassifier& classifier = tremorPipeline.classifier;
+  if (classifier.table.count > 0) {
+    telemetryPrintf("Prototypes: %d enrolled, nearest %.2f%s\r\n", classifier.table.count,
+                    classifier.nearestDistance,
+                    classifier.patientSpecific ? " (patient-specific)" : "");
+  }
+#ifdef TREMOR_NAIVE_BAYES
+  const float* logP = classifier.global.logProbabilities;
+  telemetryPrintf("Log Probabilities: normal %.2f, mild %.2f, moderate %.2f, severe %.2f\r\n",
+                  logP[NORMAL], logP[MILD], logP[MODERATE], logP[SEVERE]);
+#endif
+  telemetryPrintf("Signal Quality: %.2f\r\n", sqi);
+#ifdef TREMOR_NAIVE_BAYES
+  telemetryPrintf("Confidence: %.2f (Naive Bayes)\r\n", expf(logP[classification]));
+#else
+  telemetryPrintf("Confidence: HIGH (Local Classification)\r\n");
+#endif
+  telemetryPrintf("==========================\r\n");
 
   // Send to dashboard via Serial (format for easy parsing)
-  Serial.print("CLASSIFICATION:");
-  Serial.print(classNames[classification]);
-  Serial.print(",");
-  Serial.print(features[3], 2);  // Frequency
-  Serial.print(",");
-  Serial.print(features[0], 2);  // Amplitude
-  Serial.print(",");
-  Serial.println(features[1], 2); // RMS
+  reliablePrintf("CLASSIFICATION:%s,%.2f,%.2f,%.2f,%.2f,%s\r\n",
+                 TREMOR_CLASS_NAMES[classification],
+                 dominantFrequency(features),       // Frequency
+                 features[FEATURE_MEAN_AMPLITUDE],  // Amplitude
+                 features[FEATURE_RMS],             // RMS
+                 sqi,                               // Signal quality
+                 context);                          // Motor context
 }
@@ -0,0 +1,160 @@
+/*
+  Static Memory Budget
+  Scratch arena leases, the after-setup heap watch and the memory report.
+*/
+
+#include <Arduino.h>
+
+#include "diagnostics.h"
+#include "memory_budget.h"
+#include "telemetry.h"
+
+static const char* const SCRATCH_NAMES[] = {"free", "capture", "update"};
+
+alignas(8) static uint8_t scratch[MEMORY_SCRATCH_BYTES];
+static ScratchUser scratchUser = SCRATCH_FREE;
+
+static volatile bool sealed = false;
+static volatile uint32_t exemptDepth = 0;
+static volatile uint32_t allocations = 0;  // after setup, not exempt
+static volatile uint32_t lastBytes = 0;
+static volatile uint32_t lastCaller = 0;
+static uint32_t allocationsLogged = 0;
+
+// Section bounds from the IDF linker script
+extern "C" uint8_t _data_start, _data_end, _bss_start, _bss_end;
+
+void* scratchAcquire(ScratchUser user) {
+  if (scratchUser != SCRATCH_FREE && scratchUser != user) return nullptr;
+  scratchUser = user;
+  return scratch;
+}
+
+void scratchRelease(ScratchUser user) {
+  if (scratchUser == user) scratchUser = SCRATCH_FREE;
+}
+
+ScratchUser scratchOwner() {
+  return scratchUser;
+}
+
+void memorySeal() {
+  sealed = true;
+}
+
+void memoryExemptBegin() {
+  exemptDepth++;
+}
+
+void memoryExemptEnd() {
+  exemptDepth--;
+}
+
+uint32_t heapAllocationsAfterSetup() {
+  return allocations;
+}
+
+// Any task or core may allocate, so only atomic updates and no logging here
+static void noteAllocation(size_t bytes, void* caller) {
+  if (!sealed || exemptDepth > 0) return;
+  __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+  lastBytes = bytes;
+  // Windowed-ABI return addresses carry the call size in the top two bits
+  lastCaller = ((uint32_t)(uintptr_t)caller & 0x3FFFFFFFUL) | 0x40000000UL;
+}
+
+// Linked in place of the C allocators by -Wl,--wrap (platformio.ini); new
+// and the C++ library allocate through these too, newlib's stdio through
+// the _r forms and IDF drivers through heap_caps. --wrap only redirects
+// calls between objects, so malloc reaching heap_caps inside the IDF's
+// heap component is not counted twice.
+extern "C" {
+void* __real_malloc(size_t bytes);
+void* __real_calloc(size_t count, size_t bytes);
+void* __real_realloc(void* pointer, size_t bytes);
+void* __real__malloc_r(struct _reent* reent, size_t bytes);
+void* __real__calloc_r(struct _reent* reent, size_t count, size_t bytes);
+void* __real__realloc_r(struct _reent* reent, void* pointer, size_t bytes);
+void* __real_heap_caps_malloc(size_t bytes, uint32_t caps);
+void* __real_heap_caps_calloc(size_t count, size_t bytes, uint32_t caps);
+void* __real_heap_caps_realloc(void* pointer, size_t bytes, uint32_t caps);
+
+void* __wrap_malloc(size_t bytes) {
+  noteAllocation(bytes, __builtin_return_address(0));
+  return __real_malloc(bytes);
+}
+
+void* __wrap_calloc(size_t count, size_t bytes) {
+  noteAllocation(count * bytes, __builtin_return_address(0));
+  return __real_calloc(count, bytes);
+}
+
+void* __wrap_realloc(void* pointer, size_t bytes) {
+  noteAllocation(bytes, __builtin_return_address(0));
+  return __real_realloc(pointer, bytes);
+}
+
+void* __wrap__malloc_r(struct _reent* reent, size_t bytes) {
+  noteAllocation(bytes, __builtin_return_address(0));
+  return __real__malloc_r(reent, bytes);
+}
+
+void* __wrap__calloc_r(struct _reent* reent, size_t count, size_t bytes) {
+  noteAllocation(count * bytes, __builtin_return_address(0));
+  return __real__calloc_r(reent, count, bytes);
+}
+
+void* __wrap__realloc_r(struct _reent* reent, void* pointer, size_t bytes) {
+  noteAllocation(bytes, __builtin_return_address(0));
+  return __real__realloc_r(reent, pointer, bytes);
+}
+
+void* __wrap_heap_caps_malloc(size_t bytes, uint32_t caps) {
+  noteAllocation(bytes, __builtin_return_address(0));
+  return __real_heap_caps_malloc(bytes, caps);
+}
+
+void* __wrap_heap_caps_calloc(size_t count, size_t bytes, uint32_t caps) {
+  noteAllocation(count * bytes, __builtin_return_address(0));
+  return __real_heap_caps_calloc(count, bytes, caps);
+}
+
+void* __wrap_heap_caps_realloc(void* pointer, size_t bytes, uint32_t caps) {
+  noteAllocation(bytes, __builtin_return_address(0));
+  return __real_heap_caps_realloc(pointer, bytes, caps);
+}
+}
+
+void memoryService() {
+  uint32_t count = allocations;
+  if (count == allocationsLogged) return;
+  deviceLog("heap: %lu allocations after setup, last %lu bytes from 0x%08lx",
+            (unsigned long)count, (unsigned long)lastBytes, (unsigned long)lastCaller);
+  allocationsLogged = count;
+}
+
+void printMemory() {
+  const MemoryRegion* regions[] = {&tremorMemory,      &imuMemory,       &eogMemory,
+                                   &telemetryMemory,   &reliableMemory,  &diagnosticsMemory,
+                                   &schedulerMemory,   &updateMemory};
+  uint32_t total = MEMORY_SCRATCH_BYTES;
+  for (const MemoryRegion* region : regions) {
+    telemetryPrintf("MEM:%s,bytes=%lu,budget=%lu\r\n", region->name,
+                    (unsigned long)region->bytes, (unsigned long)region->budget);
+    total += region->bytes;
+  }
+  telemetryPrintf("MEM:scratch,bytes=%d,budget=%d,owner=%s\r\n", MEMORY_SCRATCH_BYTES,
+                  MEMORY_SCRATCH_BYTES, SCRATCH_NAMES[scratchUser]);
+  // data and bss include the core's and the IDF's own statics
+  telemetryPrintf("MEM:static,budgeted=%lu,budget=%d,data=%lu,bss=%lu\r\n", (unsigned long)total,
+                  MEMORY_STATIC_BUDGET, (unsigned long)(&_data_end - &_data_start),
+                  (unsigned long)(&_bss_end - &_bss_start));
+  telemetryPrintf("MEM:heap,size=%lu,free=%lu,min_free=%lu,largest=%lu\r\n",
+                  (unsigned long)ESP.getHeapSize(), (unsigned long)ESP.getFreeHeap(),
+                  (unsigned long)ESP.getMinFreeHeap(), (unsigned long)ESP.getMaxAllocHeap());
+  telemetryPrintf("MEM:psram,size=%lu,free=%lu\r\n", (unsigned long)ESP.getPsramSize(),
+                  (unsigned long)ESP.getFreePsram());
+  telemetryPrintf("MEM:after_setup,allocations=%lu,last_bytes=%lu,last_caller=0x%08lx\r\n",
+                  (unsigned long)allocations, (unsigned long)lastBytes,
+                  (unsigned long)lastCaller);
+}
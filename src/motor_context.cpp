@@ -0,0 +1,116 @@
+/*
+  Motor Context
+  Block metrics, adaptive rest floor and the context decision.
+*/
+
+#include <math.h>
+
+#include "motor_context.h"
+#include "telemetry.h"
+
+const char* motorContextName(MotorContext context) {
+  switch (context) {
+    case CONTEXT_UNKNOWN: return "UNKNOWN";
+    case CONTEXT_REST: return "REST";
+    case CONTEXT_POSTURE: return "POSTURE";
+    case CONTEXT_MOVEMENT: return "MOVEMENT";
+    case CONTEXT_VIGOROUS: return "VIGOROUS";
+  }
+  return "UNKNOWN";
+}
+
+void MotorContextEstimator::setSampleRate(float fs) {
+  envelope.setSampleRate(fs);
+  for (int i = 0; i < 3; i++) accelFilters[i].setSampleRate(fs);
+  subBlockSize = (int)(fs * CONTEXT_SUBBLOCK_MS / 1000 + 0.5f);
+  if (subBlockSize < 1) subBlockSize = 1;
+  blockSubBlocks = CONTEXT_BLOCK_MS / CONTEXT_SUBBLOCK_MS;
+  smoothing = 1 - expf(-(float)subBlockSize / (CONTEXT_SMOOTHING_S * fs));
+  averaging = 1 - expf(-(float)subBlockSize / (CONTEXT_MODULATION_S * fs));
+  reset();
+}
+
+void MotorContextEstimator::reset() {
+  envelope.reset();
+  for (int i = 0; i < 3; i++) accelFilters[i].reset();
+  sampleCount = 0;
+  subBlockSum = 0;
+  subBlocks = 0;
+  accelSquares = 0;
+  accelSamples = 0;
+  accelPrimed = false;
+  primed = false;
+  metrics = {0, 0, 0, -1};
+  context = candidate = CONTEXT_UNKNOWN;
+  candidateBlocks = 0;
+}
+
+bool MotorContextEstimator::endSubBlock() {
+  float mean = subBlockSum / sampleCount;
+  sampleCount = 0;
+  subBlockSum = 0;
+
+  if (subBlocks == 0 || mean < tonic) tonic = mean;
+  slow += smoothing * (mean - slow);
+  float deviation = slow - slowMean;
+  slowMean += averaging * deviation;
+  slowVariance += averaging * (deviation * deviation - slowVariance);
+  if (++subBlocks < blockSubBlocks) return false;
+
+  // Block complete: the envelope filters settle within the first one
+  metrics.tonic = tonic;
+  metrics.modulation = slowMean > 0 ? sqrtf(slowVariance) / slowMean : 0;
+  metrics.movementG = accelSamples > 0 ? sqrtf(accelSquares / accelSamples) : -1;
+  subBlocks = 0;
+  accelSquares = 0;
+  accelSamples = 0;
+  if (!primed) {
+    // Statistics start from the settled envelope
+    primed = true;
+    metrics.restFloor = tonic;
+    slow = slowMean = mean;
+    slowVariance = 0;
+    return false;
+  }
+
+  // Falls straight to a quieter block, rises only slowly
+  metrics.restFloor = tonic < metrics.restFloor ? tonic
+                                                : metrics.restFloor * (1 + CONTEXT_FLOOR_RISE);
+
+  MotorContext next = decide();
+  if (next == context) {
+    candidateBlocks = 0;
+    return false;
+  }
+  if (next != candidate) {
+    candidate = next;
+    candidateBlocks = 0;
+  }
+  if (++candidateBlocks < CONTEXT_HOLD_BLOCKS) return false;
+  context = next;
+  candidateBlocks = 0;
+  return true;
+}
+
+MotorContext MotorContextEstimator::decide() const {
+  float floor = metrics.restFloor > CONTEXT_FLOOR_MIN_V ? metrics.restFloor : CONTEXT_FLOOR_MIN_V;
+  float ratio = metrics.tonic / floor;
+  bool modulated = metrics.modulation > CONTEXT_MOVEMENT_CV;
+  bool hasAccel = metrics.movementG >= 0;
+
+  if ((hasAccel && metrics.movementG > CONTEXT_VIGOROUS_G) ||
+      (modulated && ratio > CONTEXT_VIGOROUS_RATIO)) {
+    return CONTEXT_VIGOROUS;
+  }
+  if ((hasAccel && metrics.movementG > CONTEXT_MOVEMENT_G) ||
+      (modulated && ratio > CONTEXT_ACTIVE_RATIO)) {
+    return CONTEXT_MOVEMENT;
+  }
+  return ratio > CONTEXT_ACTIVE_RATIO ? CONTEXT_POSTURE : CONTEXT_REST;
+}
+
+void sendContext(const MotorContextEstimator& estimator) {
+  const ContextMetrics& m = estimator.metrics;
+  telemetryPrintf("CONTEXT:%s,%.4f,%.4f,%.2f,%.3f\r\n", motorContextName(estimator.context),
+                  m.tonic, m.restFloor, m.modulation, m.movementG);
+}
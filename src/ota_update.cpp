@@ -0,0 +1,452 @@
+/*
+  Firmware Update over the Telemetry Link
+  Manifest check, block inflate and flash writes, read-back verification,
+  and the trial boot with rollback.
+*/
+
+#include <Arduino.h>
+#include <esp32/rom/miniz.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <string.h>
+
+#include "config_store.h"
+#include "diagnostics.h"
+#include "memory_budget.h"
+#include "ota_key.h"
+#include "ota_update.h"
+#include "telemetry.h"
+
+enum OtaState : uint8_t {
+  OTA_IDLE,
+  OTA_CHECKING,   // manifest received: signature and resume point
+  OTA_RECEIVING,  // waiting for block progress.nextBlock
+  OTA_WRITING,    // a block received: inflate, erase, write
+  OTA_VERIFYING,  // reading the image back through SHA-256
+  OTA_VERIFIED,
+  OTA_RESTARTING,
+  OTA_TRIAL,      // running a new image that is not confirmed yet
+};
+
+enum WriteStep : uint8_t { STEP_INFLATE, STEP_ERASE, STEP_WRITE };
+
+static const char* const STATE_NAMES[] = {"idle",      "checking", "receiving",  "writing",
+                                          "verifying", "verified", "restarting", "trial"};
+
+static OtaState state = OTA_IDLE;
+static OtaState stateBeforeCheck = OTA_IDLE;
+static OtaProgress progress;
+static bool progressOpen = false;  // progress describes an image being received
+static const esp_partition_t* target = nullptr;
+static const esp_partition_t* updatePartition = nullptr;  // looked up once, in setup
+static uint32_t stateSince = 0;    // restart requested, or trial boot started
+
+// ~19 KB, mostly the inflater: leased from the scratch arena while an
+// image is being received, checked, written or verified
+struct OtaScratch {
+  uint8_t chunk[OTA_CHUNK_MAX];   // payload as received
+  uint8_t block[OTA_BLOCK_SIZE];  // inflated block, or flash read back
+  tinfl_decompressor inflater;
+};
+static OtaScratch* work = nullptr;
+static mbedtls_sha256_context hash;
+
+static_assert(sizeof(OtaScratch) <= MEMORY_SCRATCH_BYTES,
+              "update buffers do not fit the scratch arena");
+constexpr MemoryRegion updateMemory = {"update", sizeof(progress) + sizeof(hash),
+                                       MEMORY_BUDGET_UPDATE};
+static_assert(updateMemory.bytes <= updateMemory.budget,
+              "update state exceeds its memory budget");
+
+static OtaPayload expectedKind = OTA_PAYLOAD_MANIFEST;
+static uint32_t expectedIndex = 0;
+static uint32_t expectedCrc = 0;
+static bool payloadDropped = false;  // arrived while chunk was still in use
+static uint16_t chunkLength = 0;
+
+static WriteStep step = STEP_INFLATE;
+static uint32_t blockLength = 0;  // inflated length of the block being written
+static uint32_t written = 0;
+static uint32_t verified = 0;
+
+// The core marks a new image valid before setup(); confirm() does it once it has sampled
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+// The scratch lease follows the state: held from a manifest until verified
+static void holdScratch() {
+  bool working = state == OTA_CHECKING || state == OTA_RECEIVING || state == OTA_WRITING ||
+                 state == OTA_VERIFYING;
+  if (!working && work) {
+    scratchRelease(SCRATCH_UPDATE);
+    work = nullptr;
+  }
+}
+
+static void enter(OtaState next) {
+  state = next;
+  holdScratch();
+}
+
+static const esp_partition_t* partitionAt(uint32_t address) {
+  esp_partition_iterator_t it =
+      esp_partition_find(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, nullptr);
+  while (it) {
+    const esp_partition_t* partition = esp_partition_get(it);
+    if (partition->address == address) {
+      esp_partition_iterator_release(it);
+      return partition;
+    }
+    it = esp_partition_next(it);  // releases the iterator at the end
+  }
+  return nullptr;
+}
+
+static bool signatureValid(const OtaManifest& m) {
+  uint8_t digest[32];
+  mbedtls_sha256_ret((const uint8_t*)&m, OTA_SIGNED_BYTES, digest, 0);
+  // Key parsing and ECDSA work on the heap, once per update
+  memoryExemptBegin();
+  mbedtls_pk_context key;
+  mbedtls_pk_init(&key);
+  bool valid = mbedtls_pk_parse_public_key(&key, (const uint8_t*)OTA_PUBLIC_KEY_PEM,
+                                           sizeof(OTA_PUBLIC_KEY_PEM)) == 0 &&
+               mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest), m.signature,
+                                 m.signatureLength) == 0;
+  mbedtls_pk_free(&key);
+  memoryExemptEnd();
+  return valid;
+}
+
+static void checkFailed(const char* reason) {
+  telemetryPrintf("ERR ota begin: %s\r\n", reason);
+  enter(stateBeforeCheck);
+}
+
+// Signature, then where to continue: the saved block for the same image
+static void checkManifest() {
+  OtaManifest m;
+  if (chunkLength != sizeof(m) || crc32(work->chunk, chunkLength) != expectedCrc) {
+    checkFailed("crc or length mismatch");
+    return;
+  }
+  memcpy(&m, work->chunk, sizeof(m));
+  if (m.magic != OTA_MANIFEST_MAGIC || m.version != OTA_MANIFEST_VERSION ||
+      m.blockSize != OTA_BLOCK_SIZE || m.imageSize == 0 ||
+      m.blockCount != (m.imageSize + OTA_BLOCK_SIZE - 1) / OTA_BLOCK_SIZE ||
+      m.signatureLength > OTA_SIGNATURE_MAX) {
+    checkFailed("bad manifest");
+    return;
+  }
+  const esp_partition_t* next = updatePartition;
+  if (!next || m.imageSize > next->size) {
+    checkFailed("image does not fit the update partition");
+    return;
+  }
+  if (sizeof(OTA_PUBLIC_KEY_PEM) <= 1) {
+    checkFailed("no signing key in this build");
+    return;
+  }
+  if (!signatureValid(m)) {
+    checkFailed("bad signature");
+    return;
+  }
+
+  bool resume = progressOpen && memcmp(progress.sha256, m.sha256, sizeof(m.sha256)) == 0 &&
+                progress.imageSize == m.imageSize && progress.target == next->address;
+  if (!resume) {
+    memset(&progress, 0, sizeof(progress));
+    memcpy(progress.sha256, m.sha256, sizeof(m.sha256));
+    progress.imageSize = m.imageSize;
+    progress.blockCount = m.blockCount;
+    progress.target = next->address;
+    progress.phase = OTA_PHASE_RECEIVING;
+    otaProgressSave(progress);
+  }
+  target = next;
+  progressOpen = true;
+  enter(progress.phase == OTA_PHASE_VERIFIED ? OTA_VERIFIED : OTA_RECEIVING);
+  deviceLog("update %s at block %lu of %lu", resume ? "resumed" : "started",
+            (unsigned long)progress.nextBlock, (unsigned long)progress.blockCount);
+  telemetryPrintf("OK ota begin next=%lu blocks=%lu\r\n", (unsigned long)progress.nextBlock,
+                  (unsigned long)progress.blockCount);
+}
+
+static void blockFailed(const char* reason) {
+  telemetryPrintf("ERR ota block %lu: %s\r\n", (unsigned long)expectedIndex, reason);
+  enter(OTA_RECEIVING);
+}
+
+// Inflate, erase its sector, then write it a piece per pass
+static void writeStep() {
+  size_t offset = (size_t)expectedIndex * OTA_BLOCK_SIZE;
+  if (step == STEP_INFLATE) {
+    if (crc32(work->chunk, chunkLength) != expectedCrc) {
+      blockFailed("crc mismatch");
+      return;
+    }
+    if (expectedIndex != progress.nextBlock) {
+      telemetryPrintf("ERR ota block %lu: expected %lu\r\n", (unsigned long)expectedIndex,
+                      (unsigned long)progress.nextBlock);
+      enter(OTA_RECEIVING);
+      return;
+    }
+    blockLength = progress.imageSize - offset < OTA_BLOCK_SIZE ? progress.imageSize - offset
+                                                                : OTA_BLOCK_SIZE;
+    size_t inSize = chunkLength, outSize = OTA_BLOCK_SIZE;
+    tinfl_init(&work->inflater);
+    tinfl_status status =
+        tinfl_decompress(&work->inflater, work->chunk, &inSize, work->block, work->block,
+                         &outSize, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    if (status != TINFL_STATUS_DONE || outSize != blockLength) {
+      blockFailed("inflate failed");
+      return;
+    }
+    step = STEP_ERASE;
+  } else if (step == STEP_ERASE) {
+    if (esp_partition_erase_range(target, offset, OTA_BLOCK_SIZE) != ESP_OK) {
+      blockFailed("erase failed");
+      return;
+    }
+    written = 0;
+    step = STEP_WRITE;
+  } else {
+    uint32_t piece = blockLength - written < OTA_WRITE_PIECE ? blockLength - written
+                                                             : OTA_WRITE_PIECE;
+    if (esp_partition_write(target, offset + written, work->block + written, piece) != ESP_OK) {
+      blockFailed("write failed");
+      return;
+    }
+    written += piece;
+    if (written < blockLength) return;
+
+    progress.nextBlock++;
+    if (progress.nextBlock % OTA_SAVE_BLOCKS == 0 || progress.nextBlock == progress.blockCount) {
+      otaProgressSave(progress);
+    }
+    telemetryPrintf("OK ota block %lu\r\n", (unsigned long)expectedIndex);
+    enter(OTA_RECEIVING);
+  }
+}
+
+// Hash one block of what is in flash, the way the bootloader will read it
+static void verifyStep() {
+  uint32_t piece = progress.imageSize - verified < OTA_BLOCK_SIZE ? progress.imageSize - verified
+                                                                  : OTA_BLOCK_SIZE;
+  if (esp_partition_read(target, verified, work->block, piece) != ESP_OK) {
+    mbedtls_sha256_free(&hash);
+    telemetryPrintf("ERR ota finish: read failed\r\n");
+    enter(OTA_RECEIVING);
+    return;
+  }
+  mbedtls_sha256_update_ret(&hash, work->block, piece);
+  verified += piece;
+  if (verified < progress.imageSize) return;
+
+  uint8_t digest[32];
+  mbedtls_sha256_finish_ret(&hash, digest);
+  mbedtls_sha256_free(&hash);
+  if (memcmp(digest, progress.sha256, sizeof(digest)) != 0) {
+    // Written blocks are untrustworthy: start over
+    progress.nextBlock = 0;
+    otaProgressSave(progress);
+    deviceLog("update hash mismatch");
+    telemetryPrintf("ERR ota finish: image hash mismatch, resend from block 0\r\n");
+    enter(OTA_RECEIVING);
+    return;
+  }
+  progress.phase = OTA_PHASE_VERIFIED;
+  otaProgressSave(progress);
+  telemetryPrintf("OK ota finish: image verified\r\n");
+  enter(OTA_VERIFIED);
+}
+
+static void confirm() {
+#ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+  memoryExemptBegin();  // rewrites the OTA data partition
+  esp_ota_mark_app_valid_cancel_rollback();
+  memoryExemptEnd();
+#endif
+  otaProgressErase();
+  progressOpen = false;
+  enter(OTA_IDLE);
+  deviceLog("update confirmed");
+  telemetryPrintf("OTA:confirmed,%s\r\n", esp_ota_get_running_partition()->label);
+}
+
+void otaSetup() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  updatePartition = esp_ota_get_next_update_partition(nullptr);
+#ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+  // Installed by other means, but still waiting for the same confirmation
+  esp_ota_img_states_t imageState;
+  if (esp_ota_get_state_partition(running, &imageState) == ESP_OK &&
+      imageState == ESP_OTA_IMG_PENDING_VERIFY) {
+    state = OTA_TRIAL;
+    stateSince = millis();
+  }
+#endif
+  if (otaProgressLoad(progress) != CONFIG_LOADED) return;
+
+  switch (progress.phase) {
+    case OTA_PHASE_RECEIVING:
+    case OTA_PHASE_VERIFIED:
+      progressOpen = true;  // resumed by the next "ota begin"
+      return;
+    case OTA_PHASE_TRIAL:
+      if (running->address != progress.target) break;  // the bootloader went back already
+      if (++progress.trialBoots > OTA_TRIAL_BOOTS) {
+        const esp_partition_t* previous = partitionAt(progress.previous);
+        if (previous && esp_ota_set_boot_partition(previous) == ESP_OK) {
+          progress.phase = OTA_PHASE_ROLLED_BACK;
+          otaProgressSave(progress);
+          ESP.restart();
+        }
+        deviceLog("update: no image to roll back to");
+        otaProgressErase();
+        return;
+      }
+      otaProgressSave(progress);
+      state = OTA_TRIAL;
+      stateSince = millis();
+      telemetryPrintf("OTA:trial,%s,boot=%u\r\n", running->label, (unsigned)progress.trialBoots);
+      return;
+    case OTA_PHASE_ROLLED_BACK:
+      break;
+  }
+  deviceLog("update rolled back to %s", running->label);
+  telemetryPrintf("OTA:rolled_back,%s\r\n", running->label);
+  otaProgressErase();
+}
+
+void otaService() {
+  switch (state) {
+    case OTA_CHECKING:
+      checkManifest();
+      break;
+    case OTA_WRITING:
+      writeStep();
+      break;
+    case OTA_VERIFYING:
+      verifyStep();
+      break;
+    case OTA_RESTARTING:
+      if (millis() - stateSince >= OTA_RESTART_DELAY_MS) ESP.restart();
+      break;
+    case OTA_TRIAL:
+      if (millis() - stateSince >= OTA_CONFIRM_MS && runtimeStats.samples > 0) confirm();
+      break;
+    default:
+      break;
+  }
+}
+
+uint8_t* otaExpect(OtaPayload kind, uint32_t index, uint32_t crc) {
+  expectedKind = kind;
+  expectedIndex = index;
+  expectedCrc = crc;
+  // Still being checked or inflated: read the bytes, but drop them
+  payloadDropped = state == OTA_CHECKING || (state == OTA_WRITING && step == STEP_INFLATE);
+  if (payloadDropped) return nullptr;
+  if (!work && (kind == OTA_PAYLOAD_MANIFEST || state == OTA_RECEIVING)) {
+    work = (OtaScratch*)scratchAcquire(SCRATCH_UPDATE);
+  }
+  return work ? work->chunk : nullptr;
+}
+
+void otaPayloadReceived(uint16_t length, bool complete) {
+  // Timed out (the console has replied): nothing to check or write
+  if (!complete) {
+    holdScratch();
+    return;
+  }
+
+  bool manifest = expectedKind == OTA_PAYLOAD_MANIFEST;
+  const char* busy = payloadDropped || state == OTA_WRITING || state == OTA_VERIFYING ||
+                             state == OTA_RESTARTING
+                         ? "busy"
+                     : state == OTA_TRIAL ? "running image not confirmed yet"
+                                          : nullptr;
+  if (!busy && !manifest && state != OTA_RECEIVING) {
+    busy = state == OTA_VERIFIED ? "image complete" : "no update open";
+  }
+  if (!busy && !work) busy = "memory in use by a capture";
+  if (busy) {
+    holdScratch();  // leased by otaExpect() for nothing
+    if (manifest) telemetryPrintf("ERR ota begin: %s\r\n", busy);
+    else telemetryPrintf("ERR ota block %lu: %s\r\n", (unsigned long)expectedIndex, busy);
+    return;
+  }
+
+  chunkLength = length;
+  if (manifest) {
+    stateBeforeCheck = state;
+    enter(OTA_CHECKING);
+  } else {
+    step = STEP_INFLATE;
+    enter(OTA_WRITING);
+  }
+}
+
+void otaFinish() {
+  if (state == OTA_VERIFIED) {
+    telemetryPrintf("OK ota finish: image verified\r\n");
+  } else if (state != OTA_RECEIVING) {
+    telemetryPrintf("ERR ota finish: %s\r\n", state == OTA_IDLE ? "no update open" : "busy");
+  } else if (progress.nextBlock != progress.blockCount) {
+    telemetryPrintf("ERR ota finish: %lu of %lu blocks written\r\n",
+                    (unsigned long)progress.nextBlock, (unsigned long)progress.blockCount);
+  } else {
+    mbedtls_sha256_init(&hash);
+    mbedtls_sha256_starts_ret(&hash, 0);
+    verified = 0;
+    enter(OTA_VERIFYING);
+  }
+}
+
+void otaApply() {
+  if (state != OTA_VERIFIED) {
+    telemetryPrintf("ERR ota apply: no verified image\r\n");
+    return;
+  }
+  // Checks the image header and checksum as the bootloader will, and
+  // rewrites the OTA data partition, on the heap
+  memoryExemptBegin();
+  esp_err_t err = esp_ota_set_boot_partition(target);
+  memoryExemptEnd();
+  if (err != ESP_OK) {
+    telemetryPrintf("ERR ota apply: image rejected (%s)\r\n", esp_err_to_name(err));
+    return;
+  }
+  progress.phase = OTA_PHASE_TRIAL;
+  progress.previous = esp_ota_get_running_partition()->address;
+  progress.trialBoots = 0;
+  otaProgressSave(progress);
+  deviceLog("update applied, restarting into %s", target->label);
+  telemetryPrintf("OK ota apply: restarting into %s\r\n", target->label);
+  enter(OTA_RESTARTING);
+  stateSince = millis();
+}
+
+void otaAbort() {
+  if (state == OTA_TRIAL || state == OTA_RESTARTING) {
+    telemetryPrintf("ERR ota abort: image already applied\r\n");
+    return;
+  }
+  if (state == OTA_VERIFYING) mbedtls_sha256_free(&hash);
+  otaProgressErase();
+  progressOpen = false;
+  enter(OTA_IDLE);
+  telemetryPrintf("OK ota abort\r\n");
+}
+
+void printOta() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  const esp_partition_t* next = target ? target : updatePartition;
+  telemetryPrintf("OTA:%s,%s,%s,%lu,%lu\r\n", STATE_NAMES[state], running ? running->label : "-",
+                  next ? next->label : "-", progressOpen ? (unsigned long)progress.nextBlock : 0UL,
+                  progressOpen ? (unsigned long)progress.blockCount : 0UL);
+}
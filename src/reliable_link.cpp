@@ -0,0 +1,164 @@
+/*
+  Reliable Event Delivery
+  Retransmit window indexed by sequence number, acknowledgements and the
+  resend timer.
+*/
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "memory_budget.h"
+#include "reliable_link.h"
+
+struct ReliableFrame {
+  uint32_t sequence;
+  uint32_t queuedMs;
+  uint32_t sentMs;
+  uint8_t length;
+  uint8_t resends;
+  bool acked;
+  char line[RELIABLE_FRAME_MAX];
+};
+
+static ReliableFrame window[RELIABLE_WINDOW];
+static uint32_t nextSequence = 0;
+static uint32_t base = 0;  // oldest frame held; base == nextSequence when empty
+static bool enabled = false;
+static ReliableStats stats = {0, 0, 0, 0};
+
+constexpr MemoryRegion reliableMemory = {"reliable", sizeof(window), MEMORY_BUDGET_RELIABLE};
+static_assert(reliableMemory.bytes <= reliableMemory.budget,
+              "retransmit window exceeds its memory budget");
+
+// CRC-16/CCITT-FALSE, continued over several pieces
+static uint16_t crc16(const char* data, size_t length, uint16_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)((uint8_t)data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static ReliableFrame& slot(uint32_t sequence) {
+  return window[sequence & (RELIABLE_WINDOW - 1)];
+}
+
+// Drop acknowledged frames from the front of the window
+static void advanceBase() {
+  while (base != nextSequence && slot(base).acked) base++;
+}
+
+static void transmit(ReliableFrame& frame, uint32_t now) {
+  char header[40];
+  int n = snprintf(header, sizeof(header), "%lu,%lu,%lu", (unsigned long)frame.sequence,
+                   (unsigned long)base, (unsigned long)frame.queuedMs);
+  uint16_t crc = crc16(header, n, 0xFFFF);
+  crc = crc16(":", 1, crc);
+  crc = crc16(frame.line, frame.length, crc);
+  telemetryPrintf("@%s,%04x:%.*s\r\n", header, crc, frame.length, frame.line);
+  frame.sentMs = now;  // a frame the ring had no room for goes again on the timer
+}
+
+void reliableEnable(bool on) {
+  enabled = on;
+}
+
+bool reliableEnabled() {
+  return enabled;
+}
+
+bool reliablePrintf(const char* format, ...) {
+  char line[TELEMETRY_LINE_MAX];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length < 0) return false;
+  length = telemetryLineLength(line, length);
+  if (!enabled) return telemetryWrite(line, length);
+
+  // The frame carries its own line ending
+  while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+  if (length > RELIABLE_FRAME_MAX) length = RELIABLE_FRAME_MAX;
+
+  if (nextSequence - base == RELIABLE_WINDOW) {
+    if (!slot(base).acked) stats.abandoned++;
+    base++;
+    advanceBase();
+  }
+  ReliableFrame& frame = slot(nextSequence);
+  frame.sequence = nextSequence++;
+  frame.queuedMs = millis();
+  frame.length = (uint8_t)length;
+  frame.resends = 0;
+  frame.acked = false;
+  memcpy(frame.line, line, length);
+  stats.sent++;
+  transmit(frame, frame.queuedMs);
+  return true;
+}
+
+void reliableAck(uint32_t next, uint32_t sack) {
+  uint32_t now = millis();
+  uint32_t highest = next;  // one past the highest selectively acknowledged
+  for (uint32_t s = base; s != nextSequence; s++) {
+    ReliableFrame& frame = slot(s);
+    uint32_t offset = s - next;  // wraps for frames before next
+    bool covered = (int32_t)(s - next) < 0 || (offset >= 1 && offset <= 32 &&
+                                                (sack >> (offset - 1)) & 1u);
+    if (covered && !frame.acked) {
+      frame.acked = true;
+      stats.acked++;
+    }
+    if (covered && (int32_t)(s - next) >= 0) highest = s + 1;
+  }
+
+  // The host has frames past these gaps, so they were lost, not late
+  uint32_t first = (int32_t)(next - base) < 0 ? base : next;
+  for (uint32_t s = first; (int32_t)(highest - s) > 0; s++) {
+    ReliableFrame& frame = slot(s);
+    if (!frame.acked && now - frame.sentMs >= RELIABLE_FAST_MS) {
+      frame.sentMs = now - RELIABLE_MAX_RTO_MS;  // due on the next service
+    }
+  }
+  advanceBase();
+}
+
+void reliableService() {
+  if (!enabled || base == nextSequence) return;
+  uint32_t now = millis();
+  int budget = RELIABLE_RESENDS_PER_SERVICE;
+  for (uint32_t s = base; s != nextSequence && budget > 0; s++) {
+    ReliableFrame& frame = slot(s);
+    if (frame.acked) continue;
+    uint32_t timeout = (uint32_t)RELIABLE_RTO_MS << (frame.resends < 3 ? frame.resends : 3);
+    if (timeout > RELIABLE_MAX_RTO_MS) timeout = RELIABLE_MAX_RTO_MS;
+    if (now - frame.sentMs < timeout) continue;
+    if (TELEMETRY_BUFFER_SIZE - telemetryPending() < TELEMETRY_LINE_MAX) return;
+    if (frame.resends < 255) frame.resends++;
+    stats.resent++;
+    transmit(frame, now);
+    budget--;
+  }
+}
+
+uint32_t reliableNextSequence() {
+  return nextSequence;
+}
+
+uint32_t reliableBase() {
+  return base;
+}
+
+const ReliableStats& reliableStats() {
+  return stats;
+}
+
+void sendReliableStats() {
+  telemetryPrintf("RELIABLE:%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", enabled ? "on" : "off",
+                  (unsigned long)nextSequence, (unsigned long)base,
+                  (unsigned long)(nextSequence - base), (unsigned long)stats.sent,
+                  (unsigned long)stats.resent, (unsigned long)stats.acked,
+                  (unsigned long)stats.abandoned);
+}
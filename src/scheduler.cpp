@@ -0,0 +1,127 @@
+/*
+  Cooperative Task Scheduler
+  Fixed task table, one task per schedulerRun() call.
+*/
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "memory_budget.h"
+#include "scheduler.h"
+
+static Task tasks[SCHEDULER_MAX_TASKS];
+static int taskCount = 0;
+static int idleCursor = 0;
+static uint64_t busyCycles = 0;  // non-idle tasks only
+
+constexpr MemoryRegion schedulerMemory = {"scheduler", sizeof(tasks), MEMORY_BUDGET_SCHEDULER};
+static_assert(schedulerMemory.bytes <= schedulerMemory.budget,
+              "task table exceeds its memory budget");
+
+static inline bool due(const Task& task, uint32_t now) {
+  return task.ready && (int32_t)(now - task.release) >= 0;
+}
+
+int schedulerAdd(const char* name, TaskFunction run, TaskKind kind, uint8_t priority,
+                 uint32_t periodUs, uint32_t deadlineUs) {
+  if (taskCount >= SCHEDULER_MAX_TASKS) return -1;
+  Task& task = tasks[taskCount];
+  memset(&task, 0, sizeof(task));
+  task.name = name;
+  task.run = run;
+  task.kind = kind;
+  task.priority = priority;
+  task.periodUs = periodUs;
+  task.deadlineUs = deadlineUs;
+  task.release = micros();
+  task.ready = kind != TASK_EVENT;
+  return taskCount++;
+}
+
+void schedulerSetPeriod(int id, uint32_t periodUs, uint32_t deadlineUs) {
+  if (id < 0 || id >= taskCount) return;
+  tasks[id].periodUs = periodUs;
+  tasks[id].deadlineUs = deadlineUs;
+  tasks[id].release = micros();
+}
+
+void schedulerSignal(int id) {
+  if (id < 0 || id >= taskCount || tasks[id].ready) return;
+  tasks[id].ready = true;
+  tasks[id].release = micros();
+}
+
+static void runTask(Task& task, uint32_t now) {
+  if (task.kind != TASK_IDLE) {
+    uint32_t latency = now - task.release;
+    if (latency > task.stats.maxLatencyUs) task.stats.maxLatencyUs = latency;
+    if (latency > task.deadlineUs) task.stats.deadlineMisses++;
+  }
+
+  // Periodic: advance on the grid, resynchronising after a missed period
+  if (task.kind == TASK_PERIODIC) {
+    if (now - task.release >= task.periodUs) {
+      task.stats.skipped += (now - task.release) / task.periodUs;
+      task.release = now;
+    }
+    task.release += task.periodUs;
+  } else if (task.kind == TASK_EVENT) {
+    task.ready = false;
+  }
+
+  uint32_t start = ESP.getCycleCount();
+  task.run(now);
+  uint32_t cycles = ESP.getCycleCount() - start;
+
+  task.stats.runs++;
+  task.stats.totalCycles += cycles;
+  if (cycles > task.stats.maxCycles) task.stats.maxCycles = cycles;
+  // Idle tasks only fill spare time, so they do not count as load
+  if (task.kind != TASK_IDLE) busyCycles += cycles;
+}
+
+void schedulerRun() {
+  uint32_t now = micros();
+
+  // Highest priority due task; earliest release breaks ties
+  Task* next = nullptr;
+  for (int i = 0; i < taskCount; i++) {
+    Task& task = tasks[i];
+    if (task.kind == TASK_IDLE || !due(task, now)) continue;
+    if (!next || task.priority < next->priority ||
+        (task.priority == next->priority && (int32_t)(task.release - next->release) < 0)) {
+      next = &task;
+    }
+  }
+  if (next) {
+    runTask(*next, now);
+    return;
+  }
+
+  // Nothing due: give the time to the next idle task in turn
+  for (int n = 0; n < taskCount; n++) {
+    idleCursor = (idleCursor + 1) % taskCount;
+    if (tasks[idleCursor].kind == TASK_IDLE) {
+      runTask(tasks[idleCursor], now);
+      return;
+    }
+  }
+}
+
+int schedulerTaskCount() {
+  return taskCount;
+}
+
+const Task& schedulerTask(int id) {
+  return tasks[id];
+}
+
+uint64_t schedulerBusyCycles() {
+  return busyCycles;
+}
+
+void schedulerResetStats() {
+  for (int i = 0; i < taskCount; i++) {
+    memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+  }
+}
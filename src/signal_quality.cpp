@@ -0,0 +1,93 @@
+/*
+  Signal Quality Index
+  Block scoring for the per-sample accumulators in signal_quality.h.
+*/
+
+#include <math.h>
+
+#include "signal_quality.h"
+
+// Where a mains frequency lands after sampling, 0 to fs/2
+static float aliasedHz(float hz, float fs) {
+  float f = fmodf(hz, fs);
+  return f > fs / 2 ? fs - f : f;
+}
+
+// At DC the bin holds the electrode offset, and at Nyquist the sample
+// alternation, not mains (50 Hz at 50 or 100 Hz, 60 Hz at 60 or 120 Hz)
+static bool lineMeasurable(float hz, float fs) {
+  float f = aliasedHz(hz, fs);
+  return f >= SQI_MAINS_GUARD_HZ && f <= fs / 2 - SQI_MAINS_GUARD_HZ;
+}
+
+static float goertzelCoeff(float hz, float fs) {
+  return 2 * cosf(2 * (float)M_PI * aliasedHz(hz, fs) / fs);
+}
+
+// 1 at or below good, 0 at or beyond bad
+static float ramp(float value, const float* limits) {
+  if (value <= limits[0]) return 1;
+  if (value >= limits[1]) return 0;
+  return (limits[1] - value) / (limits[1] - limits[0]);
+}
+
+void SignalQuality::setSampleRate(float fs) {
+  // One-second blocks: whole mains cycles, so the block mean does not leak
+  blockSize = (int)fs;
+  coeffA = goertzelCoeff(SQI_MAINS_A_HZ, fs);
+  coeffB = goertzelCoeff(SQI_MAINS_B_HZ, fs);
+  lineA = lineMeasurable(SQI_MAINS_A_HZ, fs);
+  lineB = lineMeasurable(SQI_MAINS_B_HZ, fs);
+  reset();
+}
+
+void SignalQuality::reset() {
+  n = 0;
+  saturated = 0;
+  prevRaw = -1;
+  flatRun = longestFlat = 0;
+  sum = sumSquares = 0;
+  a1 = a2 = b1 = b2 = 0;
+  x1 = x2 = 0;
+  hfSum = hfFloor = 0;
+  hfCount = 0;
+}
+
+void SignalQuality::evaluate() {
+  float mean = sum / n;
+  float acEnergy = sumSquares - sum * mean;
+  float powerA = lineA ? a1 * a1 + a2 * a2 - coeffA * a1 * a2 : 0;
+  float powerB = lineB ? b1 * b1 + b2 * b2 - coeffB * b1 * b2 : 0;
+
+  metrics.saturation = (float)saturated / n;
+  metrics.flatline = (float)longestFlat / n;
+  metrics.lineRatio = acEnergy > 1e-9f ? 2 * (powerA + powerB) / (n * acEnergy) : 0;
+  metrics.hfNoise = sqrtf(hfFloor);
+  metrics.offset = fabsf(mean - midRail);
+
+  float scores[5] = {
+    ramp(metrics.saturation, saturationLimits),
+    ramp(metrics.flatline, flatlineLimits),
+    ramp(metrics.lineRatio, lineLimits),
+    ramp(metrics.hfNoise, hfLimits),
+    ramp(metrics.offset, offsetLimits),
+  };
+
+  // Weakest symptom decides; flags name every symptom below the gate
+  score = 1;
+  flags = 0;
+  for (int i = 0; i < 5; i++) {
+    if (scores[i] < score) score = scores[i];
+    if (scores[i] < SQI_GATE) flags |= 1 << i;
+  }
+
+  reset();
+}
+
+float minimumSqi(const SignalQuality* channels, int count) {
+  float lowest = 1;
+  for (int c = 0; c < count; c++) {
+    if (channels[c].score < lowest) lowest = channels[c].score;
+  }
+  return lowest;
+}
@@ -0,0 +1,82 @@
+/*
+  Non-blocking Telemetry Channel
+  Single-producer ring buffer drained from loop().
+*/
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include "memory_budget.h"
+#include "telemetry.h"
+
+static char txRing[TELEMETRY_BUFFER_SIZE];
+static size_t txHead = 0;  // next byte to write
+static size_t txTail = 0;  // next byte to send
+static size_t txCount = 0;
+static TelemetryStats stats = {0, 0, 0, 0};
+
+constexpr MemoryRegion telemetryMemory = {"telemetry", sizeof(txRing), MEMORY_BUDGET_TELEMETRY};
+static_assert(telemetryMemory.bytes <= telemetryMemory.budget,
+              "telemetry ring exceeds its memory budget");
+
+bool telemetryWrite(const char* data, size_t length) {
+  if (length > TELEMETRY_BUFFER_SIZE - txCount) {
+    stats.bytesDropped += length;
+    stats.writesDropped++;
+    return false;
+  }
+
+  // Copy in at most two contiguous pieces
+  size_t first = TELEMETRY_BUFFER_SIZE - txHead;
+  if (first > length) first = length;
+  memcpy(txRing + txHead, data, first);
+  memcpy(txRing, data + first, length - first);
+  txHead = (txHead + length) % TELEMETRY_BUFFER_SIZE;
+  txCount += length;
+
+  if (txCount > stats.highWater) stats.highWater = txCount;
+  return true;
+}
+
+bool telemetryPrintf(const char* format, ...) {
+  char line[TELEMETRY_LINE_MAX];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+
+  if (length < 0) return false;
+  return telemetryWrite(line, telemetryLineLength(line, length));
+}
+
+size_t telemetryLineLength(char* line, int length) {
+  if (length < TELEMETRY_LINE_MAX) return length;
+  line[TELEMETRY_LINE_MAX - 3] = '\r';
+  line[TELEMETRY_LINE_MAX - 2] = '\n';
+  return TELEMETRY_LINE_MAX - 1;
+}
+
+void telemetryFlush() {
+  while (txCount > 0) {
+    int room = Serial.availableForWrite();
+    if (room <= 0) return;
+
+    size_t chunk = TELEMETRY_BUFFER_SIZE - txTail;
+    if (chunk > txCount) chunk = txCount;
+    if (chunk > (size_t)room) chunk = room;
+
+    size_t written = Serial.write((const uint8_t*)txRing + txTail, chunk);
+    txTail = (txTail + written) % TELEMETRY_BUFFER_SIZE;
+    txCount -= written;
+    stats.bytesSent += written;
+    if (written < chunk) return;
+  }
+}
+
+size_t telemetryPending() {
+  return txCount;
+}
+
+const TelemetryStats& telemetryStats() {
+  return stats;
+}
@@ -0,0 +1,108 @@
+/*
+  Streaming Welch PSD
+  Configuration and the staged per-segment work.
+*/
+
+#include <math.h>
+
+#include "welch.h"
+
+// Parabola through the log powers around the peak (exact for a
+// Gaussian-shaped peak, close for the Hann main lobe)
+float peakOffset(const float* psd, int k) {
+  float a = psd[k - 1], b = psd[k], c = psd[k + 1];
+  if (a <= 0 || b <= 0 || c <= 0) return 0;
+  float la = logf(a), lb = logf(b), lc = logf(c);
+  float curvature = la - 2 * lb + lc;
+  if (curvature >= 0) return 0;
+  float offset = 0.5f * (la - lc) / curvature;
+  return offset < -0.5f ? -0.5f : offset > 0.5f ? 0.5f : offset;
+}
+
+// Every segment finishes before the next one starts: hop decimated
+// samples are hop * decimation input samples of work
+void WelchPsd::pace() {
+  int inputs = hop * decimation;
+  unitsPerSample = (WELCH_SEGMENT_UNITS + inputs - 1) / inputs;
+}
+
+void WelchPsd::configure(int overlapPercent, int averageCount) {
+  hop = welchHop(overlapPercent);
+  averages = averageCount > 0 ? averageCount : 1;
+  pace();
+  reset();
+}
+
+void WelchPsd::setSampleRate(float fs) {
+  decimation = welchDecimation(fs);
+  fs /= decimation;
+  sampleRate = fs;
+  pace();
+  binHz = fs / WELCH_SEGMENT_SIZE;
+  // Hann: sum of squared weights is 3N/8
+  scale = 2 / (fs * 3.0f * WELCH_SEGMENT_SIZE / 8);
+  minBin = (int)ceilf(WELCH_MIN_HZ / binHz);
+  if (minBin < 2) minBin = 2;
+  maxBin = (int)(WELCH_MAX_HZ / binHz);
+  if (maxBin > WELCH_BINS - 2) maxBin = WELCH_BINS - 2;
+  reset();
+}
+
+void WelchPsd::reset() {
+  head = 0;
+  filled = 0;
+  sinceHop = 0;
+  decimationSum = 0;
+  decimationCount = 0;
+  stage = STAGE_IDLE;
+  segments = 0;
+  peakHz = 0;
+  concentration = 0;
+  for (int k = 0; k < WELCH_BINS; k++) psd[k] = 0;
+}
+
+void WelchPsd::advance(int units) {
+  const int n = WELCH_SEGMENT_SIZE;
+
+  if (stage == STAGE_LOAD) {
+    for (; cursor < n && units > 0; cursor++, units--) {
+      int index = segmentStart + cursor;
+      if (index >= n) index -= n;
+      int j = fft.reverse(cursor);
+      re[j] = ring[index] * fft.hann(cursor);
+      im[j] = 0;
+    }
+    if (cursor < n) return;
+    stage = STAGE_TRANSFORM;
+    butterfly = Fft<WELCH_SEGMENT_SIZE>::Cursor();
+  }
+
+  if (stage == STAGE_TRANSFORM) {
+    if (!fft.butterflies(re, im, butterfly, units)) return;
+    stage = STAGE_ACCUMULATE;
+    cursor = 0;
+    bandPower = 0;
+    bestBin = minBin;
+    if (segments < averages) segments++;
+  }
+
+  if (stage == STAGE_ACCUMULATE) {
+    float weight = 1.0f / segments;
+    for (; cursor < WELCH_BINS && units > 0; cursor++, units--) {
+      int k = cursor;
+      float power = (re[k] * re[k] + im[k] * im[k]) * scale;
+      if (k == 0 || k == n / 2) power *= 0.5f;  // not folded
+      psd[k] += weight * (power - psd[k]);
+      if (k >= minBin && k <= maxBin) {
+        bandPower += psd[k];
+        if (psd[k] > psd[bestBin]) bestBin = k;
+      }
+    }
+    if (cursor < WELCH_BINS) return;
+
+    peakHz = (bestBin + peakOffset(psd, bestBin)) * binHz;
+    float lobe = psd[bestBin - 1] + psd[bestBin] + psd[bestBin + 1];
+    concentration = bandPower > 0 ? lobe / bandPower : 0;
+    stage = STAGE_IDLE;
+  }
+}
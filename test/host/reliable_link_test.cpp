@@ -0,0 +1,191 @@
+/*
+  Reliable Link Tests (host)
+  The receiving end of the framed events (host/reliable_link.h): frame
+  checks, duplicates, gaps held and released in order, skips past the
+  32-frame acknowledgement window, a reset after the device reboots, and
+  a lossy, reordering link checked for every frame delivered once, in
+  order, or counted lost.
+
+  Build: g++ -std=c++17 -O1 -I../../host reliable_link_test.cpp -o reliable_link_test
+  Usage: reliable_link_test
+*/
+
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "reliable_link.h"
+
+using namespace reliable_link;
+
+// "@seq,base,ms,crc:line" as the firmware frames it
+static std::string frameText(uint32_t sequence, uint32_t base, uint32_t deviceMs,
+                             const std::string& line) {
+  char head[48];
+  std::snprintf(head, sizeof(head), "%lu,%lu,%lu", (unsigned long)sequence, (unsigned long)base,
+                (unsigned long)deviceMs);
+  uint16_t crc = crc16(head, std::strlen(head));
+  crc = crc16(":", 1, crc);
+  crc = crc16(line.data(), line.size(), crc);
+  char text[256];
+  std::snprintf(text, sizeof(text), "@%s,%04x:%s\r\n", head, crc, line.c_str());
+  return text;
+}
+
+struct Link {
+  Receiver receiver;
+  std::vector<std::string> released;
+
+  bool send(uint32_t sequence, uint32_t base, int64_t receivedMs = 0) {
+    std::string text = frameText(sequence, base, sequence * 10, "L" + std::to_string(sequence));
+    Frame frame;
+    assert(parseFrame(text.data(), frame));
+    bool fresh = receiver.accept(frame, receivedMs);
+    Delivery delivery;
+    while (receiver.release(delivery)) released.push_back(delivery.line);
+    return fresh;
+  }
+
+  std::string lines() const {
+    std::string all;
+    for (const std::string& line : released) all += line + " ";
+    return all;
+  }
+};
+
+static void testFrames() {
+  std::string text = frameText(7, 3, 12345, "CLASSIFICATION:NORMAL,5.00,0.10,0.02");
+  Frame frame;
+  std::string copy = text;
+  assert(parseFrame(copy.data(), frame));
+  assert(frame.sequence == 7 && frame.base == 3 && frame.deviceMs == 12345);
+  assert(std::strcmp(frame.line, "CLASSIFICATION:NORMAL,5.00,0.10,0.02") == 0);
+
+  copy = text;
+  copy[copy.find("NORMAL")] = 'M';  // damaged in transit
+  assert(!parseFrame(copy.data(), frame));
+  copy = "BOOT:reset=1\r\n";
+  assert(!parseFrame(copy.data(), frame));
+}
+
+static void testDuplicatesAndGaps() {
+  Link link;
+  link.receiver.reset(0);
+  for (uint32_t s = 0; s < 3; s++) assert(link.send(s, 0));
+  assert(!link.send(1, 0));  // already delivered
+  assert(link.receiver.ack() == "ack 3 0\r\n");
+
+  assert(link.send(4, 0));
+  assert(link.send(5, 0));
+  assert(!link.send(5, 0));  // already held
+  assert(link.receiver.duplicates == 2);
+  assert(link.receiver.ack() == "ack 3 3\r\n");
+  assert(link.lines() == "L0 L1 L2 ");  // 4 and 5 wait for 3
+
+  assert(link.send(3, 0));
+  assert(link.lines() == "L0 L1 L2 L3 L4 L5 ");
+  assert(link.receiver.ack() == "ack 6 0\r\n");
+
+  // The device gives up on 6 and 7: they are lost, 8 and 9 go on
+  assert(link.send(8, 0));
+  assert(link.send(9, 8));
+  assert(link.receiver.lost == 2);
+  assert(link.lines() == "L0 L1 L2 L3 L4 L5 L8 L9 ");
+  assert(!link.send(7, 8));  // too late, counted as a duplicate
+  assert(link.receiver.delivered == 8);
+}
+
+static void testSkipBeyondWindow() {
+  Link link;
+  link.receiver.reset(0);
+  assert(link.send(0, 0));
+  assert(link.send(2, 0));
+  assert(link.send(3, 0));
+  // 40 frames ahead: the window moves to 40 - 32, abandoning 1 and 4..7
+  assert(link.send(40, 0));
+  assert(link.receiver.lost == 5);
+  assert(link.lines() == "L0 L2 L3 ");
+  assert(link.receiver.ack() == "ack 8 80000000\r\n");
+  for (uint32_t s = 8; s < 40; s++) assert(link.send(s, 0));
+  assert(link.receiver.ack() == "ack 41 0\r\n");
+  assert(link.released.size() == 3 + 33);
+  assert(link.released.back() == "L40");
+
+  // Far beyond, with frames held inside the old window
+  assert(link.send(43, 0));
+  assert(link.send(44, 0));
+  assert(link.send(500, 0));
+  assert(link.receiver.lost == 5 + (468 - 41) - 2);
+  assert(link.released.back() == "L44");
+  assert(link.receiver.ack() == "ack 468 80000000\r\n");
+}
+
+// A rebooted device numbers its frames from its new base again
+static void testResetAfterReboot() {
+  Link link;
+  link.receiver.reset(0);
+  int64_t wall = 0;
+  for (uint32_t s = 0; s < 100; s++) {
+    assert(link.send(s, s > 10 ? s - 10 : 0, 1000000 + s * 10));
+    wall = link.receiver.wallTime(s * 10, 1000000 + s * 10);
+  }
+  assert(!link.send(0, 0));  // before the reboot is seen, a duplicate
+  link.receiver.reset(0);    // "OK reliable on next=0 base=0"
+  link.released.clear();
+  for (uint32_t s = 0; s < 5; s++) assert(link.send(s, 0, 2000000 + s * 10));
+  assert(link.lines() == "L0 L1 L2 L3 L4 ");
+  assert(link.receiver.ack() == "ack 5 0\r\n");
+  // The device clock restarted too: mapped times follow the new offset
+  int64_t after = link.receiver.wallTime(0, 2000000);
+  assert(after >= wall && after == 2000000);
+}
+
+// Drops, duplicates and reordering; the device abandons what stays
+// unacknowledged for 48 frames
+static void testLossyLink() {
+  std::mt19937 random(98);
+  Link link;
+  link.receiver.reset(0);
+  std::vector<uint32_t> inFlight;
+  std::set<uint32_t> accepted;
+  uint32_t next = 0;
+  while (next < 20000 || !inFlight.empty()) {
+    if (next < 20000 && (inFlight.empty() || random() % 3)) inFlight.push_back(next++);
+    size_t pick = random() % inFlight.size();
+    uint32_t s = inFlight[pick];
+    uint32_t base = next > 48 ? next - 48 : 0;
+    if (s < base) {
+      inFlight.erase(inFlight.begin() + pick);
+      continue;
+    }
+    if (random() % 10 != 0) {
+      if (link.send(s, base)) assert(accepted.insert(s).second);
+    }
+    if (random() % 5 != 0) inFlight.erase(inFlight.begin() + pick);
+  }
+  assert(link.send(next, next));  // the device moves on past everything sent
+  accepted.insert(next);
+
+  uint32_t previous = 0;
+  for (size_t i = 0; i < link.released.size(); i++) {
+    uint32_t s = (uint32_t)std::stoul(link.released[i].substr(1));
+    assert(i == 0 || s > previous);
+    assert(accepted.count(s));
+    previous = s;
+  }
+  assert(link.released.size() == accepted.size());
+  assert(link.receiver.delivered + link.receiver.lost == next + 1);
+}
+
+int main() {
+  testFrames();
+  testDuplicatesAndGaps();
+  testSkipBeyondWindow();
+  testResetAfterReboot();
+  testLossyLink();
+  std::printf("reliable_link_test: ok\n");
+  return 0;
+}
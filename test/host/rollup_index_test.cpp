@@ -0,0 +1,136 @@
+/*
+  Rollup Index Tests (host)
+  Class time in the rollups (host/rollup_index.h) against the intervals
+  the records and stops credit, summed by brute force: at every level,
+  across bucket boundaries, and across an ingest restart.
+
+  Build: g++ -std=c++17 -O1 -I../../host rollup_index_test.cpp -o rollup_index_test
+  Usage: rollup_index_test
+*/
+
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+
+#include "record_store.h"
+#include "rollup_index.h"
+
+using namespace record_store;
+
+static const int64_t MINUTE = 60LL * 1000, HOUR = 60 * MINUTE, DAY = 24 * HOUR;
+static const int64_t START = 1700000000000LL;  // not aligned to any level
+
+static std::filesystem::path scratch(const char* name) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() /
+                               ("rollup_index_test." + std::to_string(getpid())) / name;
+  std::filesystem::remove_all(path);
+  return path;
+}
+
+static Record record(int64_t timestampMs, int classification) {
+  Record r = {};
+  r.timestampMs = timestampMs;
+  r.classification = (uint8_t)classification;
+  r.values[COLUMN_FREQUENCY] = 5.0f;
+  r.values[COLUMN_AMPLITUDE] = 1.0f;
+  return r;
+}
+
+static bool near(double a, double b) { return std::fabs(a - b) < 0.5; }
+
+// A class that does not change for two hours is credited two hours
+static void testStablePeriod() {
+  RollupIndex rollups(scratch("stable"));
+  rollups.add("d", record(START, CLASS_NORMAL));
+  rollups.add("d", record(START + 2 * HOUR, CLASS_MILD));
+  RollupBucket total = rollups.total("d", START, START + 3 * HOUR);
+  assert(near(total.classMs[CLASS_NORMAL], 2 * HOUR));
+  assert(near(total.classMs[CLASS_MILD], 0));
+  assert(total.rows == 2);
+}
+
+// Random records and stops; every level sums to the credited intervals
+static void testTotalsMatchIntervals() {
+  std::mt19937 random(96);
+  RollupIndex rollups(scratch("random"));
+  double expected[CLASS_COUNT] = {};
+  int64_t t = START;
+  bool open = false;
+  int classification = 0;
+  uint32_t rows = 0;
+  for (int i = 0; i < 5000; i++) {
+    int64_t gap = random() % 4 == 0 ? random() % (3 * HOUR) : random() % (2 * MINUTE) + 1;
+    if (random() % 50 == 0) {
+      int64_t heard = t + (int64_t)(random() % (gap + 1));
+      if (open && heard > t) expected[classification] += (double)(heard - t);
+      rollups.end("d", heard);
+      open = false;
+    }
+    if (open) expected[classification] += (double)gap;
+    t += gap;
+    classification = random() % CLASS_COUNT;
+    rollups.add("d", record(t, classification));
+    open = true;
+    rows++;
+  }
+
+  int64_t to = t + DAY;
+  RollupBucket total = rollups.total("d", START, to);
+  assert(total.rows == rows);
+  for (int k = 0; k < CLASS_COUNT; k++) assert(near(total.classMs[k], expected[k]));
+  for (int level = 0; level < LEVEL_COUNT; level++) {
+    RollupPlan plan = RollupIndex::plan(START, to, LEVEL_SPAN_MS[level]);
+    assert(plan.level == level);
+    double sums[CLASS_COUNT] = {};
+    for (const RollupBucket& b : rollups.series("d", plan)) {
+      double bucketMs = 0;
+      for (int k = 0; k < CLASS_COUNT; k++) {
+        sums[k] += b.classMs[k];
+        bucketMs += b.classMs[k];
+      }
+      assert(bucketMs <= (double)plan.stepMs + 0.5);
+    }
+    for (int k = 0; k < CLASS_COUNT; k++) assert(near(sums[k], expected[k]));
+  }
+}
+
+// A new ingest continues the last stored record, unless a stop ended it
+static void testResume() {
+  std::filesystem::path directory = scratch("resume");
+  {
+    RecordStore store(directory);
+    RollupIndex rollups(directory);
+    for (Record r : {record(START, CLASS_NORMAL), record(START + HOUR, CLASS_MILD)}) {
+      assert(store.append("open", r));
+      rollups.add("open", r);
+      assert(store.append("ended", r));
+      rollups.add("ended", r);
+    }
+    rollups.end("ended", START + HOUR + 10 * MINUTE);
+    assert(store.flush() && rollups.flush());
+  }
+  RecordStore store(directory);
+  RollupIndex rollups(directory);
+  for (const char* device : {"open", "ended"}) {
+    rollups.resume(store, device);
+    Record next = record(START + 3 * HOUR, CLASS_SEVERE);
+    assert(store.append(device, next));
+    rollups.add(device, next);
+  }
+  RollupBucket open = rollups.total("open", START, START + DAY);
+  assert(near(open.classMs[CLASS_NORMAL], HOUR));
+  assert(near(open.classMs[CLASS_MILD], 2 * HOUR));
+  RollupBucket ended = rollups.total("ended", START, START + DAY);
+  assert(near(ended.classMs[CLASS_NORMAL], HOUR));
+  assert(near(ended.classMs[CLASS_MILD], 10 * MINUTE));
+}
+
+int main() {
+  testStablePeriod();
+  testTotalsMatchIntervals();
+  testResume();
+  std::filesystem::remove_all(scratch(""));
+  std::printf("rollup_index_test: ok\n");
+  return 0;
+}
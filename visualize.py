@@ -11,9 +11,9 @@ import math
 
 # ==== CONFIGURATION ====
 SERVER_URL = "http://10.184.10.101:3000/api/tremor"  # same as ESP32
-WINDOW_SIZE = 500   # number of samples to display at once
+WINDOW_SIZE = 5000  # number of samples to display at once (10 s at 500 Hz)
 REFRESH_INTERVAL = 100  # ms - Faster updates for smoother visualization
-MAX_DISPLAY_POINTS = 1000  # Limit display points for performance
+MAX_DISPLAY_POINTS = 1000  # Limit display points for performance (LTTB keeps the shape; below WINDOW_SIZE)
 DEVICE_ID = "ESP32_MEDICAL_001"  # Device ID to fetch data for
 
 # ==== STORAGE ====
@@ -190,6 +190,41 @@ def fetch_emg():
         consecutive_failures += 1  # Increment failure counter for unexpected errors
         return []
 
+# ==== DISPLAY DOWNSAMPLING ====
+def lttb_downsample(values, threshold):
+    """Largest-Triangle-Three-Buckets: pick `threshold` (index, value) points
+    that preserve the visual shape, peaks included (same method as the
+    firmware's display stream, include/downsample.h)"""
+    n = len(values)
+    if threshold >= n or threshold < 3:
+        return list(range(n)), list(values)
+
+    indices = [0]
+    bucket = (n - 2) / (threshold - 2)
+    a = 0
+    for i in range(threshold - 2):
+        start = int(i * bucket) + 1
+        end = int((i + 1) * bucket) + 1
+        next_end = min(int((i + 2) * bucket) + 1, n)
+
+        # Mean of the next bucket (the last point for the final bucket)
+        if end < next_end:
+            cx = (end + next_end - 1) / 2
+            cy = sum(values[end:next_end]) / (next_end - end)
+        else:
+            cx, cy = n - 1, values[-1]
+
+        ax, ay = a, values[a]
+        best, best_area = start, -1.0
+        for j in range(start, end):
+            area = abs((ax - cx) * (values[j] - ay) - (ax - j) * (cy - ay))
+            if area > best_area:
+                best, best_area = j, area
+        indices.append(best)
+        a = best
+    indices.append(n - 1)
+    return indices, [values[i] for i in indices]
+
 # ==== UPDATE PLOT ====
 def update(frame):
     global last_successful_fetch, last_response_data, consecutive_failures
@@ -202,17 +237,11 @@ def update(frame):
         last_successful_fetch = current_time
         emg_data.extend(new_samples)
 
-        # Limit display points for performance
-        if len(emg_data) > MAX_DISPLAY_POINTS:
-            # Show only the most recent points
-            display_data = list(emg_data)[-MAX_DISPLAY_POINTS:]
-            start_idx = len(emg_data) - MAX_DISPLAY_POINTS
-        else:
-            display_data = list(emg_data)
-            start_idx = 0
+        # Limit display points for performance without dropping peaks
+        display_x, display_data = lttb_downsample(list(emg_data), MAX_DISPLAY_POINTS)
 
-        line.set_data(range(start_idx, len(emg_data)), display_data)
-        ax.set_xlim(start_idx, len(emg_data))
+        line.set_data(display_x, display_data)
+        ax.set_xlim(0, len(emg_data))
 
         # Update status text
         samples_per_sec = len(new_samples) / (REFRESH_INTERVAL / 1000) if REFRESH_INTERVAL > 0 else 0